@@ -0,0 +1,1048 @@
+/**
+ * @brief   Benchmark file
+ * @details This file contains the benchmark harness. It generates seeded synthetic maps, runs
+ *          every search mode over the same fixed query set of each map and reports latency
+ *          percentiles, expanded nodes per second, path length and peak RSS as CSV or JSON,
+ *          so two builds can be compared row by row.
+ *          Usage: ./pathbench [--suite quick|default|large] [--sizes 32,256] [--kinds open,maze]
+ *                             [--modes astar,jps] [--queries N] [--rounds R] [--seed S] [--density P]
+ *                             [--cluster N] [--format csv|json] [--out file]
+ *                 ./pathbench gen <kind> <size> <out.bsm> [--seed S] [--density P] [--packed|--chunked]
+ *                             [--queries N <query_file>]
+ *                 ./pathbench compare <base.csv> <new.csv> [--threshold PCT]
+ *                 ./pathbench allocs [--sizes 32,256] [--kinds open,maze] [--queries N] [--seed S]
+ *                 ./pathbench hda [--sizes 2048] [--kinds open,maze] [--threads 1,2,4,8] [--queries N] [--seed S]
+ *                 ./pathbench dstar [--sizes 256,1024] [--kinds open,maze] [--steps N] [--edits E] [--costs C]
+ *                             [--seed S]
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include "batch.hpp"
+#include "chunked_map.hpp"
+#include "dstar.hpp"
+#include "map_format.hpp"
+#include "hda.hpp"
+#include "mapgen.hpp"
+#include "query.hpp"
+
+#define BENCH_SEED          1           // default seed of maps and queries
+#define BENCH_DENSITY       0.25        // default obstacle share of random maps
+#define BENCH_ROUNDS        3           // default runs of each query set, the fastest time counts
+#define BENCH_PAIR_TRIES    64          // targets tried per query before giving up on a start
+#define GREEDY_MAX_SIZE     1024        // greedy walks most of a large map, skipped above this side
+#define COMPARE_THRESHOLD   10.0        // default p50 slowdown in percent that fails a compare
+#define COMPARE_FLOOR_US    5.0         // p50 changes below this are timer noise, never flagged
+#define DSTAR_AHEAD         30          // path points ahead of the ship the dstar check edits near
+#define DSTAR_SPREAD        2           // cells an edit lies off the path at most, per axis
+
+/**
+ * @brief Heap allocations of the process through operator new, counted so the allocs
+ *        check can show that warmed up route() calls do not allocate. The count is
+ *        one relaxed increment per allocation.
+ *
+ */
+static atomic<long> heap_allocs(0);
+
+void *operator new(size_t n) {
+    heap_allocs.fetch_add(1, memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+/**
+ * @brief Struct to store the result of one mode on one map
+ *
+ */
+typedef struct BENCH_ROW {
+    string kind;                    // map kind
+    int size;                       // map side in cells
+    uint64_t seed;                  // map and query seed
+    string mode;                    // search mode
+    int queries;                    // queries run
+    int found;                      // queries that found a path
+    double setup_ms;                // preparation of the mode, e.g. the HPA* graph, and one warm-up query
+    double total_ms;                // sum of the query latencies, fastest round per query
+    double p50_us;                  // median query latency
+    double p99_us;                  // 99th percentile query latency
+    double max_us;                  // slowest query
+    long expanded;                  // nodes expanded over all queries, -1 if the mode does not count them
+    double nodes_per_s;             // expanded nodes per second of query time
+    double mean_path;               // mean points per found path
+    long peak_rss_kb;               // peak resident set while the mode ran
+} _bench_row;
+
+typedef struct MODE_NAME {
+    const char *name;
+    _search_mode mode;
+} _mode_name;
+
+static const _mode_name modes_known[] = {
+    {"astar", SEARCH_ASTAR}, {"bidir", SEARCH_BIDIR}, {"jps", SEARCH_JPS}, {"hpa", SEARCH_HPA}, {"bfs", SEARCH_BFS}, {"alt", SEARCH_ALT},
+    {"greedy", SEARCH_GREEDY}
+};
+
+static const char *csv_header =
+    "kind,size,seed,mode,queries,found,setup_ms,total_ms,p50_us,p99_us,max_us,expanded,nodes_per_s,mean_path,peak_rss_kb";
+
+/**
+ * @brief Function to split a comma separated list
+ * @param s list
+ * @returns list items
+ */
+static vector<string> split_list(const string &s) {
+    vector<string> out;
+    stringstream in(s);
+    string item;
+    while (getline(in, item, ',')) {
+        if (!item.empty()) {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Function to reset the peak resident set of the process (Linux clear_refs),
+ *        so every row reports its own peak rather than the run's
+ *
+ */
+static void reset_peak_rss(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+/**
+ * @brief Function to read the peak resident set since the last reset_peak_rss()
+ * @returns peak resident set in kB
+ */
+static long peak_rss_kb(void) {
+    ifstream in("/proc/self/status");
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return stol(line.substr(6));
+        }
+    }
+    struct rusage ru;                                           // no procfs, peak of the whole run
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/**
+ * @brief Function to draw a fixed query set. Start and target are passable cells of
+ *        one component, so every query measures a search rather than the component
+ *        check; the set only depends on the map and the seed.
+ * @param bu pointer to the battleship holding the map, components built
+ * @param count number of queries
+ * @param seed query seed
+ * @param queries pointer to vector receiving the queries
+ */
+static void make_queries(battleship *bu, int count, uint64_t seed, vector<_query> *queries) {
+    bench_rng rng(seed ^ 0x5157455249455321ULL);
+    uint32_t cells = (uint32_t)bu->get_cells();
+    queries->clear();
+    for (long tries = 0; ((int)queries->size() < count) && (tries < (long)count * BENCH_PAIR_TRIES); ++tries) {
+        int s = (int)rng.below(cells);
+        if (!bu->is_passable(s)) {
+            continue;
+        }
+        for (int i = 0; i < BENCH_PAIR_TRIES; ++i) {
+            int t = (int)rng.below(cells);
+            if ((t != s) && bu->connected(s, t)) {
+                queries->push_back({{bu->x_of(s), bu->y_of(s)}, {bu->x_of(t), bu->y_of(t)}});
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Struct to store the options every pathbench run shares
+ *
+ */
+typedef struct BENCH_OPTS {
+    vector<int> sizes;              // map sides in cells
+    vector<string> kinds;           // map kinds
+    uint64_t seed;                  // map and query seed
+} _bench_opts;
+
+/**
+ * @brief Struct to store one generated map with its battleship and query set
+ *
+ */
+typedef struct BENCH_MAP {
+    vector<int8_t> terrain;         // generated terrain, must outlive the battleship
+    _field start;                   // unset endpoints, the queries carry their own
+    _field target;
+    unique_ptr<battleship> bu;      // battleship over the terrain, components and border built
+    vector<_query> queries;         // query set drawn on the map
+} _bench_map;
+
+/**
+ * @brief Function to return the default options with the given map sides
+ * @param sizes map sides in cells
+ * @returns options with every map kind and BENCH_SEED
+ */
+static _bench_opts default_opts(const vector<int> &sizes) {
+    return {sizes, {"open", "random", "maze", "archipelago", "corridor"}, BENCH_SEED};
+}
+
+/**
+ * @brief Function to read the option at argv[*i] together with its value, every
+ *        option of pathbench takes one
+ * @param argc number of arguments
+ * @param argv arguments
+ * @param i pointer to the index of the option, left on its value
+ * @param opt pointer to string receiving the option
+ * @param val pointer to string receiving the value
+ * @returns 1 if succeeded, 0 if the value is missing
+ */
+static int read_option(int argc, char *argv[], int *i, string *opt, string *val) {
+    *opt = argv[*i];
+    if (*i + 1 >= argc) {
+        cerr << "Missing value for option: " << *opt << "\n";
+        return 0;
+    }
+    *val = argv[++*i];
+    return 1;
+}
+
+/**
+ * @brief Function to apply one of the shared options --sizes, --kinds and --seed
+ * @param opt option
+ * @param val value of the option
+ * @param opts pointer to the options to update
+ * @returns 1 if the option is a shared one, 0 otherwise
+ */
+static int common_option(const string &opt, const string &val, _bench_opts *opts) {
+    if (opt == "--sizes") {
+        opts->sizes.clear();
+        for (string &v : split_list(val)) {
+            opts->sizes.push_back(stoi(v));
+        }
+    } else if (opt == "--kinds") {
+        opts->kinds = split_list(val);
+    } else if (opt == "--seed") {
+        opts->seed = stoull(val);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Function to check that every map kind of the options is known
+ * @param opts options
+ * @returns 1 if all are known, 0 otherwise
+ */
+static int kinds_known(const _bench_opts &opts) {
+    for (const string &name : opts.kinds) {
+        if (map_kind_of(name) == MAP_KINDS) {
+            cerr << "Unknown map kind: " << name << "\n";
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Function to generate a map, build its battleship with components and border
+ *        and draw its query set with the seed plus the map side
+ * @param name map kind, checked by kinds_known()
+ * @param size map side in cells
+ * @param seed map and query seed
+ * @param density obstacle share of random maps
+ * @param count number of queries
+ * @param m pointer to the map to fill
+ */
+static void build_bench_map(const string &name, int size, uint64_t seed, double density, int count, _bench_map *m) {
+    generate_map(map_kind_of(name), size, seed, density, &m->terrain);
+    m->start = {};
+    m->target = {};
+    m->start.x_pos = m->target.x_pos = -1;
+    m->bu = make_unique<battleship>(1, size, size, &m->start, &m->target, m->terrain.data());
+    m->bu->build_components();
+    m->bu->build_border();
+    make_queries(m->bu.get(), count, seed + size, &m->queries);
+}
+
+/**
+ * @brief Function to run one search mode over a query set. Every query keeps its
+ *        fastest time over the rounds, which takes out most scheduler noise;
+ *        found paths and expanded nodes are counted in the first round.
+ * @param bu pointer to the battleship holding the map
+ * @param mode search mode
+ * @param queries query set
+ * @param rounds times the query set is run
+ * @param cluster HPA* cluster side
+ * @param row pointer to the row receiving the measurements
+ */
+static void run_mode(battleship *bu, _search_mode mode, const vector<_query> &queries, int rounds, int cluster,
+                     _bench_row *row) {
+    vector<double> lat(queries.size(), 1e300);
+    long path_points = 0;
+    row->queries = (int)queries.size();
+    row->found = 0;
+    row->expanded = -1;
+    reset_peak_rss();
+
+    if (mode == SEARCH_GREEDY) {                                // runs on the battleship's endpoints
+        auto t0 = chrono::steady_clock::now();
+        bu->get_scratch();                                      // sizes the search state outside the timings
+        row->setup_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        vector<_points*> sol;
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                _field s = {}, t = {};
+                s.x_pos = queries[i].start.x;
+                s.y_pos = queries[i].start.y;
+                t.x_pos = queries[i].target.x;
+                t.y_pos = queries[i].target.y;
+                bu->set_endpoints(&s, &t);
+                t0 = chrono::steady_clock::now();
+                int ok = find_path_greedy(bu, &sol);
+                lat[i] = min(lat[i], chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+                if (ok && (r == 0)) {
+                    row->found++;
+                    path_points += (long)sol.size();
+                }
+                for (_points *p : sol) {
+                    delete p;
+                }
+                sol.clear();
+            }
+        }
+    } else {
+        auto t0 = chrono::steady_clock::now();
+        batch_engine engine(bu, 1, mode, cluster);
+        _query_result res;
+        if (!queries.empty()) {                                 // sizes the search state outside the timings
+            engine.solve(0, queries[0], &res);
+        }
+        long warm = engine.get_expanded();
+        row->setup_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                t0 = chrono::steady_clock::now();
+                engine.solve(0, queries[i], &res);
+                lat[i] = min(lat[i], chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+                if (res.found && (r == 0)) {
+                    row->found++;
+                    path_points += (long)res.path.size();
+                }
+            }
+            if (r == 0) {
+                row->expanded = engine.get_expanded() - warm;
+            }
+        }
+    }
+    row->peak_rss_kb = peak_rss_kb();
+
+    row->total_ms = 0;
+    for (double us : lat) {
+        row->total_ms += us / 1000.0;
+    }
+    sort(lat.begin(), lat.end());
+    row->p50_us = percentile(lat, 50);
+    row->p99_us = percentile(lat, 99);
+    row->max_us = lat.empty() ? 0 : lat.back();
+    row->nodes_per_s = ((row->expanded > 0) && (row->total_ms > 0)) ? row->expanded / (row->total_ms / 1000.0) : 0;
+    row->mean_path = row->found ? (double)path_points / row->found : 0;
+}
+
+/**
+ * @brief Function to print one row as CSV
+ * @param out stream to write to
+ * @param r row
+ */
+static void print_csv(ostream &out, const _bench_row &r) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s,%d,%llu,%s,%d,%d,%.3f,%.3f,%.2f,%.2f,%.2f,%ld,%.0f,%.2f,%ld",
+             r.kind.c_str(), r.size, (unsigned long long)r.seed, r.mode.c_str(), r.queries, r.found, r.setup_ms,
+             r.total_ms, r.p50_us, r.p99_us, r.max_us, r.expanded, r.nodes_per_s, r.mean_path, r.peak_rss_kb);
+    out << buf << "\n";
+}
+
+/**
+ * @brief Function to print one row as a JSON object
+ * @param out stream to write to
+ * @param r row
+ */
+static void print_json(ostream &out, const _bench_row &r) {
+    char buf[640];
+    snprintf(buf, sizeof(buf),
+             "{\"kind\": \"%s\", \"size\": %d, \"seed\": %llu, \"mode\": \"%s\", \"queries\": %d, \"found\": %d, "
+             "\"setup_ms\": %.3f, \"total_ms\": %.3f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+             "\"expanded\": %ld, \"nodes_per_s\": %.0f, \"mean_path\": %.2f, \"peak_rss_kb\": %ld}",
+             r.kind.c_str(), r.size, (unsigned long long)r.seed, r.mode.c_str(), r.queries, r.found, r.setup_ms,
+             r.total_ms, r.p50_us, r.p99_us, r.max_us, r.expanded, r.nodes_per_s, r.mean_path, r.peak_rss_kb);
+    out << buf;
+}
+
+/**
+ * @brief Function to write a generated map as a chunked binary map file, one row at a
+ *        time, so the map may be larger than memory. The first passable cell becomes
+ *        the start and the last one the target, for a route across the whole map.
+ *
+ * @param kind map kind, not MAP_MAZE
+ * @param size side of the map in cells
+ * @param seed generator seed
+ * @param density share of elevated cells for MAP_RANDOM
+ * @param out output file path
+ * @returns 1 if succeeded, 0 if failed
+ */
+static int gen_chunked(_map_kind kind, int size, uint64_t seed, double density, const string &out) {
+    auto t0 = chrono::steady_clock::now();
+    _field start = {}, target = {};
+    start.x_pos = target.x_pos = -1;
+    chunk_writer writer;
+    if (!writer.open(out, size, size, &start, &target)) {
+        return 0;
+    }
+    row_generator gen(kind, size, seed, density);
+    vector<int8_t> row(size);
+    for (int x = 0; x < size; ++x) {
+        gen.row(x, row.data());
+        for (int y = 0; y < size; ++y) {
+            if (row[y] == ELEVATED_TERRAIN) {
+                continue;
+            }
+            if (start.x_pos < 0) {
+                start.x_pos = x;
+                start.y_pos = y;
+            }
+            target.x_pos = x;
+            target.y_pos = y;
+        }
+        if (!writer.add_row(row.data())) {
+            return 0;
+        }
+    }
+    writer.set_endpoints(&start, &target);
+    if (!writer.close()) {
+        return 0;
+    }
+    cerr << "Generated chunked " << map_kind_name(kind) << " " << size << "x" << size << " map (seed " << seed
+         << ") into " << out << " in " << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s"
+         << endl;
+    return 1;
+}
+
+/**
+ * @brief Function to write a generated map as a binary map file, with the first
+ *        query as start and target, and optionally a query file for batch mode
+ *
+ * @param argc number of arguments after "gen"
+ * @param argv arguments after "gen"
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_gen(int argc, char *argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: gen <kind> <size> <out.bsm> [--seed S] [--density P] [--packed|--chunked] [--queries N <query_file>]\n";
+        return -1;
+    }
+    _map_kind kind = map_kind_of(argv[0]);
+    int size = stoi(argv[1]);
+    string out = argv[2], query_file;
+    uint64_t seed = BENCH_SEED;
+    double density = BENCH_DENSITY;
+    int count = 1;
+    _map_encoding encoding = MAP_ENC_BYTE;
+    for (int i = 3; i < argc; ++i) {
+        string opt = argv[i];
+        if ((opt == "--seed") && (i + 1 < argc)) {
+            seed = stoull(argv[++i]);
+        } else if ((opt == "--density") && (i + 1 < argc)) {
+            density = stod(argv[++i]);
+        } else if (opt == "--packed") {
+            encoding = MAP_ENC_2BIT;
+        } else if (opt == "--chunked") {
+            encoding = MAP_ENC_CHUNKED;
+        } else if ((opt == "--queries") && (i + 2 < argc)) {
+            count = max(1, stoi(argv[++i]));
+            query_file = argv[++i];
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+    if ((kind == MAP_KINDS) || (size < 2)) {
+        cerr << "Error: Unknown map kind " << argv[0] << " or size below 2" << endl;
+        return -1;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    if (encoding == MAP_ENC_CHUNKED) {
+        if ((kind == MAP_MAZE) || !query_file.empty()) {
+            cerr << "Error: Chunked maps are generated row by row, without mazes and query files" << endl;
+            return -1;
+        }
+        return gen_chunked(kind, size, seed, density, out) ? 0 : -1;
+    }
+    vector<int8_t> terrain;
+    generate_map(kind, size, seed, density, &terrain);
+    _field start = {}, target = {};
+    start.x_pos = target.x_pos = -1;
+    battleship bu(1, size, size, &start, &target, terrain.data());
+    bu.build_components();
+    vector<_query> queries;
+    make_queries(&bu, count, seed, &queries);
+    if (!queries.empty()) {
+        start.x_pos = queries[0].start.x;
+        start.y_pos = queries[0].start.y;
+        target.x_pos = queries[0].target.x;
+        target.y_pos = queries[0].target.y;
+    }
+    if (!write_map_binary(out, &bu, &start, &target, encoding)) {
+        return -1;
+    }
+    if (!query_file.empty()) {
+        ofstream qf(query_file);
+        if (!qf.is_open()) {
+            cerr << "Error: Could not open file " << query_file << endl;
+            return -1;
+        }
+        for (const _query &q : queries) {
+            qf << q.start.x << " " << q.start.y << " " << q.target.x << " " << q.target.y << "\n";
+        }
+    }
+    cerr << "Generated " << map_kind_name(kind) << " " << size << "x" << size << " map (seed " << seed << ") into "
+         << out << " in " << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+    return 0;
+}
+
+/**
+ * @brief Function to read the rows of a benchmark CSV file, keyed by kind, size and mode
+ * @param f_name CSV file path
+ * @param rows pointer to map receiving the rows
+ * @returns 1 if succeeded, 0 if failed
+ */
+static int read_csv(const string &f_name, map<string, _bench_row> *rows) {
+    ifstream in(f_name);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    string line;
+    while (getline(in, line)) {
+        vector<string> f = split_list(line);
+        if ((f.size() < 15) || (f[0] == "kind")) {
+            continue;
+        }
+        _bench_row r;
+        r.kind = f[0];
+        r.size = stoi(f[1]);
+        r.seed = stoull(f[2]);
+        r.mode = f[3];
+        r.queries = stoi(f[4]);
+        r.found = stoi(f[5]);
+        r.setup_ms = stod(f[6]);
+        r.total_ms = stod(f[7]);
+        r.p50_us = stod(f[8]);
+        r.p99_us = stod(f[9]);
+        r.max_us = stod(f[10]);
+        r.expanded = stol(f[11]);
+        r.nodes_per_s = stod(f[12]);
+        r.mean_path = stod(f[13]);
+        r.peak_rss_kb = stol(f[14]);
+        (*rows)[r.kind + "/" + f[1] + "/" + r.mode] = r;
+    }
+    return 1;
+}
+
+/**
+ * @brief Function to compare two benchmark CSV files row by row. Prints the change of
+ *        p50, p99, expanded nodes and path length per row and flags rows whose p50 got
+ *        slower by more than the threshold.
+ *
+ * @param argc number of arguments after "compare"
+ * @param argv arguments after "compare": <base.csv> <new.csv> [--threshold PCT]
+ * @returns 0 if no p50 got slower than the threshold, 1 if one did, -1 if failed
+ */
+static int run_compare(int argc, char *argv[]) {
+    double threshold = COMPARE_THRESHOLD;
+    if ((argc == 4) && (string(argv[2]) == "--threshold")) {
+        threshold = stod(argv[3]);
+    } else if (argc != 2) {
+        cerr << "Usage: compare <base.csv> <new.csv> [--threshold PCT]\n";
+        return -1;
+    }
+    map<string, _bench_row> base, next;
+    if (!read_csv(argv[0], &base) || !read_csv(argv[1], &next)) {
+        return -1;
+    }
+
+    int slower = 0;
+    printf("%-28s %10s %10s %8s %8s %9s %8s\n", "kind/size/mode", "p50_us", "new", "p50", "p99", "expanded", "path");
+    for (auto &it : next) {
+        auto b = base.find(it.first);
+        if (b == base.end()) {
+            continue;
+        }
+        const _bench_row &o = b->second, &n = it.second;
+        auto pct = [](double a, double b) { return (a > 0) ? (b - a) * 100.0 / a : 0.0; };
+        double d50 = pct(o.p50_us, n.p50_us);
+        bool flag = (d50 > threshold) && (n.p50_us - o.p50_us > COMPARE_FLOOR_US);
+        slower += flag;
+        printf("%-28s %10.2f %10.2f %+7.1f%% %+7.1f%% %+8.1f%% %+7.1f%%%s\n", it.first.c_str(), o.p50_us, n.p50_us,
+               d50, pct(o.p99_us, n.p99_us), pct((double)o.expanded, (double)n.expanded),
+               pct(o.mean_path, n.mean_path), flag ? "  SLOWER" : "");
+    }
+    printf("%d rows slower than %.1f%% at p50\n", slower, threshold);
+    return slower ? 1 : 0;
+}
+
+/**
+ * @brief Function to check that route() does not allocate once its arena is sized.
+ *        For every map and every mode route() serves, one query_arena solves a warm-up
+ *        query set and then a second set drawn with another seed, so nothing the
+ *        warm-up grew can hide an allocation of new queries. Prints one line per map
+ *        and mode with the allocations of the warm-up and of the measured set.
+ *
+ * @param argc number of arguments after "allocs"
+ * @param argv arguments after "allocs"
+ * @returns 0 if no query allocated, 1 if one did, -1 if failed
+ */
+static int run_allocs(int argc, char *argv[]) {
+    _bench_opts opts = default_opts({10, 32, 256, 1024});
+    int count = 200;
+    for (int i = 0; i < argc; ++i) {
+        string opt, val;
+        if (!read_option(argc, argv, &i, &opt, &val)) {
+            return -1;
+        }
+        if (common_option(opt, val, &opts)) {
+            continue;
+        }
+        if (opt == "--queries") {
+            count = stoi(val);
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+    if (!kinds_known(opts)) {
+        return -1;
+    }
+
+    const _search_mode served[] = {SEARCH_ASTAR, SEARCH_JPS, SEARCH_BIDIR, SEARCH_ALT};
+    const char *served_names[] = {"astar", "jps", "bidir", "alt"};
+    int failed = 0;
+    printf("%-12s %6s %-6s %8s %8s %7s %8s\n", "kind", "size", "mode", "queries", "found", "warmup", "allocs");
+    for (int size : opts.sizes) {
+        for (string &name : opts.kinds) {
+            _bench_map m;
+            build_bench_map(name, size, opts.seed, BENCH_DENSITY, count, &m);
+            battleship &bu = *m.bu;
+            landmark_set lm(&bu);
+            vector<_query> queries;
+            make_queries(&bu, count, opts.seed + size + 1, &queries);
+            vector<int> warm_ends, ends;
+            for (const _query &q : m.queries) {
+                warm_ends.push_back(bu.index(q.start.x, q.start.y));
+                warm_ends.push_back(bu.index(q.target.x, q.target.y));
+            }
+            for (const _query &q : queries) {
+                ends.push_back(bu.index(q.start.x, q.start.y));
+                ends.push_back(bu.index(q.target.x, q.target.y));
+            }
+
+            for (size_t m = 0; m < sizeof(served) / sizeof(served[0]); ++m) {
+                query_arena arena(&bu, &lm);
+                _path_span path;
+                long before = heap_allocs.load();
+                for (size_t i = 0; i < warm_ends.size(); i += 2) {
+                    route(&bu, &arena, warm_ends[i], warm_ends[i + 1], served[m], &path);
+                }
+                long warmup = heap_allocs.load() - before;
+                int found = 0;
+                before = heap_allocs.load();
+                for (size_t i = 0; i < ends.size(); i += 2) {
+                    found += (route(&bu, &arena, ends[i], ends[i + 1], served[m], &path) > 0);
+                }
+                long allocs = heap_allocs.load() - before;
+                failed += (allocs != 0);
+                printf("%-12s %6d %-6s %8zu %8d %7ld %8ld%s\n", name.c_str(), size, served_names[m], queries.size(), found,
+                       warmup, allocs, allocs ? "  ALLOCATES" : "");
+            }
+        }
+    }
+    printf("%d rows allocated\n", failed);
+    return failed ? 1 : 0;
+}
+
+/**
+ * @brief Function to measure the speedup of HDA* over its worker count. For every map
+ *        the query set is solved once with astar_search() for reference and once per
+ *        worker count with hda_search; every HDA* path must be as long as the A* path.
+ *        Prints one line per map and worker count with the total time, the speedup
+ *        over the first worker count, the expanded cells and the messages between workers.
+ *
+ * @param argc number of arguments after "hda"
+ * @param argv arguments after "hda"
+ * @returns 0 if every path matched, 1 if one did not, -1 if failed
+ */
+static int run_hda(int argc, char *argv[]) {
+    _bench_opts opts = default_opts({2048});
+    vector<int> workers = {1, 2, 4, 8};
+    int count = 20;
+    for (int i = 0; i < argc; ++i) {
+        string opt, val;
+        if (!read_option(argc, argv, &i, &opt, &val)) {
+            return -1;
+        }
+        if (common_option(opt, val, &opts)) {
+            continue;
+        }
+        if (opt == "--threads") {
+            workers.clear();
+            for (string &v : split_list(val)) {
+                workers.push_back(max(1, stoi(v)));
+            }
+        } else if (opt == "--queries") {
+            count = stoi(val);
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+    if (!kinds_known(opts)) {
+        return -1;
+    }
+
+    int mismatched = 0;
+    printf("%-12s %6s %-6s %8s %10s %8s %12s %12s %9s\n", "kind", "size", "mode", "threads", "total_ms", "speedup",
+           "expanded", "messages", "mismatch");
+    for (int size : opts.sizes) {
+        for (string &name : opts.kinds) {
+            _bench_map m;
+            build_bench_map(name, size, opts.seed, BENCH_DENSITY, count, &m);
+            battleship &bu = *m.bu;
+            const vector<_query> &queries = m.queries;
+
+            search_state *ss = bu.get_scratch();
+            vector<int> lengths, cells;
+            long expanded = 0;
+            auto t0 = chrono::steady_clock::now();
+            for (const _query &q : queries) {
+                int s = bu.index(q.start.x, q.start.y), t = bu.index(q.target.x, q.target.y);
+                lengths.push_back(astar_search(&bu, ss, s, t) ? trace_path(&bu, ss, t, &cells) : 0);
+                expanded += ss->expanded;
+            }
+            double astar_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            printf("%-12s %6d %-6s %8d %10.1f %8s %12ld %12s %9s\n", name.c_str(), size, "astar", 1, astar_ms, "-",
+                   expanded, "-", "-");
+
+            double base_ms = 0;
+            for (size_t k = 0; k < workers.size(); ++k) {
+                hda_search hda(&bu, workers[k]);
+                long exp = 0, msgs = 0;
+                int bad = 0;
+                t0 = chrono::steady_clock::now();
+                for (size_t i = 0; i < queries.size(); ++i) {
+                    const _query &q = queries[i];
+                    int found = hda.find_path(bu.index(q.start.x, q.start.y), bu.index(q.target.x, q.target.y), &cells);
+                    bad += ((found ? (int)cells.size() : 0) != lengths[i]);
+                    exp += hda.get_expanded();
+                    msgs += hda.get_messages();
+                }
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+                base_ms = k ? base_ms : ms;
+                mismatched += bad;
+                printf("%-12s %6d %-6s %8d %10.1f %7.2fx %12ld %12ld %9d\n", name.c_str(), size, "hda", hda.get_threads(),
+                       ms, (ms > 0) ? base_ms / ms : 0, exp, msgs, bad);
+            }
+        }
+    }
+    printf("%d paths differ in length from A*\n", mismatched);
+    return mismatched ? 1 : 0;
+}
+
+/**
+ * @brief Function to check D* Lite against A* on a ship under way. For every map a ship
+ *        plans from the start of a seeded query to its target and then, each step, sees
+ *        a few seeded cells flip between ground and elevated near the path ahead,
+ *        replans with dstar_lite::replan() and moves one step along the plan. After
+ *        every replan a new astar_search() runs from the ship; the two paths must cost
+ *        the same. With --costs above 1 every cell gets a seeded step cost up to it.
+ *        Prints one line per map with the replan and A* latencies and their mean
+ *        expanded cells.
+ *
+ * @param argc number of arguments after "dstar"
+ * @param argv arguments after "dstar"
+ * @returns 0 if every path matched, 1 if one did not, -1 if failed
+ */
+static int run_dstar(int argc, char *argv[]) {
+    _bench_opts opts = default_opts({256, 1024});
+    int steps = 200, edits = 2, max_cost = 1;
+    for (int i = 0; i < argc; ++i) {
+        string opt, val;
+        if (!read_option(argc, argv, &i, &opt, &val)) {
+            return -1;
+        }
+        if (common_option(opt, val, &opts)) {
+            continue;
+        }
+        if (opt == "--steps") {
+            steps = stoi(val);
+        } else if (opt == "--edits") {
+            edits = max(0, stoi(val));
+        } else if (opt == "--costs") {
+            max_cost = min(max(1, stoi(val)), (int)UINT8_MAX);
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+    if (!kinds_known(opts)) {
+        return -1;
+    }
+
+    int mismatched = 0;
+    printf("%-12s %6s %6s %8s %9s %9s %9s %10s %9s %10s %9s\n", "kind", "size", "steps", "plan_ms", "found",
+           "p50_us", "p99_us", "expanded", "astar_us", "astar_exp", "mismatch");
+    for (int size : opts.sizes) {
+        for (string &name : opts.kinds) {
+            _bench_map m;
+            build_bench_map(name, size, opts.seed, BENCH_DENSITY, 1, &m);
+            battleship &bu = *m.bu;
+            const vector<_query> &queries = m.queries;
+            bench_rng rng(opts.seed ^ (uint64_t)size ^ 0x4453544152ULL);
+            if (max_cost > 1) {
+                vector<uint8_t> costs(bu.get_cells());
+                for (uint8_t &c : costs) {
+                    c = (uint8_t)(1 + rng.below((uint32_t)max_cost));
+                }
+                bu.set_costs(move(costs));
+            }
+            if (queries.empty()) {
+                continue;
+            }
+
+            dstar_lite planner(&bu);
+            auto t0 = chrono::steady_clock::now();
+            planner.plan(bu.index(queries[0].start.x, queries[0].start.y), bu.index(queries[0].target.x, queries[0].target.y));
+            double plan_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+            search_state *ss = bu.get_scratch();
+            vector<_points> path;
+            vector<int> cells;
+            vector<double> replan_us;
+            long expanded = 0, astar_expanded = 0;
+            double astar_us = 0;
+            int done = 0, found = 0, bad = 0;
+            int goal = planner.get_goal();
+            for (; (done < steps) && (planner.get_ship() != goal); ++done) {
+                int points = planner.get_path(&path);
+                for (int e = 0; e < edits; ++e) {                 // near the path ahead, or the ship if cut off
+                    _points p = {bu.x_of(planner.get_ship()), bu.y_of(planner.get_ship())};
+                    if (points > 1) {
+                        p = path[1 + rng.below((uint32_t)min(points - 1, DSTAR_AHEAD))];
+                    }
+                    int x = p.x + (int)rng.below(2 * DSTAR_SPREAD + 1) - DSTAR_SPREAD;
+                    int y = p.y + (int)rng.below(2 * DSTAR_SPREAD + 1) - DSTAR_SPREAD;
+                    if ((x < 0) || (x >= size) || (y < 0) || (y >= size)) {
+                        continue;
+                    }
+                    int cell = bu.index(x, y);
+                    if ((cell != planner.get_ship()) && (cell != goal)) {
+                        planner.set_cell(cell, bu.is_passable(cell) ? ELEVATED_TERRAIN : GROUND_TERRAIN);
+                    }
+                }
+
+                t0 = chrono::steady_clock::now();
+                int ok = planner.replan();
+                replan_us.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+                expanded += planner.get_expanded();
+                points = ok ? planner.get_path(&path) : 0;
+
+                t0 = chrono::steady_clock::now();
+                long cost = -1;
+                if (astar_search(&bu, ss, planner.get_ship(), goal)) {
+                    trace_path(&bu, ss, goal, &cells);
+                    cost = 0;
+                    for (size_t i = 1; i < cells.size(); ++i) {
+                        cost += bu.has_costs() ? bu.step_cost(cells[i]) : 1;
+                    }
+                }
+                astar_us += chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+                astar_expanded += ss->expanded;
+                found += (points > 0);
+                bad += ((points ? path_cost(&bu, path) : -1) != cost);
+
+                int next = planner.next_step();
+                if (next >= 0) {
+                    planner.move_to(next);
+                }
+            }
+            sort(replan_us.begin(), replan_us.end());
+            mismatched += bad;
+            int n = max(done, 1);
+            printf("%-12s %6d %6d %8.2f %9d %9.1f %9.1f %10.1f %9.1f %10.1f %9d\n", name.c_str(), size, done, plan_ms,
+                   found, percentile(replan_us, 50), percentile(replan_us, 99), (double)expanded / n, astar_us / n,
+                   (double)astar_expanded / n, bad);
+        }
+    }
+    printf("%d replanned paths differ in cost from A*\n", mismatched);
+    return mismatched ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if ((argc > 1) && (string(argv[1]) == "gen")) {
+        return run_gen(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (string(argv[1]) == "compare")) {
+        return run_compare(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (string(argv[1]) == "allocs")) {
+        return run_allocs(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (string(argv[1]) == "hda")) {
+        return run_hda(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (string(argv[1]) == "dstar")) {
+        return run_dstar(argc - 2, argv + 2);
+    }
+
+    _bench_opts opts = default_opts({32, 256, 1024, 2048});
+    vector<string> mode_names = {"astar", "bidir", "jps", "hpa", "bfs", "alt", "greedy"};
+    int count = 100, rounds = BENCH_ROUNDS, cluster = HPA_CLUSTER;
+    double density = BENCH_DENSITY;
+    string format = "csv", out_file;
+
+    for (int i = 1; i < argc; ++i) {
+        string opt, val;
+        if (!read_option(argc, argv, &i, &opt, &val)) {
+            return -1;
+        }
+        if (common_option(opt, val, &opts)) {
+            continue;
+        }
+        if (opt == "--suite") {
+            if (val == "quick") {
+                opts.sizes = {32, 256};
+                count = 50;
+                rounds = 1;
+            } else if (val == "default") {
+                opts.sizes = {32, 256, 1024, 2048};
+                count = 100;
+                rounds = BENCH_ROUNDS;
+            } else if (val == "large") {                        // 16k needs about 10 GB of search state
+                opts.sizes = {4096, 8192, 16384};
+                count = 20;
+                rounds = 1;
+            } else {
+                cerr << "Unknown suite: " << val << "\n";
+                return -1;
+            }
+        } else if (opt == "--modes") {
+            mode_names = split_list(val);
+        } else if (opt == "--queries") {
+            count = stoi(val);
+        } else if (opt == "--rounds") {
+            rounds = max(1, stoi(val));
+        } else if (opt == "--density") {
+            density = stod(val);
+        } else if (opt == "--cluster") {
+            cluster = stoi(val);
+        } else if (opt == "--format") {
+            format = val;
+        } else if (opt == "--out") {
+            out_file = val;
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+
+    vector<_mode_name> modes;
+    for (string &name : mode_names) {
+        size_t k = 0;
+        while ((k < sizeof(modes_known) / sizeof(modes_known[0])) && (name != modes_known[k].name)) {
+            ++k;
+        }
+        if (k == sizeof(modes_known) / sizeof(modes_known[0])) {
+            cerr << "Unknown search mode: " << name << "\n";
+            return -1;
+        }
+        modes.push_back(modes_known[k]);
+    }
+    if (!kinds_known(opts)) {
+        return -1;
+    }
+    if ((format != "csv") && (format != "json")) {
+        cerr << "Unknown format: " << format << "\n";
+        return -1;
+    }
+
+    ofstream file;
+    if (!out_file.empty()) {
+        file.open(out_file);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open file " << out_file << endl;
+            return -1;
+        }
+    }
+    ostream &out = out_file.empty() ? cout : file;
+    if (format == "csv") {
+        out << csv_header << "\n";
+    } else {
+        out << "{\"benchmark\": \"pathbench\", \"rows\": [";
+    }
+
+    int rows = 0;
+    for (int size : opts.sizes) {
+        for (string &name : opts.kinds) {
+            auto t0 = chrono::steady_clock::now();
+            _bench_map bm;
+            build_bench_map(name, size, opts.seed, density, count, &bm);
+            cerr << name << " " << size << "x" << size << ": generated in "
+                 << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s, "
+                 << bm.queries.size() << " queries" << endl;
+
+            for (_mode_name &m : modes) {
+                if ((m.mode == SEARCH_GREEDY) && (size > GREEDY_MAX_SIZE)) {
+                    continue;
+                }
+                _bench_row row;
+                row.kind = name;
+                row.size = size;
+                row.seed = opts.seed;
+                row.mode = m.name;
+                run_mode(bm.bu.get(), m.mode, bm.queries, rounds, cluster, &row);
+                if (format == "csv") {
+                    print_csv(out, row);
+                } else {
+                    out << (rows ? ",\n  " : "\n  ");
+                    print_json(out, row);
+                }
+                out.flush();
+                ++rows;
+                cerr << "  " << m.name << ": p50 " << row.p50_us << " us, p99 " << row.p99_us << " us, "
+                     << row.found << "/" << row.queries << " found" << endl;
+            }
+        }
+    }
+    if (format == "json") {
+        out << "\n]}\n";
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+/**
+ * @brief   Synthetic map file
+ * @details This file contains the seeded map generator of the benchmark. Every kind stresses
+ *          the searches differently: open sea has no obstacles at all, random obstacles break
+ *          up straight lines, mazes force paths far longer than the Manhattan distance,
+ *          archipelagos mix open water with land, and corridors make ships zigzag.
+ *
+ */
+#include <cmath>
+#include "mapgen.hpp"
+
+#define ARCHIPELAGO_LAND    0.30        // share of the map covered by islands
+#define MAZE_LOOPS          0.02        // share of maze walls knocked out to make loops
+#define CORRIDOR_PERIOD     8           // rows between two corridor walls
+#define CORRIDOR_GAP        2           // width of a gap in a corridor wall
+#define ISLAND_TILE         256         // tile side of a row generated archipelago
+
+static const char *kind_names[MAP_KINDS] = {"open", "random", "maze", "archipelago", "corridor"};
+
+/**
+ * @brief Function to look up a map kind by name
+ * @param name open, random, maze, archipelago or corridor
+ * @returns map kind, MAP_KINDS if the name is unknown
+ */
+_map_kind map_kind_of(string name) {
+    for (int k = 0; k < MAP_KINDS; ++k) {
+        if (name == kind_names[k]) {
+            return (_map_kind)k;
+        }
+    }
+    return MAP_KINDS;
+}
+
+/**
+ * @brief Function to fetch the name of a map kind
+ * @param kind map kind
+ * @returns name
+ */
+const char *map_kind_name(_map_kind kind) {
+    return ((kind >= 0) && (kind < MAP_KINDS)) ? kind_names[kind] : "unknown";
+}
+
+/**
+ * @brief Function to carve a maze with an iterative depth first backtracker. Maze
+ *        cells sit on odd coordinates, the cells between them are walls until the
+ *        walk knocks them out.
+ * @param size side of the map
+ * @param rng generator
+ * @param t terrain, all elevated on entry
+ */
+static void carve_maze(int size, bench_rng *rng, int8_t *t) {
+    int m = (size - 1) / 2;                                     // maze cells per side
+    if (m < 1) {
+        return;
+    }
+    vector<uint8_t> seen((size_t)m * m, 0);
+    vector<int> stack;
+    static const int dx[4] = {1, -1, 0, 0}, dy[4] = {0, 0, 1, -1};
+
+    stack.push_back(0);
+    seen[0] = 1;
+    t[(size_t)1 * size + 1] = (int8_t)GROUND_TERRAIN;
+    while (!stack.empty()) {
+        int c = stack.back(), cx = c / m, cy = c % m;
+        int open[4], n = 0;
+        for (int d = 0; d < 4; ++d) {
+            int nx = cx + dx[d], ny = cy + dy[d];
+            if ((nx >= 0) && (nx < m) && (ny >= 0) && (ny < m) && !seen[(size_t)nx * m + ny]) {
+                open[n++] = d;
+            }
+        }
+        if (n == 0) {                                           // dead end, back up
+            stack.pop_back();
+            continue;
+        }
+        int d = open[rng->below(n)];
+        int nx = cx + dx[d], ny = cy + dy[d];
+        seen[(size_t)nx * m + ny] = 1;
+        t[(size_t)(2 * cx + 1 + dx[d]) * size + (2 * cy + 1 + dy[d])] = (int8_t)GROUND_TERRAIN;
+        t[(size_t)(2 * nx + 1) * size + (2 * ny + 1)] = (int8_t)GROUND_TERRAIN;
+        stack.push_back(nx * m + ny);
+    }
+
+    // a perfect maze has one route between two cells; some loops make it a sea chart
+    long walls = (long)((double)m * m * MAZE_LOOPS);
+    for (long i = 0; i < walls; ++i) {
+        int x = 1 + (int)rng->below(2 * m - 1), y = 1 + (int)rng->below(2 * m - 1);
+        if ((x + y) % 2 == 1) {                                 // a wall between two maze cells
+            t[(size_t)x * size + y] = (int8_t)GROUND_TERRAIN;
+        }
+    }
+}
+
+/**
+ * @brief Function to raise islands until they cover ARCHIPELAGO_LAND of the map.
+ *        Radii are log uniform, so a few large islands stand among many small ones;
+ *        every island is a clump of up to four discs.
+ * @param size side of the map
+ * @param rng generator
+ * @param t terrain, all ground on entry
+ */
+static void raise_islands(int size, bench_rng *rng, int8_t *t) {
+    double r_min = 1.5, r_max = max(3.0, size / 16.0);
+    double land = 0, goal = ARCHIPELAGO_LAND * (double)size * size;
+    while (land < goal) {
+        double cx = rng->unit() * size, cy = rng->unit() * size;
+        int discs = 1 + (int)rng->below(4);
+        for (int d = 0; d < discs; ++d) {
+            double r = r_min * pow(r_max / r_min, rng->unit());
+            double ox = cx + (rng->unit() - 0.5) * r, oy = cy + (rng->unit() - 0.5) * r;
+            int x0 = max(0, (int)(ox - r)), x1 = min(size - 1, (int)(ox + r));
+            int y0 = max(0, (int)(oy - r)), y1 = min(size - 1, (int)(oy + r));
+            for (int x = x0; x <= x1; ++x) {
+                for (int y = y0; y <= y1; ++y) {
+                    if ((x - ox) * (x - ox) + (y - oy) * (y - oy) <= r * r) {
+                        t[(size_t)x * size + y] = (int8_t)ELEVATED_TERRAIN;
+                    }
+                }
+            }
+            land += M_PI * r * r;                               // overlaps count twice, close enough
+        }
+    }
+}
+
+/**
+ * @brief Function to build land walls every CORRIDOR_PERIOD rows. Each wall has one
+ *        to three gaps at random places, so a route crosses the map in a zigzag.
+ * @param size side of the map
+ * @param rng generator
+ * @param t terrain, all ground on entry
+ */
+static void build_corridors(int size, bench_rng *rng, int8_t *t) {
+    for (int x = CORRIDOR_PERIOD - 1; x < size - 1; x += CORRIDOR_PERIOD) {
+        int8_t *row = t + (size_t)x * size;
+        for (int y = 0; y < size; ++y) {
+            row[y] = (int8_t)ELEVATED_TERRAIN;
+        }
+        int gaps = 1 + (int)rng->below(3);
+        for (int g = 0; g < gaps; ++g) {
+            int y0 = (int)rng->below(max(1, size - CORRIDOR_GAP));
+            for (int y = y0; (y < y0 + CORRIDOR_GAP) && (y < size); ++y) {
+                row[y] = (int8_t)GROUND_TERRAIN;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function to generate a square synthetic map
+ * @param kind map kind
+ * @param size side of the map in cells
+ * @param seed generator seed, the same seed gives the same map
+ * @param density share of elevated cells for MAP_RANDOM, 0..1
+ * @param terrain pointer to vector receiving size * size _f_type bytes, index x * size + y
+ */
+void generate_map(_map_kind kind, int size, uint64_t seed, double density, vector<int8_t> *terrain) {
+    size_t cells = (size_t)size * size;
+    bench_rng rng(seed * 0x100000001b3ULL + kind);
+    terrain->assign(cells, (int8_t)((kind == MAP_MAZE) ? ELEVATED_TERRAIN : GROUND_TERRAIN));
+    int8_t *t = terrain->data();
+
+    if (kind == MAP_RANDOM) {
+        double p = min(max(density, 0.0), 0.999999);
+        uint64_t cut = (uint64_t)(p * 18446744073709551615.0);
+        for (size_t i = 0; i < cells; ++i) {
+            t[i] = (int8_t)((rng.next() < cut) ? ELEVATED_TERRAIN : GROUND_TERRAIN);
+        }
+    } else if (kind == MAP_MAZE) {
+        carve_maze(size, &rng, t);
+    } else if (kind == MAP_ARCHIPELAGO) {
+        raise_islands(size, &rng, t);
+    } else if (kind == MAP_CORRIDOR) {
+        build_corridors(size, &rng, t);
+    }
+}
+
+/**
+ * @brief Method to raise the islands of one tile row and cut them into row spans.
+ *        Each tile gets its own generator, so a tile looks the same whichever
+ *        rows are asked for.
+ * @param b tile row
+ *
+ */
+void row_generator::raise_band(int b) {
+    spans.assign(ISLAND_TILE, vector<_span>());
+    band = b;
+    int tiles = (size + ISLAND_TILE - 1) / ISLAND_TILE;
+    double r_min = 1.5, r_max = ISLAND_TILE / 16.0;
+    for (int t = 0; t < tiles; ++t) {
+        bench_rng rng((seed * 0x100000001b3ULL + kind) ^ (((uint64_t)b << 32) | (uint64_t)t));
+        int bx = b * ISLAND_TILE, by = t * ISLAND_TILE;
+        int bx1 = min(size, bx + ISLAND_TILE) - 1, by1 = min(size, by + ISLAND_TILE) - 1;
+        double land = 0, goal = ARCHIPELAGO_LAND * ISLAND_TILE * ISLAND_TILE;
+        while (land < goal) {
+            double cx = bx + rng.unit() * ISLAND_TILE, cy = by + rng.unit() * ISLAND_TILE;
+            int discs = 1 + (int)rng.below(4);
+            for (int d = 0; d < discs; ++d) {
+                double r = r_min * pow(r_max / r_min, rng.unit());
+                double ox = cx + (rng.unit() - 0.5) * r, oy = cy + (rng.unit() - 0.5) * r;
+                for (int x = max(bx, (int)(ox - r)); x <= min(bx1, (int)(ox + r)); ++x) {
+                    double w = r * r - (x - ox) * (x - ox);
+                    if (w < 0) {
+                        continue;
+                    }
+                    int y0 = max(by, (int)ceil(oy - sqrt(w))), y1 = min(by1, (int)floor(oy + sqrt(w)));
+                    if (y0 <= y1) {
+                        spans[x - bx].push_back({y0, y1});
+                    }
+                }
+                land += M_PI * r * r;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Method to generate one row; rows are cheapest in increasing order
+ * @param x row index
+ * @param out size _f_type bytes
+ *
+ */
+void row_generator::row(int x, int8_t *out) {
+    fill(out, out + size, (int8_t)GROUND_TERRAIN);
+    bench_rng rng((seed * 0x100000001b3ULL + kind) ^ ((uint64_t)x << 32));
+    if (kind == MAP_RANDOM) {
+        double p = min(max(density, 0.0), 0.999999);
+        uint64_t cut = (uint64_t)(p * 18446744073709551615.0);
+        for (int y = 0; y < size; ++y) {
+            out[y] = (int8_t)((rng.next() < cut) ? ELEVATED_TERRAIN : GROUND_TERRAIN);
+        }
+    } else if (kind == MAP_ARCHIPELAGO) {
+        if (x / ISLAND_TILE != band) {
+            raise_band(x / ISLAND_TILE);
+        }
+        for (const _span &sp : spans[x % ISLAND_TILE]) {
+            fill(out + sp.y0, out + sp.y1 + 1, (int8_t)ELEVATED_TERRAIN);
+        }
+    } else if ((kind == MAP_CORRIDOR) && (x % CORRIDOR_PERIOD == CORRIDOR_PERIOD - 1) && (x < size - 1)) {
+        fill(out, out + size, (int8_t)ELEVATED_TERRAIN);
+        int gaps = 1 + (int)rng.below(3);
+        for (int g = 0; g < gaps; ++g) {
+            int y0 = (int)rng.below(max(1, size - CORRIDOR_GAP));
+            fill(out + y0, out + min(size, y0 + CORRIDOR_GAP), (int8_t)GROUND_TERRAIN);
+        }
+    }
+}
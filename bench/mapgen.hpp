@@ -0,0 +1,112 @@
+#ifndef _MAPGEN_
+#define _MAPGEN_
+
+#include <string>
+#include "definitions.hpp"
+
+/**
+ * @brief ENUMs for the synthetic map kinds
+ *
+ */
+typedef enum MAP_KIND {
+    MAP_OPEN = 0,                   // open sea, no land at all
+    MAP_RANDOM = 1,                 // every cell elevated with a fixed probability
+    MAP_MAZE = 2,                   // one cell wide channels between one cell walls, a few loops
+    MAP_ARCHIPELAGO = 3,            // round islands of mixed sizes
+    MAP_CORRIDOR = 4,               // long land walls with a few gaps, ships zigzag through
+    MAP_KINDS = 5
+} _map_kind;
+
+/**
+ * @brief Small deterministic generator (splitmix64). The sequence only depends on
+ *        the seed, unlike the std distributions, so a seed names the same map and
+ *        the same queries on every platform.
+ *
+ */
+class bench_rng {
+    private:
+        uint64_t state;
+    public:
+        bench_rng(uint64_t seed) : state(seed) {}
+
+        uint64_t next(void) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+        uint32_t below(uint32_t n) { return (uint32_t)(next() % n); }
+        double unit(void) { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+/**
+ * @brief Function to look up a map kind by name
+ * @param name open, random, maze, archipelago or corridor
+ * @returns map kind, MAP_KINDS if the name is unknown
+ */
+_map_kind map_kind_of(string name);
+
+/**
+ * @brief Function to fetch the name of a map kind
+ * @param kind map kind
+ * @returns name
+ */
+const char *map_kind_name(_map_kind kind);
+
+/**
+ * @brief Function to generate a square synthetic map
+ * @param kind map kind
+ * @param size side of the map in cells
+ * @param seed generator seed, the same seed gives the same map
+ * @param density share of elevated cells for MAP_RANDOM, 0..1
+ * @param terrain pointer to vector receiving size * size _f_type bytes, index x * size + y
+ */
+void generate_map(_map_kind kind, int size, uint64_t seed, double density, vector<int8_t> *terrain);
+
+/**
+ * @class row_generator
+ * @brief Generates a square synthetic map one row at a time, for maps too large to
+ *        hold whole. Open, random and corridor rows follow from the seed and the row
+ *        index alone. Archipelago islands are raised per ISLAND_TILE square tile and
+ *        clipped to it, and only the island spans of the current tile row are kept.
+ *        Mazes are carved whole and have no row form. Rows differ from
+ *        generate_map() with the same seed.
+ */
+class row_generator {
+    private:
+        typedef struct SPAN {
+            int y0;                         // first land column
+            int y1;                         // last land column
+        } _span;
+
+        _map_kind kind;
+        int size;
+        uint64_t seed;
+        double density;
+        int band;                           // tile row whose spans are held, -1 if none
+        vector<vector<_span>> spans;        // land spans of each row of the band
+
+        void raise_band(int b);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param k map kind, not MAP_MAZE
+         * @param n side of the map in cells
+         * @param s generator seed
+         * @param d share of elevated cells for MAP_RANDOM, 0..1
+         *
+         */
+        row_generator(_map_kind k, int n, uint64_t s, double d)
+            : kind(k), size(n), seed(s), density(d), band(-1) {}
+
+        /**
+         * @brief Method to generate one row; rows are cheapest in increasing order
+         * @param x row index
+         * @param out size _f_type bytes
+         *
+         */
+        void row(int x, int8_t *out);
+};
+
+#endif //_MAPGEN_
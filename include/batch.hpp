@@ -0,0 +1,149 @@
+#ifndef _BATCH_
+#define _BATCH_
+
+#include <atomic>
+#include <istream>
+#include "definitions.hpp"
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "pathfinding.hpp"
+#include "hpa.hpp"
+#include "bitbfs.hpp"
+#include "landmarks.hpp"
+#include "path_cache.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Struct to store one routing query
+ *
+ */
+typedef struct QUERY {
+    _points start;                  // start position
+    _points target;                 // target position
+} _query;
+
+/**
+ * @brief Struct to store the answer to one routing query
+ *
+ */
+typedef struct QUERY_RESULT {
+    int found;                      // 1 if a valid path is found, 0 if no path
+    vector<_points> path;           // path points, start first
+} _query_result;
+
+/**
+ * @brief Function to read routing queries, one "sx sy tx ty" per line.
+ *        Empty lines and lines starting with '#' are skipped.
+ * @param in stream to read from
+ * @param queries pointer to vector receiving the queries
+ * @returns 1 if succeeded, 0 if a line could not be parsed
+ */
+int read_queries(istream &in, vector<_query> *queries);
+
+/**
+ * @brief Struct to keep landmark tables together with the terrain snapshot they were
+ *        built on in the background
+ *
+ */
+typedef struct LANDMARK_BUILD {
+    vector<int8_t> terrain;         // copy of the terrain when the rebuild started
+    unique_ptr<battleship> map;     // battleship over the copy, components built
+    unique_ptr<landmark_set> set;   // tables built on the copy
+} _landmark_build;
+
+/**
+ * @class batch_engine
+ * @brief Solves many start/target pairs against one loaded map on a work
+ *        stealing thread pool. The map is only read; every worker has its own
+ *        search_state, so no search state is shared between threads.
+ */
+class batch_engine {
+    private:
+        battleship *bu;                     // loaded map, read only during a run
+        _search_mode mode;                  // search mode for every query
+        thread_pool pool;                   // workers
+        vector<search_state> scratch;       // per-worker search state
+        vector<search_state> back_scratch;  // per-worker backward state for SEARCH_BIDIR
+        vector<long> expanded;              // per-worker nodes expanded since the engine was made
+        vector<_search_counters> counters;  // per-worker search events since the engine was made
+        unique_ptr<hpa_graph> hierarchy;    // abstract graph, built for SEARCH_HPA only
+        vector<hpa_state> hpa_scratch;      // per-worker HPA* state
+        unique_ptr<bit_grid> bits;          // bit-packed rows, built for SEARCH_BFS only
+        vector<bfs_state> bfs_scratch;      // per-worker BFS state
+        atomic<shared_ptr<const landmark_set>> landmarks;   // landmark tables for SEARCH_ALT, NULL while stale
+        mutex landmark_lock;                // orders invalidations against installing a rebuild, guards rebuild_thread
+        long landmark_epoch;                // cleared cells so far, guarded by landmark_lock
+        atomic<bool> rebuilding;            // a background rebuild is running, set under landmark_lock
+        thread rebuild_thread;              // background rebuild, joined before the next one
+        unique_ptr<path_cache> cache;       // solved paths, NULL without a cache budget
+        vector<vector<int>> cache_cells;    // per-worker cells of a cached or new path
+        int chunk;                          // queries per task
+        int landmark_count;                 // landmarks asked for, kept for rebuilds
+
+        void search(int worker, int start, int target, _query_result *res);
+        void rebuild_landmarks(void);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param b pointer to the battleship holding the map
+         * @param threads number of workers, 0 for one per hardware thread
+         * @param m search mode, SEARCH_ASTAR, SEARCH_JPS, SEARCH_HPA, SEARCH_BIDIR, SEARCH_BFS or SEARCH_ALT
+         * @param cluster HPA* cluster side, the graph is built here for SEARCH_HPA
+         * @param cache_bytes memory budget of the path cache, 0 for no cache
+         * @param k number of landmarks, the tables are built here for SEARCH_ALT
+         *
+         */
+        batch_engine(battleship *b, int threads, _search_mode m, int cluster = HPA_CLUSTER, size_t cache_bytes = 0,
+                     int k = ALT_LANDMARKS);
+        ~batch_engine();
+
+        /**
+         * @brief Method to solve a batch of queries
+         * @param queries queries to solve
+         * @param results pointer to vector receiving one result per query, in input order
+         *
+         */
+        void run(const vector<_query> &queries, vector<_query_result> *results);
+
+        /**
+         * @brief Method to solve one query on the calling thread's behalf
+         * @param worker worker id, selects the search state
+         * @param q query to solve
+         * @param res pointer to the result
+         *
+         */
+        void solve(int worker, const _query &q, _query_result *res);
+
+        /**
+         * @brief Method to queue a task on the engine's workers, for callers that serve
+         *        queries one at a time through solve()
+         * @param task callable taking the worker id
+         *
+         */
+        void submit(function<void(int)> task) { pool.submit(move(task)); }
+
+        /**
+         * @brief Method to refresh the shared search structures after a terrain change.
+         *        Call it after battleship::set_terrain() for every changed cell, with no
+         *        query running. A blocked cell only lengthens distances, so the landmark
+         *        bounds stay admissible and consistent. A cleared cell can shorten them:
+         *        the tables are dropped, ALT queries run on Manhattan distance, and a
+         *        background thread rebuilds the tables on a copy of the terrain and swaps
+         *        them in. A cell cleared during the rebuild discards it, and the next ALT
+         *        query starts another. The call itself copies the terrain, one byte per cell.
+         * @param cell cell index
+         *
+         */
+        void update_cell(int cell);
+
+        int get_threads(void) const { return pool.size(); }
+        long get_expanded(void) const;
+        _search_counters get_counters(void) const;
+        const hpa_graph *get_hierarchy(void) const { return hierarchy.get(); }
+        shared_ptr<const landmark_set> get_landmarks(void) const { return landmarks.load(); }
+        path_cache *get_cache(void) const { return cache.get(); }
+};
+
+#endif //_BATCH_
@@ -0,0 +1,131 @@
+#ifndef _BITBFS_
+#define _BITBFS_
+
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+#define BFS_WORD_BITS   64          // cells per bitboard word
+
+/**
+ * @class bfs_state
+ * @brief Per-query scratch of bit_grid. The bit arrays hold one bit per cell in the
+ *        row layout of bit_grid; front and next are all zero between sweeps, so a
+ *        sweep only clears the reached bits.
+ */
+class bfs_state {
+    public:
+        vector<uint64_t> seen;              // per word: cells reached by the last sweep
+        vector<uint64_t> front;             // per word: cells of the current layer
+        vector<uint64_t> next;              // per word: cells of the layer being built
+        vector<uint64_t> goal;              // per word: port cells of a nearest() query
+        vector<int> front_list;             // words with frontier bits, one slot per word
+        vector<int> next_list;              // words with bits of the next layer, one slot per word
+        vector<int> dist;                   // per cell: BFS layer, valid where the seen bit is set
+        vector<int> cells;                  // path of the last query, start first
+
+        long layers;                        // layers swept by the last query
+        long words;                         // frontier words expanded by the last query
+        long reached;                       // cells reached by the last query, source included
+        _search_counters counters;          // events of the last sweep, counted with PATH_STATS only
+
+        bfs_state() : layers(0), words(0), reached(0), counters() {}
+};
+
+/**
+ * @class bit_grid
+ * @brief Bit-parallel BFS over the battleship map. Passability is stored as bit rows,
+ *        64 cells per word, rows padded to whole words (bit y % 64 of word y / 64 of
+ *        row x). A sweep grows the wavefront one layer at a time with word operations:
+ *        the frontier word shifted by one bit, its carries into the neighbouring words
+ *        and the words of the rows above and below, ANDed with the passable bits and
+ *        masked by the cells already reached. Only words holding frontier bits are
+ *        visited, so a layer costs one step per 64 cells of a straight front. Every
+ *        cell gets its layer in a distance field, which serves path tracing, full
+ *        distance fields and nearest port queries.
+ *        Like hpa_graph the grid is read only during queries, so threads share it with
+ *        one bfs_state each. After a terrain change update_cell() refreshes the bit.
+ */
+class bit_grid {
+    private:
+        battleship *bu;                     // map
+        int rows;                           // rows, x_max
+        int y_max;                          // cells per row
+        int row_words;                      // words per row
+        vector<uint64_t> pass;              // per word: passable cells
+        uint64_t version;                   // map version the bits were last brought in line with
+
+        void prepare(bfs_state *st) const;
+        int sweep(bfs_state *st, int source, int target, bool use_goal) const;
+        int trace(bfs_state *st, int source, int cell) const;
+    public:
+        /**
+         * @brief Constructor for class. Packs the passability of the loaded map.
+         *
+         * @param b pointer to the battleship holding the map
+         *
+         */
+        bit_grid(battleship *b);
+
+        /**
+         * @brief Method to find a shortest path between two cells
+         * @param st per-query scratch, one per thread
+         * @param start start cell index
+         * @param target target cell index
+         * @returns number of path cells left in st->cells, start first, 0 if no path
+         *
+         */
+        int find_path(bfs_state *st, int start, int target) const;
+
+        /**
+         * @brief Method to compute the distance from one cell to every cell reachable
+         *        from it, read with get_distance()
+         * @param st per-query scratch, receives the field
+         * @param source source cell index
+         * @returns number of cells reached, 0 if the source is not passable
+         *
+         */
+        long distance_field(bfs_state *st, int source) const;
+
+        /**
+         * @brief Method to read the distance field of the last sweep
+         * @param st scratch of the sweep
+         * @param cell cell index
+         * @returns steps from the source, -1 if the sweep did not reach the cell
+         *
+         */
+        int get_distance(const bfs_state *st, int cell) const;
+
+        /**
+         * @brief Method to find the nearest reachable port. The sweep stops at the
+         *        first layer that reaches a port; ties go to the lowest cell index.
+         * @param st per-query scratch, receives the path to the port in st->cells
+         * @param source source cell index
+         * @param ports port cell indices
+         * @returns position of the nearest port in ports, -1 if none is reachable
+         *
+         */
+        int nearest(bfs_state *st, int source, const vector<int> &ports) const;
+
+        /**
+         * @brief Method to refresh the passability bit of a changed cell. Call it
+         *        after battleship::set_terrain() for every changed cell.
+         * @param cell cell index
+         *
+         */
+        void update_cell(int cell);
+
+        bool is_current(void) const { return version == bu->get_version(); }
+};
+
+/**
+ * @brief Function to find a path from start to target of the battleship with the
+ *        bit-parallel BFS. Packs a one-off bit_grid; keep a bit_grid around to
+ *        answer many queries.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_bfs(battleship *bu, vector<_points*> *sol);
+
+#endif //_BITBFS_
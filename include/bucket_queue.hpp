@@ -0,0 +1,156 @@
+#ifndef _BUCKET_QUEUE_
+#define _BUCKET_QUEUE_
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Struct to store one entry of a bucket_queue
+ *
+ */
+typedef struct BUCKET_ENTRY {
+    int value;                      // value stored with the key
+    int next;                       // entry below in the same bucket, or the next free entry
+} _bucket_entry;
+
+/**
+ * @class bucket_queue
+ * @brief Monotone bucket priority queue for small integer keys.
+ *        Buckets are kept in a power of two ring that only has to cover the
+ *        spread between the lowest and highest key in the queue, which is a
+ *        handful of buckets for unit cost A*. Each bucket is an intrusive list
+ *        through one entry pool, and popped entries go to a free list, so the
+ *        pool only holds as many entries as were in the queue at once. Push is
+ *        O(1) and pop is O(1) amortised. Entries with equal keys come out last
+ *        in, first out, which prefers the deeper node on ties. The ring and the
+ *        pool keep their capacity across clear() calls, and reserve() sizes
+ *        both up front so a search never allocates.
+ */
+class bucket_queue {
+    private:
+        vector<int> head;                   // first entry of every bucket, key k lives in head[k & mask], -1 if empty
+        vector<_bucket_entry> pool;         // entries of every bucket
+        int free_entry;                     // first free pool entry, -1 if none
+        int mask;                           // ring size - 1
+        int cur;                            // lowest key that can be non-empty
+        int hi;                             // highest key pushed since the queue was empty
+        size_t count;                       // number of entries
+
+        /**
+         * @brief Method to double the ring when the key spread no longer fits
+         *
+         */
+        void grow(void) {
+            vector<int> bigger(head.size() * 2, -1);
+            int new_mask = (int)bigger.size() - 1;
+            for (int k = cur; k <= hi; ++k) {
+                bigger[k & new_mask] = head[k & mask];
+            }
+            head.swap(bigger);
+            mask = new_mask;
+        }
+    public:
+        bucket_queue() : head(4, -1), free_entry(-1), mask(3), cur(0), hi(0), count(0) {}
+
+        /**
+         * @brief Method to make room up front so push() does not allocate
+         * @param spread largest difference between two keys in the queue at once
+         * @param entries most entries in the queue at once
+         *
+         */
+        void reserve(int spread, size_t entries) {
+            while (spread > mask) {
+                grow();
+            }
+            pool.reserve(entries);
+        }
+
+        /**
+         * @brief Method to add a value to the queue
+         * @param key integer priority, lower comes out first
+         * @param v value stored with the key
+         *
+         */
+        void push(int key, int v) {
+            if (count == 0) {
+                cur = hi = key;
+            }
+            int lo = (key < cur) ? key : cur;
+            int up = (key > hi) ? key : hi;
+            while (up - lo > mask) {
+                grow();
+            }
+            cur = lo; hi = up;
+            int e = free_entry;
+            if (e >= 0) {
+                free_entry = pool[e].next;
+            } else {
+                e = (int)pool.size();
+                pool.push_back(_bucket_entry());
+            }
+            pool[e].value = v;
+            pool[e].next = head[key & mask];
+            head[key & mask] = e;
+            ++count;
+        }
+
+        /**
+         * @brief Method to remove a value with the lowest key. Queue must not be empty.
+         * @param key optional pointer to return the key of the value
+         * @returns the value
+         *
+         */
+        int pop(int *key = nullptr) {
+            while (head[cur & mask] < 0) {
+                ++cur;
+            }
+            int e = head[cur & mask];
+            head[cur & mask] = pool[e].next;
+            pool[e].next = free_entry;
+            free_entry = e;
+            --count;
+            if (key) {
+                *key = cur;
+            }
+            return pool[e].value;
+        }
+
+        /**
+         * @brief Method to fetch the lowest key in the queue. Queue must not be empty.
+         *
+         */
+        int top_key(void) {
+            while (head[cur & mask] < 0) {
+                ++cur;
+            }
+            return cur;
+        }
+
+        /**
+         * @brief Method to fetch the value pop() returns next. Queue must not be empty.
+         *
+         */
+        int top_value(void) {
+            return pool[head[top_key() & mask]].value;
+        }
+
+        /**
+         * @brief Method to empty the queue but keep the ring and pool memory
+         *
+         */
+        void clear(void) {
+            if (count) {
+                fill(head.begin(), head.end(), -1);
+                count = 0;
+            }
+            pool.clear();
+            free_entry = -1;
+        }
+
+        bool empty(void) const { return count == 0; }
+        size_t size(void) const { return count; }
+};
+
+#endif //_BUCKET_QUEUE_
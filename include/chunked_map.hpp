@@ -0,0 +1,270 @@
+#ifndef _CHUNKED_MAP_
+#define _CHUNKED_MAP_
+
+#include <climits>
+#include <memory>
+#include <unordered_map>
+#include "definitions.hpp"
+#include "map_format.hpp"
+#include "pathfinding.hpp"
+
+#define CHUNK_SHIFT         7                           // log2 of the chunk side
+#define CHUNK_SIDE          (1 << CHUNK_SHIFT)          // cells per chunk side
+#define CHUNK_MASK          (CHUNK_SIDE - 1)
+#define CHUNK_CELLS         (CHUNK_SIDE * CHUNK_SIDE)   // cells per chunk
+#define CHUNK_BYTES         (CHUNK_CELLS / 4)           // 2 bits per cell, one page
+#define CHUNK_CACHE_MB      64                          // default chunk cache budget
+#define CHUNK_SCRATCH_MB    1024                        // default search scratch budget
+
+/**
+ * @class chunk_writer
+ * @brief Writes a chunked binary map one terrain row at a time, so a map far larger
+ *        than memory can be written from a generator or another file. The terrain is
+ *        cut into CHUNK_SIDE x CHUNK_SIDE chunks of 2-bit cells (codes as in
+ *        MAP_ENC_2BIT), stored chunk row by chunk row, each chunk row major. Only one
+ *        band of CHUNK_SIDE rows is held. Cells past the map edge are elevated, so a
+ *        search never steps onto the padding of the last chunks.
+ */
+class chunk_writer {
+    private:
+        FILE *fp;                           // output file
+        _map_header head;                   // header, written again by close()
+        int chunk_cols;                     // chunks per chunk row
+        int row;                            // rows added
+        vector<uint8_t> band;               // chunk_cols chunks of the current band
+        uint64_t checksum;                  // checksum of the chunks written so far
+
+        int flush_band(void);
+    public:
+        chunk_writer() : fp(NULL), head(), chunk_cols(0), row(0), checksum(MAP_CHECKSUM_SEED) {}
+        ~chunk_writer() { if (fp) fclose(fp); }
+        chunk_writer(const chunk_writer &) = delete;
+        chunk_writer &operator=(const chunk_writer &) = delete;
+
+        /**
+         * @brief Method to create the file and write a provisional header
+         * @param f_name string containing output file path
+         * @param x_max map rows
+         * @param y_max map columns
+         * @param start pointer to start position, x_pos -1 if none
+         * @param target pointer to target position, x_pos -1 if none
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int open(string f_name, int x_max, int y_max, _field *start, _field *target);
+
+        /**
+         * @brief Method to add the next terrain row
+         * @param terrain y_max _f_type bytes
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int add_row(const int8_t *terrain);
+
+        /**
+         * @brief Method to change the start and target close() writes, e.g. once a
+         *        generator has seen the rows
+         * @param start pointer to start position, x_pos -1 if none
+         * @param target pointer to target position, x_pos -1 if none
+         *
+         */
+        void set_endpoints(_field *start, _field *target) {
+            head.start_x = start->x_pos;
+            head.start_y = (start->x_pos < 0) ? -1 : start->y_pos;
+            head.target_x = target->x_pos;
+            head.target_y = (target->x_pos < 0) ? -1 : target->y_pos;
+        }
+
+        /**
+         * @brief Method to write the last band and the final header and close the file.
+         *        All x_max rows must have been added.
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int close(void);
+};
+
+/**
+ * @class chunked_map
+ * @brief Out-of-core map on a chunked binary map file. Chunks are read with pread()
+ *        on first use into a fixed pool and kept in LRU order; when the pool is full
+ *        the least recently used chunk is dropped. Memory stays at the budget however
+ *        large the map is. The last chunk looked up is remembered, so runs of lookups
+ *        in one chunk skip the hash and the LRU list. Pointers from chunk() are only
+ *        valid until the next lookup. Not thread safe.
+ */
+class chunked_map {
+    private:
+        int fd;                             // map file
+        _map_header head;                   // copy of the file header
+        int chunk_rows;                     // chunks per map column
+        int chunk_cols;                     // chunks per map row
+        int slots;                          // chunks the pool holds
+        unique_ptr<uint8_t[]> pool;         // slots * CHUNK_BYTES, left untouched until used
+        vector<int> slot_chunk;             // chunk held by each slot, -1 if free
+        vector<int> prev;                   // LRU list, more recently used neighbour
+        vector<int> next;                   // LRU list, less recently used neighbour
+        int mru;                            // most recently used slot, -1 if none
+        int lru;                            // least recently used slot, -1 if none
+        int used;                           // slots in use
+        unordered_map<int, int> where;      // chunk -> slot
+        int last_chunk;                     // chunk of the last lookup, -1 if none
+        const uint8_t *last_data;           // its terrain
+        _chunk_stats stats;                 // cache counters
+
+        const uint8_t *lookup(int chunk);
+        void unlink(int slot);
+        void push_front(int slot);
+    public:
+        chunked_map();
+        ~chunked_map();
+        chunked_map(const chunked_map &) = delete;
+        chunked_map &operator=(const chunked_map &) = delete;
+
+        /**
+         * @brief Method to open a chunked map file. Only the header is read.
+         * @param f_name string containing map file path
+         * @param cache_bytes chunk cache budget, at least a few chunks are kept
+         * @param verify 1 to stream the file once and check the terrain checksum
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int open(string f_name, size_t cache_bytes, int verify);
+
+        /**
+         * @brief Method to fetch the terrain of a chunk, reading it on a miss
+         * @param chunk chunk index, chunk row * chunk columns + chunk column
+         * @returns CHUNK_BYTES of 2-bit cells, valid until the next lookup
+         *
+         */
+        const uint8_t *chunk(int chunk) {
+            if (chunk == last_chunk) {
+                ++stats.hits;
+                return last_data;
+            }
+            return lookup(chunk);
+        }
+
+        /**
+         * @brief Method to check if a cell can be entered
+         * @param x cell row, may be outside the map
+         * @param y cell column, may be outside the map
+         * @returns false for elevated cells and cells outside the map
+         *
+         */
+        bool is_passable(int x, int y) {
+            if (((unsigned)x >= (unsigned)head.x_max) || ((unsigned)y >= (unsigned)head.y_max)) {
+                return false;
+            }
+            const uint8_t *d = chunk((x >> CHUNK_SHIFT) * chunk_cols + (y >> CHUNK_SHIFT));
+            int local = ((x & CHUNK_MASK) << CHUNK_SHIFT) | (y & CHUNK_MASK);
+            return ((d[local >> 2] >> ((local & 3) * 2)) & 3) != 1;
+        }
+
+        const _map_header *get_header(void) const { return &head; }
+        int get_x_max(void) const { return head.x_max; }
+        int get_y_max(void) const { return head.y_max; }
+        int get_chunk_cols(void) const { return chunk_cols; }
+        _chunk_stats get_stats(void) const {
+            _chunk_stats s = stats;
+            s.resident = used;
+            s.budget = (long)slots * CHUNK_BYTES;
+            return s;
+        }
+};
+
+/**
+ * @class chunk_scratch
+ * @brief Search state for a chunked map, allocated per touched chunk. A chunk's block
+ *        holds the g cost and parent direction of each of its cells and is only
+ *        created when a search first reaches the chunk, so a search pays for the
+ *        chunks it touches, not for the map. Blocks are kept and reused by the next
+ *        search. A node is named by its block slot and its cell offset in the chunk,
+ *        slot << (2 * CHUNK_SHIFT) | offset, which fits in the int values of the
+ *        bucket queue. The blocks stop at a memory budget.
+ */
+class chunk_scratch {
+    public:
+        typedef struct SCRATCH_CHUNK {
+            int cx;                         // chunk row
+            int cy;                         // chunk column
+            int g[CHUNK_CELLS];             // cost from the start, INT_MAX if not reached
+            uint8_t from[CHUNK_CELLS];      // SCRATCH_* flags and the direction of the step into the cell
+        } _scratch_chunk;
+
+        bucket_queue open_list;             // open list, values are node names
+        long expanded;                      // nodes expanded by the last search
+    private:
+        vector<unique_ptr<_scratch_chunk>> blocks;  // allocated blocks, the first used in this search
+        int used;                           // blocks in use by this search
+        int max_blocks;                     // blocks the budget allows
+        int peak;                           // most blocks one search used
+        unordered_map<int, int> where;      // chunk -> slot for this search
+        int chunk_cols;                     // chunks per map row of the searched map
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param budget_bytes memory the blocks may take
+         *
+         */
+        chunk_scratch(size_t budget_bytes);
+
+        /**
+         * @brief Method to start a new search; blocks are kept for reuse
+         * @param cols chunks per map row of the map to search
+         *
+         */
+        void reset(int cols);
+
+        /**
+         * @brief Method to fetch the slot of a chunk, creating its block on first touch
+         * @param cx chunk row
+         * @param cy chunk column
+         * @returns slot, -1 if the budget is used up
+         *
+         */
+        int slot(int cx, int cy);
+
+        /**
+         * @brief Method to fetch the slot of a chunk without creating it
+         * @param cx chunk row
+         * @param cy chunk column
+         * @returns slot, -1 if the search did not touch the chunk
+         *
+         */
+        int find(int cx, int cy) const {
+            auto it = where.find(cx * chunk_cols + cy);
+            return (it == where.end()) ? -1 : it->second;
+        }
+
+        _scratch_chunk *block(int slot) { return blocks[slot].get(); }
+        int get_peak(void) const { return peak; }
+        size_t get_bytes(void) const { return blocks.size() * sizeof(_scratch_chunk); }
+};
+
+/**
+ * @brief Function to write the map of a battleship as a chunked binary map file
+ * @param f_name string containing output file path
+ * @param bu pointer to the battleship holding the map
+ * @param start pointer to start position, x_pos -1 if none
+ * @param target pointer to target position, x_pos -1 if none
+ * @returns 1 if succeeded, 0 if failed
+ */
+int write_map_chunked(string f_name, battleship *bu, _field *start, _field *target);
+
+/**
+ * @brief Function to run A* on a chunked map. Terrain comes from the chunk cache and
+ *        the search state from per-chunk scratch blocks, so memory is bounded by the
+ *        two budgets rather than by the map size. Neighbours are visited in the order
+ *        of astar_search() and ties break the same way, so paths match it.
+ * @param map chunked map
+ * @param sc scratch for the search, reset by the call
+ * @param start start cell
+ * @param target target cell
+ * @param path pointer to vector receiving the path points, start first
+ * @returns 1 if a path is found, 0 if no path, -1 if the scratch budget ran out
+ */
+int chunked_search(chunked_map *map, chunk_scratch *sc, _points start, _points target, vector<_points> *path);
+
+#endif //_CHUNKED_MAP_
@@ -0,0 +1,107 @@
+#ifndef _COMPONENTS_
+#define _COMPONENTS_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class component_index
+ * @brief Connected component labels of the passable cells of a terrain map, used
+ *        to reject a query in O(1) when start and target can not reach each other.
+ *        Every passable cell carries a label; labels are joined by a union-find, so
+ *        the component of a cell is the root of its label. The labels are built in
+ *        one scanline pass and are then updated cell by cell:
+ *        - a cell becoming passable unions the labels of its neighbours,
+ *        - a cell becoming elevated starts one BFS per neighbour, expanded in turns.
+ *          BFSs that meet belong to the same side. The race stops once at most one
+ *          side is still growing, so only the smaller sides are walked and get new
+ *          labels; a removal that splits nothing stops as soon as the BFSs meet.
+ *        Lookups do not modify the index and may run from many threads; updates
+ *        must not run concurrently with lookups.
+ */
+class component_index {
+    private:
+        const int8_t *terrain;              // terrain of the map, one _f_type per cell
+        int x_max;                          // maximum x distance
+        int y_max;                          // maximum y distance
+        vector<int32_t> label;              // per cell: label, -1 for elevated cells
+        vector<int32_t> uf;                 // per label: parent label, roots point to themselves
+        vector<int32_t> weight;             // per label: number of labels in the tree of a root
+        int count;                          // number of components
+        vector<uint32_t> mark;              // per cell: race generation that reached it
+        vector<uint8_t> owner;              // per cell: race BFS that reached it
+        uint32_t gen;                       // current race generation
+        long walked;                        // cells walked by all races
+
+        int root(int l) const {
+            while (uf[l] != l) {
+                l = uf[l];
+            }
+            return l;
+        }
+        int root_compress(int l) {
+            while (uf[l] != l) {
+                uf[l] = uf[uf[l]];
+                l = uf[l];
+            }
+            return l;
+        }
+        int new_label(void) {
+            uf.push_back((int32_t)uf.size());
+            weight.push_back(1);
+            return (int)uf.size() - 1;
+        }
+        int unite(int a, int b);
+        int passable_neighbours(int idx, int out[4]) const;
+        void add_cell(int idx);
+        void remove_cell(int idx);
+    public:
+        component_index() : terrain(NULL), x_max(0), y_max(0), count(0), gen(0), walked(0) {}
+
+        /**
+         * @brief Method to label all passable cells of a map
+         * @param t terrain of the map, must stay valid while the index is used
+         * @param x max x units
+         * @param y max y units
+         *
+         */
+        void build(const int8_t *t, int x, int y);
+
+        /**
+         * @brief Method to drop the labels, e.g. when the whole terrain is replaced
+         *
+         */
+        void clear(void) { label.clear(); uf.clear(); weight.clear(); count = 0; }
+
+        /**
+         * @brief Method to bring the labels in line with the terrain of one changed cell
+         * @param idx cell index
+         *
+         */
+        void update(int idx);
+
+        /**
+         * @brief Method to look up the component of a cell
+         * @param idx cell index
+         * @returns component id, -1 for an elevated cell. Ids change with updates.
+         *
+         */
+        int component(int idx) const { return (label[idx] < 0) ? -1 : root(label[idx]); }
+
+        /**
+         * @brief Method to check if two cells can reach each other
+         * @param a cell index
+         * @param b cell index
+         *
+         */
+        bool connected(int a, int b) const { return (label[a] >= 0) && (label[b] >= 0) && (root(label[a]) == root(label[b])); }
+
+        bool built(void) const { return !label.empty(); }
+        int get_count(void) const { return count; }
+        long get_walked(void) const { return walked; }
+};
+
+#endif //_COMPONENTS_
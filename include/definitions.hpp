@@ -1,40 +1,47 @@
 #ifndef _DEFINITIONS_
 #define _DEFINITIONS_
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include "rapidjson/document.h"
+#include "bucket_queue.hpp"
+#include "components.hpp"
+#include "stats.hpp"
 
 using namespace std;
 using namespace rapidjson;
 
 /**
  * @brief ENUMs for visited member for the field/node
- * 
+ *
  */
 enum VISITED_STAT {
     NOT_VISITED=0,
-    DEAD_END=-1
+    DEAD_END=-1,
+    CLOSED=-2                       // expanded by a best-first search
 };
 
 /**
  * @brief ENUMs for status of a field
- * 
+ *
  */
 typedef enum F_TYPE {
     GROUND_TERRAIN = -1,
     BU_TARGET = 0,
     ELEVATED_TERRAIN = 3,
     BU_START = 8
-} _f_type; 
+} _f_type;
 
 /**
  * @brief Struct to store the field/node information
- * 
+ *
  */
 typedef struct FIELD {
-    int x_pos;                      // x index in the array  
+    int x_pos;                      // x index in the array
     int y_pos;                      // y index in the array
     _f_type field_stat;             // status of the node
     int cost_to_dest;               // cost till destination
@@ -43,6 +50,96 @@ typedef struct FIELD {
     bool marked_path;               // flag to mark if the node is part of the path
 } _field;
 
+/**
+ * @class search_state
+ * @brief Per-search scratch arrays for one map, indexed by cell index (x * y_max + y).
+ *        A cell's entries are only valid while its stamp matches the current
+ *        generation, so reset() starts a new search in O(1) without touching
+ *        the arrays. Cells are lazily initialised on first touch.
+ */
+class search_state {
+    private:
+        uint32_t generation;                // current search generation
+        vector<uint32_t> stamp;             // generation in which a cell was last touched
+    public:
+        vector<int> visited;                // visit flag (battle unit number or DEAD_END)
+        vector<int> g_cost;                 // cost from source found so far
+        vector<int> parent;                 // parent cell index, -1 for none
+        vector<uint8_t> marked_path;        // flag to mark if the cell is part of the path
+        bucket_queue open_list;             // open list for best-first searches
+        long expanded;                      // nodes expanded by the last search
+        _search_counters counters;          // events of the last search, counted with PATH_STATS only
+
+        search_state() : generation(1), expanded(0), counters() {}
+
+        /**
+         * @brief Method to size the scratch arrays for a map
+         * @param cells number of cells in the map
+         *
+         */
+        void resize(size_t cells) {
+            stamp.assign(cells, 0);
+            visited.resize(cells);
+            g_cost.resize(cells);
+            parent.resize(cells);
+            marked_path.resize(cells);
+            generation = 1;
+            open_list.clear();
+            expanded = 0;
+            counters = {};
+        }
+
+        /**
+         * @brief Method to invalidate all entries. The stamps are only cleared
+         *        when the generation counter wraps around.
+         *
+         */
+        void reset(void) {
+            if (++generation == 0) {
+                fill(stamp.begin(), stamp.end(), 0);
+                generation = 1;
+            }
+            open_list.clear();
+            expanded = 0;
+#ifdef PATH_STATS
+            counters = {};
+#endif
+        }
+
+        /**
+         * @brief Method to check if a cell was touched in the current search
+         * @param idx cell index
+         *
+         */
+        bool touched(int idx) const { return stamp[idx] == generation; }
+
+        /**
+         * @brief Method to bring a cell into the current search. Resets the
+         *        entries of the cell if it was last used by an older search.
+         * @param idx cell index
+         *
+         */
+        void touch(int idx) {
+            if (stamp[idx] != generation) {
+                stamp[idx] = generation;
+                visited[idx] = NOT_VISITED;
+                g_cost[idx] = INT32_MAX;
+                parent[idx] = -1;
+                marked_path[idx] = 0;
+            }
+        }
+
+        /**
+         * @brief Getter methods which treat untouched cells as fresh
+         *
+         */
+        int get_visited(int idx) const { return touched(idx) ? visited[idx] : (int)NOT_VISITED; }
+        int get_g_cost(int idx) const { return touched(idx) ? g_cost[idx] : INT32_MAX; }
+        int get_parent(int idx) const { return touched(idx) ? parent[idx] : -1; }
+        bool is_marked(int idx) const { return touched(idx) && marked_path[idx]; }
+        size_t size(void) const { return stamp.size(); }
+};
+
 
 /**
  * @class battleship
@@ -50,105 +147,140 @@ typedef struct FIELD {
  *        This class holds information about the battleship's map grid, starting point,
  *        target point, and current position. It provides functionality to insert map nodes,
  *        print the map or the path, and access or manipulate navigation data.
+ *        The map is stored as one contiguous terrain byte per cell in row major
+ *        order (index = x * y_max + y, the same order as the JSON data). Per-search
+ *        state lives in a separate search_state so a loaded map can serve many searches.
  */
 class battleship {
     private:
         int bu_num;                         // battle unit number
         int x_max;                          // maximum x distance
         int y_max;                          // maximum y distance
-        _field bu_start;                    // tart position 
+        _field bu_start;                    // tart position
         _field bu_target;                   // target position
-        _field curr_pos;                    // TO DO: For multiple battleships  
-        vector<vector<_field*>> array;      // map for the battleship
+        _field curr_pos;                    // current position while under way, TO DO: For multiple battleships
+        vector<int8_t> terrain_store;       // owned terrain, empty when the terrain is attached
+        int8_t *terrain;                    // packed terrain map, one _f_type per cell
+        size_t cells;                       // number of cells in the map
+        search_state scratch;               // per-search state of the battleship, sized on first use
+        search_state back_scratch;          // backward half of a bidirectional search, sized on first use
+        component_index components;         // connected components of the passable cells
+        uint64_t version;                   // incremented on every terrain change
+        uint64_t map_hash;                  // Zobrist hash of the elevated cells, see build_map_hash()
+        bool hashed;                        // map_hash is kept up to date
+        vector<uint8_t> costs;              // cost of entering each cell, empty for unit costs
+        vector<uint8_t> border;             // passable flags inside a frame of elevated cells, empty until built
+        int min_cost;                       // lowest entry of costs, scales the heuristic
+
+        /**
+         * @brief Zobrist key of an elevated cell, a splitmix64 of its index so no
+         *        table of random keys is stored
+         * @param idx cell index
+         *
+         */
+        static uint64_t cell_key(uint64_t idx) {
+            uint64_t z = (idx + 1) * 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
     public:
         /**
-         * @brief Constructor for class. 
-         * 
+         * @brief Constructor for class.
+         *
          * @param bu battle unit number
          * @param x max x units
          * @param y max y units
          * @param s start position pointer
          * @param t target position pointer
-         * 
+         *
          */
         battleship(int bu, int x, int y, _field *s, _field *t) {
             bu_num = bu;
             x_max = x; y_max = y;
-            array.resize(x_max, vector<_field*>(y_max, NULL));
+            cells = (size_t)x_max * y_max;
+            terrain_store.assign(cells, (int8_t)GROUND_TERRAIN);
+            terrain = terrain_store.data();
+            version = 0;
+            map_hash = 0;
+            hashed = false;
+            min_cost = 1;
             bu_start.x_pos = s->x_pos;
             bu_start.y_pos = s->y_pos;
-            
+
             bu_target.x_pos = t->x_pos;
             bu_target.y_pos = t->y_pos;
+            curr_pos.x_pos = s->x_pos;
+            curr_pos.y_pos = s->y_pos;
         }
-        
+
         /**
-         * @brief Destructor for class
-         * 
+         * @brief Constructor for class on terrain owned by the caller, e.g. a memory
+         *        mapped map file. The memory must outlive the object; nothing is copied.
+         *
+         * @param bu battle unit number
+         * @param x max x units
+         * @param y max y units
+         * @param s start position pointer
+         * @param t target position pointer
+         * @param data x * y terrain bytes
+         *
          */
-        ~battleship() {
-            for (int i = 0; i < x_max; ++i) {
-                for (int j = 0; j < y_max; ++j) {
-                    if (array[i][j]) {
-                        delete array[i][j];
-                        array[i][j] = NULL;
-                    }
-                }
-            }
-            array.clear();  // clear the outer vector
+        battleship(int bu, int x, int y, _field *s, _field *t, int8_t *data) {
+            bu_num = bu;
+            x_max = x; y_max = y;
+            cells = (size_t)x_max * y_max;
+            terrain = data;
+            version = 0;
+            map_hash = 0;
+            hashed = false;
+            min_cost = 1;
+            bu_start.x_pos = s->x_pos;
+            bu_start.y_pos = s->y_pos;
+
+            bu_target.x_pos = t->x_pos;
+            bu_target.y_pos = t->y_pos;
+            curr_pos.x_pos = s->x_pos;
+            curr_pos.y_pos = s->y_pos;
         }
+
+        battleship(const battleship &) = delete;
+        battleship &operator=(const battleship &) = delete;
+
         /**
-         * @brief Method to insert the field nodes in the private arrray member
-         *        Precalculates costs based on current array index in the map 
-         *        and distance from start and target
+         * @brief Method to insert the field nodes in the private terrain member
          * @param buff map pointer from reading json file
-         * @returns 1 if succeeded, 0 if failed 
-         * 
+         * @returns 1 if succeeded, 0 if failed
+         *
          */
         int insert_nodes(const Value *buff) {
-            int temp_x=0, temp_y=0, ret = 1;
+            if (buff->Size() != (SizeType)cells) {
+                return 0;
+            }
             for (SizeType i=0; i < buff->Size(); ++i) {
-                double dot = (*buff)[i].GetDouble();
-                _field *node = new _field;
-                if(node) {
-                    node->x_pos = temp_x;
-                    node->y_pos = temp_y;
-                    node->field_stat = (_f_type)(dot);
-                    if(node->field_stat != ELEVATED_TERRAIN) {
-                        node->cost_from_src = abs(bu_start.x_pos - temp_x) + abs(bu_start.y_pos - temp_y); 
-                        node->cost_to_dest = abs(bu_target.x_pos - temp_x) + abs(bu_target.y_pos - temp_y);
-                    } else {
-                        node->cost_from_src = 0; 
-                        node->cost_to_dest = 0;
-                    }
-                    node->visited = NOT_VISITED;
-                    node->marked_path = false;  
-                    array[temp_x][temp_y] = node;
-                    
-                    //check for temps
-                    temp_x = (temp_y==(y_max - 1)) ? (temp_x+1) : (temp_x);
-                    temp_y = (temp_y==(y_max - 1)) ? (0) : (temp_y+1);
-                } else {
-                    ret = 0;
-                    break;
-                }
+                terrain[i] = (int8_t)(_f_type)((*buff)[i].GetDouble());
             }
-            return ret;
+            components.clear();
+            border.clear();
+            hashed = false;
+            ++version;
+            scratch.reset();
+            return 1;
         }
         /**
          * @brief Method to print the nodes in the private array
-         * 
+         *
          */
-        void print_nodes() {   
+        void print_nodes() {
             cout << "Reading array.." << endl;
             for (int i=0; i < x_max; ++i) {
                 for(int j=0; j < y_max; ++j) {
-                    _field *dot = array[i][j];
-                    if(dot->field_stat == GROUND_TERRAIN) {
+                    _f_type dot = get_terrain(index(i, j));
+                    if(dot == GROUND_TERRAIN) {
                         cout << "-" << " ";
-                    } else if(dot->field_stat == ELEVATED_TERRAIN) {
+                    } else if(dot == ELEVATED_TERRAIN) {
                         cout << "8" << " ";
-                    } else if(dot->field_stat == BU_START) {
+                    } else if(dot == BU_START) {
                         cout << "@" << " ";
                     } else {
                         cout << "*" << " ";
@@ -157,74 +289,228 @@ class battleship {
                 cout << "\n";
             }
         }
+
         /**
-         * @brief Method to print the path after processing the array
-         * 
+         * @brief Getter methods for accessing private members
+         *
          */
-        void print_path() {   
-            cout << "Printing path.." << endl;
-            for (int i=0; i < x_max; ++i) {
-                for(int j=0; j < y_max; ++j) {
-                    _field *dot = array[i][j];
-                    if(dot->field_stat == GROUND_TERRAIN) {
-                        if(dot->marked_path) {
-                            cout << "@" << " ";
-                        } else {
-                            cout << "-" << " ";
-                        }
-                    } else if(dot->field_stat == ELEVATED_TERRAIN) {
-                        cout << "8" << " ";
-                    } else if(dot->field_stat == BU_START) {
-                        cout << "@" << " ";
-                    } else {
-                        cout << "*" << " ";
-                    }
+        int get_start(void) { return index(bu_start.x_pos, bu_start.y_pos); }
+        int get_target(void) { return index(bu_target.x_pos, bu_target.y_pos); }
+        int get_curr_pos(void) { return index(curr_pos.x_pos, curr_pos.y_pos); }
+        void set_curr_pos(int idx) { curr_pos.x_pos = x_of(idx); curr_pos.y_pos = y_of(idx); }
+        int get_bu_num(void) { return bu_num; }
+        int get_x_max(void) const { return x_max; }
+        int get_y_max(void) const { return y_max; }
+        int get_cells(void) const { return (int)cells; }
+        search_state *get_scratch(void) {
+            if (scratch.size() != cells) {                      // sized on first use only
+                scratch.resize(cells);
+            }
+            return &scratch;
+        }
+        search_state *get_back_scratch(void) {
+            if (back_scratch.size() != cells) {
+                back_scratch.resize(cells);
+            }
+            return &back_scratch;
+        }
+
+        /**
+         * @brief Methods for converting between cell index and map position
+         *
+         */
+        int index(int x, int y) const { return x * y_max + y; }
+        int x_of(int idx) const { return idx / y_max; }
+        int y_of(int idx) const { return idx % y_max; }
+
+        /**
+         * @brief Methods for reading the terrain of a cell
+         *
+         */
+        _f_type get_terrain(int idx) const { return (_f_type)terrain[idx]; }
+        bool is_passable(int idx) const { return terrain[idx] != ELEVATED_TERRAIN; }
+        const int8_t *get_terrain_data(void) const { return terrain; }
+        int8_t *get_terrain_buffer(void) { return terrain; }
+
+        /**
+         * @brief Method to change the terrain of one cell, e.g. on a dynamic map. The
+         *        connected components and the map hash are updated in place if they
+         *        were built.
+         * @param idx cell index
+         * @param type new terrain of the cell
+         *
+         */
+        void set_terrain(int idx, _f_type type) {
+            if (hashed && ((terrain[idx] == ELEVATED_TERRAIN) != (type == ELEVATED_TERRAIN))) {
+                map_hash ^= cell_key(idx);
+            }
+            terrain[idx] = (int8_t)type;
+            ++version;
+            if (components.built()) {
+                components.update(idx);
+            }
+            if (!border.empty()) {
+                border[border_index(x_of(idx), y_of(idx))] = (type != ELEVATED_TERRAIN);
+            }
+        }
+        uint64_t get_version(void) const { return version; }
+
+        /**
+         * @brief Method to hash the passability of the loaded terrain: the XOR of the
+         *        Zobrist keys of the elevated cells over a key of the dimensions. Two
+         *        maps with the same hash have the same shortest paths. set_terrain()
+         *        keeps the hash up to date in O(1), and a map changed back to an
+         *        earlier state gets its earlier hash again.
+         *
+         */
+        void build_map_hash(void) {
+            map_hash = cell_key(((uint64_t)x_max << 32) ^ (uint64_t)y_max ^ 0x8000000000000000ULL);
+            for (size_t i = 0; i < cells; ++i) {
+                if (terrain[i] == ELEVATED_TERRAIN) {
+                    map_hash ^= cell_key(i);
                 }
-                cout << "\n";
             }
+            hashed = true;
         }
+        bool has_map_hash(void) const { return hashed; }
+        uint64_t get_map_hash(void) const { return map_hash; }
 
         /**
-         * @brief Getter methods for accessing private members
-         * 
+         * @brief Method to label the connected components of the loaded terrain. Until
+         *        it is called every pair of passable cells counts as connected.
+         *
          */
-        _field *get_start(void) { return array[bu_start.x_pos][bu_start.y_pos]; }
-        _field *get_target(void) { return array[bu_target.x_pos][bu_target.y_pos]; }
-        int get_bu_num(void) { return bu_num; }
+        void build_components(void) { components.build(terrain, x_max, y_max); }
+        const component_index *get_components(void) const { return &components; }
+
+        /**
+         * @brief Method to copy the passability of the loaded terrain into a grid with a
+         *        one cell frame of elevated sentinels, (x_max + 2) x (y_max + 2) bytes. The
+         *        search kernels read neighbours from it without bounds checks.
+         *        set_terrain() keeps it up to date.
+         *
+         */
+        void build_border(void) {
+            border.assign((size_t)(x_max + 2) * (y_max + 2), 0);
+            for (int x = 0; x < x_max; ++x) {
+                for (int y = 0; y < y_max; ++y) {
+                    border[border_index(x, y)] = is_passable(index(x, y));
+                }
+            }
+        }
+        bool has_border(void) const { return !border.empty(); }
+        const uint8_t *get_border(void) const { return border.data(); }
+        size_t border_index(int x, int y) const { return (size_t)(x + 1) * (y_max + 2) + y + 1; }
 
         /**
-         * @brief Method to fetch the next valid members for a node. 
-         * @param neighbours pointer for vector for storing the nodes
-         * @param node node around which valid members need to be searched
-         * 
+         * @brief Method to check if a path between two cells can exist
+         * @param a cell index
+         * @param b cell index
+         * @returns false if the cells are in different components or one is elevated
+         *
          */
-        void get_valid_neighbours(vector<_field*> *neighbours, _field *node) {
-            _field *temp;
-            if((node->x_pos - 1) >= 0) {
-                temp = array[node->x_pos - 1][node->y_pos];
-                if((temp->field_stat != ELEVATED_TERRAIN) && (temp->visited != DEAD_END)) {
-                    neighbours->push_back(temp);    
+        bool connected(int a, int b) const {
+            return components.built() ? components.connected(a, b) : (is_passable(a) && is_passable(b));
+        }
+
+        /**
+         * @brief Method to give the cells traversal costs, the cost of a step is the
+         *        cost of the cell it enters. An empty vector restores unit costs.
+         * @param c one cost per cell, 1 or more
+         *
+         */
+        void set_costs(vector<uint8_t> &&c) {
+            costs = move(c);
+            min_cost = costs.empty() ? 1 : (int)*min_element(costs.begin(), costs.end());
+        }
+        bool has_costs(void) const { return !costs.empty(); }
+        int step_cost(int idx) const { return costs[idx]; }
+        int get_min_cost(void) const { return min_cost; }
+
+        /**
+         * @brief Method to set the start and target after the map is loaded
+         * @param s start position pointer
+         * @param t target position pointer
+         *
+         */
+        void set_endpoints(_field *s, _field *t) {
+            bu_start.x_pos = s->x_pos;
+            bu_start.y_pos = s->y_pos;
+            bu_target.x_pos = t->x_pos;
+            bu_target.y_pos = t->y_pos;
+            curr_pos.x_pos = s->x_pos;
+            curr_pos.y_pos = s->y_pos;
+        }
+
+        /**
+         * @brief Manhattan distances to the start and target. These replace the
+         *        per-node precalculated costs of the old grid.
+         * @param idx cell index
+         *
+         */
+        int cost_from_src(int idx) const {
+            return abs(bu_start.x_pos - x_of(idx)) + abs(bu_start.y_pos - y_of(idx));
+        }
+        int cost_to_dest(int idx) const {
+            return abs(bu_target.x_pos - x_of(idx)) + abs(bu_target.y_pos - y_of(idx));
+        }
+
+        /**
+         * @brief Method to start a new search on the same map in O(1)
+         *
+         */
+        void reset_search(void) { scratch.reset(); }
+
+        /**
+         * @brief Method to fetch the traversable neighbours of a cell, independent
+         *        of any search state. The order matches get_valid_neighbours().
+         * @param node cell index
+         * @param out array receiving up to 4 cell indices
+         * @returns number of neighbours written
+         *
+         */
+        int get_passable_neighbours(int node, int out[4]) const {
+            int x = x_of(node), y = node - x * y_max, n = 0;
+            if((x - 1) >= 0 && is_passable(node - y_max)) out[n++] = node - y_max;
+            if((x + 1) < x_max && is_passable(node + y_max)) out[n++] = node + y_max;
+            if((y - 1) >= 0 && is_passable(node - 1)) out[n++] = node - 1;
+            if((y + 1) < y_max && is_passable(node + 1)) out[n++] = node + 1;
+            return n;
+        }
+
+        /**
+         * @brief Method to fetch the next valid members for a node.
+         * @param neighbours pointer for vector for storing the cell indices
+         * @param node cell index around which valid members need to be searched
+         *
+         */
+        void get_valid_neighbours(vector<int> *neighbours, int node) {
+            int x = x_of(node), y = y_of(node), temp;
+            if((x - 1) >= 0) {
+                temp = node - y_max;
+                if(is_passable(temp) && (scratch.get_visited(temp) != DEAD_END)) {
+                    neighbours->push_back(temp);
                 }
             }
-            if((node->x_pos + 1) < x_max) {
-                temp = array[node->x_pos + 1][node->y_pos];
-                if((temp->field_stat != ELEVATED_TERRAIN) && (temp->visited != DEAD_END)) {
+            if((x + 1) < x_max) {
+                temp = node + y_max;
+                if(is_passable(temp) && (scratch.get_visited(temp) != DEAD_END)) {
                     neighbours->push_back(temp);
                 }
             }
-            if((node->y_pos - 1) >= 0) {
-                temp = array[node->x_pos][node->y_pos - 1];
-                if((temp->field_stat != ELEVATED_TERRAIN) && (temp->visited != DEAD_END)) {
+            if((y - 1) >= 0) {
+                temp = node - 1;
+                if(is_passable(temp) && (scratch.get_visited(temp) != DEAD_END)) {
                     neighbours->push_back(temp);
                 }
             }
-            if((node->y_pos + 1) < y_max) {
-                temp = array[node->x_pos][node->y_pos + 1];
-                if((temp->field_stat != ELEVATED_TERRAIN) && (temp->visited != DEAD_END)) {
+            if((y + 1) < y_max) {
+                temp = node + 1;
+                if(is_passable(temp) && (scratch.get_visited(temp) != DEAD_END)) {
                     neighbours->push_back(temp);
                 }
             }
         }
 
 };
-#endif //_DEFINITIONS_
\ No newline at end of file
+#endif //_DEFINITIONS_
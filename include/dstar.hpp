@@ -0,0 +1,134 @@
+#ifndef _DSTAR_
+#define _DSTAR_
+
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+/**
+ * @class dstar_lite
+ * @brief Incremental planner for a ship under way on a changing map, D* Lite
+ *        (Koenig & Likhachev, optimised version). The search runs from the target
+ *        towards the ship, so g(s) is the distance from s to the target. A step costs
+ *        the step cost of the cell it enters, as in the other modes. When cells
+ *        flip between ground and elevated only the cells whose distance changed are
+ *        expanded again, and moving the ship only shifts the heuristic through km.
+ *        The plan keeps its state between calls:
+ *          plan()       full search from a start cell to a target
+ *          set_cell()   change one cell of the map, the repair is queued
+ *          update_cell() queue the repair of a cell someone else changed
+ *          move_to()    move the ship, e.g. one step along the path
+ *          replan()     repair the plan after changes and moves
+ */
+class dstar_lite {
+    private:
+        typedef struct KEY {
+            int k1;                         // min(g, rhs) + h(ship, s) + km
+            int k2;                         // min(g, rhs)
+        } _key;
+
+        battleship *bu;                     // map, changed through set_cell()
+        int goal;                           // target cell index
+        int ship;                           // ship cell index, the search goal
+        int last;                           // ship cell at the last edge change
+        int km;                             // heuristic offset from ship moves
+        int scale;                          // lowest step cost, keeps h a lower bound with costs
+        vector<int> g;                      // per cell: distance to the target
+        vector<int> rhs;                    // per cell: one step lookahead of g
+        vector<int> heap;                   // binary heap of cell indices
+        vector<_key> heap_key;              // key of each heap entry
+        vector<int> heap_pos;               // per cell: heap position, -1 if not queued
+        long expanded;                      // cells expanded by the last repair
+
+        int h(int a, int b) const {
+            return scale * (abs(bu->x_of(a) - bu->x_of(b)) + abs(bu->y_of(a) - bu->y_of(b)));
+        }
+        int step(int s) const { return bu->has_costs() ? bu->step_cost(s) : 1; }
+        _key calc_key(int s) const {
+            int m = min(g[s], rhs[s]);
+            return {m + h(ship, s) + km, m};
+        }
+        static bool less(const _key &a, const _key &b) {
+            return (a.k1 < b.k1) || ((a.k1 == b.k1) && (a.k2 < b.k2));
+        }
+        void heap_up(int i);
+        void heap_down(int i);
+        void heap_set(int s, _key k);
+        void heap_remove(int s);
+        int neighbours(int s, int out[4]) const;
+        int best_rhs(int s) const;
+        void update_vertex(int s);
+        int step_from(int s, int dist) const;
+        void compute(void);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param b pointer to the battleship holding the map
+         *
+         */
+        dstar_lite(battleship *b);
+
+        /**
+         * @brief Method to plan from scratch, placing the ship on a start cell
+         * @param start ship cell index
+         * @param target target cell index
+         * @returns 1 if a path exists, 0 if not
+         *
+         */
+        int plan(int start, int target);
+
+        /**
+         * @brief Method to flip a cell between ground and elevated terrain. The map
+         *        and its connected components change at once; the plan is repaired
+         *        on the next replan().
+         * @param cell cell index
+         * @param type GROUND_TERRAIN or ELEVATED_TERRAIN
+         *
+         */
+        void set_cell(int cell, _f_type type);
+
+        /**
+         * @brief Method to queue the repair of a cell changed through
+         *        battleship::set_terrain(), for plans sharing a map that the caller
+         *        updates. A cell that did not change passability costs a few lookups.
+         * @param cell cell index
+         *
+         */
+        void update_cell(int cell);
+
+        /**
+         * @brief Method to move the ship. The battleship is not touched, so several
+         *        plans can share one map.
+         * @param cell new ship cell index
+         *
+         */
+        void move_to(int cell);
+
+        /**
+         * @brief Method to repair the plan after set_cell() and move_to() calls
+         * @returns 1 if a path exists, 0 if not
+         *
+         */
+        int replan(void);
+
+        /**
+         * @brief Method to read the planned path from the ship to the target
+         * @param sol pointer to vector receiving the path points, ship first
+         * @returns number of points in the path, 0 if there is no path
+         *
+         */
+        int get_path(vector<_points> *sol) const;
+
+        /**
+         * @brief Method to fetch the next cell on the planned path
+         * @returns cell index, -1 if there is no path or the ship is on the target
+         *
+         */
+        int next_step(void) const;
+
+        int get_ship(void) const { return ship; }
+        int get_goal(void) const { return goal; }
+        long get_expanded(void) const { return expanded; }
+};
+
+#endif //_DSTAR_
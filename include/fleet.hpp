@@ -0,0 +1,168 @@
+#ifndef _FLEET_
+#define _FLEET_
+
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+/**
+ * @brief Struct to store one step of a timed path
+ *
+ */
+typedef struct TIMED_POINT {
+    int x;                          // x index in the map
+    int y;                          // y index in the map
+    int t;                          // time step at which the ship is at (x, y)
+} _timed_point;
+
+/**
+ * @class reservation_table
+ * @brief Space-time reservations for the time steps [now, now + slots). Each time
+ *        step owns one slot of a ring; a slot is a small open addressing hash from
+ *        cell index to ship id. Advancing the clock clears only the slot that
+ *        falls into the past, so memory is slots * fleet size entries.
+ */
+class reservation_table {
+    private:
+        vector<vector<int>> keys;           // per slot: cell index, -1 for empty
+        vector<vector<int>> owners;         // per slot: ship id of the reservation
+        vector<vector<int>> used;           // per slot: filled positions, for clearing
+        int mask;                           // hash capacity - 1
+        int now;                            // oldest time step held by the ring
+    public:
+        reservation_table() : mask(0), now(0) {}
+
+        /**
+         * @brief Method to size the table
+         * @param slots number of time steps held, at least window + 2
+         * @param ships number of ships that can reserve a time step
+         *
+         */
+        void init(int slots, int ships);
+
+        /**
+         * @brief Method to look up the ship holding a cell at a time step
+         * @param cell cell index
+         * @param t time step, must be in [now, now + slots)
+         * @returns ship id, -1 if the cell is free
+         *
+         */
+        int owner(int cell, int t) const;
+
+        /**
+         * @brief Method to reserve a cell at a time step for a ship
+         * @param cell cell index
+         * @param t time step, must be in [now, now + slots)
+         * @param ship ship id
+         *
+         */
+        void reserve(int cell, int t, int ship);
+
+        /**
+         * @brief Method to move the clock one step, dropping the reservations of the old now
+         *
+         */
+        void advance(void);
+
+        int get_now(void) const { return now; }
+        int get_slots(void) const { return (int)keys.size(); }
+};
+
+/**
+ * @class fleet_planner
+ * @brief Plans N ships on one map without vertex or edge collisions using windowed
+ *        cooperative A* (WHCA*). Every ship follows its own shortest spatial route and
+ *        plans the next window of time steps with a space-time A* that respects the
+ *        reservations of the ships planned before it. Windows are staggered, so each
+ *        step only replans the ships whose window expires. A ship holds the cell at
+ *        the end of its window until it replans and parks on its target. A ship
+ *        whose window makes no step along its route asks the ships holding the
+ *        route ahead to make way for one window: a parked ship is unparked and plans
+ *        back afterwards, a moving ship is asked only by a ship with a lower id that
+ *        has not arrived yet, so no two ships wait on each other.
+ */
+class fleet_planner {
+    private:
+        typedef struct SHIP {
+            int start;                      // start cell index
+            int target;                     // target cell index
+            int pos;                        // cell at the end of the planned window
+            int expires;                    // time step at which the window ends
+            int parked;                     // 1 once the ship sits on its target
+            int arrived;                    // 1 once the ship parked, it then ranks below moving ships
+            int yield_to;                   // ship to make way for in the next window, -1 if none
+            vector<int> route;              // shortest spatial route from the last replan
+            int progress;                   // index of pos on route
+            vector<_timed_point> path;      // timed path planned so far
+        } _ship;
+
+        typedef struct ST_NODE {
+            int cell;                       // cell index
+            int t;                          // time step
+            int parent;                     // parent node, -1 for the window start
+            int closed;                     // 1 once expanded
+        } _st_node;
+
+        battleship *bu;                     // map, read only
+        int window;                         // window length in time steps
+        vector<_ship> ships;                // fleet
+        vector<int> hold;                   // per cell: ship holding it from its expiry on, -1 for none
+        reservation_table table;            // space-time reservations
+        vector<uint32_t> way_mark;          // per cell: generation of the route a ship makes way for
+        uint32_t way_gen;                   // current route mark generation
+        search_state route_state;           // scratch for spatial routes
+        vector<_st_node> nodes;             // space-time search nodes
+        vector<uint64_t> node_keys;         // open addressing hash of node keys
+        vector<int> node_index;             // node index per hash entry
+        vector<uint32_t> node_stamp;        // generation of each hash entry
+        uint32_t node_gen;                  // current space-time search generation
+        bucket_queue open;                  // space-time open list
+        long replans;                       // number of window plans made
+        long yields;                        // number of times a ship was asked to make way
+
+        int blocked(int ship, int from, int to, int t) const;
+        int free_from(int ship, int cell, int t) const;
+        int find_node(int cell, int dt, int *created);
+        int route_to_target(int id);
+        void plan_window(int id, int now, int depth);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param b pointer to the battleship holding the map
+         * @param w window length in time steps
+         *
+         */
+        fleet_planner(battleship *b, int w);
+
+        /**
+         * @brief Method to add a ship to the fleet before planning
+         * @param start start position
+         * @param target target position
+         * @returns ship id, -1 if a position is off the map, elevated or already taken
+         *          by another ship's start or target
+         *
+         */
+        int add_ship(_points start, _points target);
+
+        /**
+         * @brief Method to plan the fleet until every ship is parked. Ships that can
+         *        not reach their target stay at their start.
+         * @param max_steps time step limit
+         * @returns number of ships parked on their target
+         *
+         */
+        int plan(int max_steps);
+
+        /**
+         * @brief Method to fetch the timed path of a ship, one point per time step
+         * @param id ship id
+         *
+         */
+        const vector<_timed_point> &get_path(int id) const { return ships[id].path; }
+
+        int get_ships(void) const { return (int)ships.size(); }
+        long get_replans(void) const { return replans; }
+        long get_yields(void) const { return yields; }
+};
+
+#endif //_FLEET_
@@ -0,0 +1,179 @@
+#ifndef _HDA_
+#define _HDA_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+#define HDA_BLOCK_SHIFT     4           // cells are owned in blocks of 16x16, neighbours mostly stay local
+#define HDA_LANE_SLOTS      1024        // messages one lane holds, a power of two
+#define HDA_MAX_THREADS     64          // lanes grow with the square of the workers
+#define HDA_DEPTH_SLACK     64          // g a worker's front may trail the deepest front of equal f by
+#define HDA_BURST           32          // cells a worker expands between two looks at its inbox
+
+/**
+ * @brief Struct to store one message between HDA* workers: a generated cell for its owner
+ *
+ */
+typedef struct HDA_MESSAGE {
+    int cell;                       // generated cell
+    int g;                          // cost from the start through the sender
+    int parent;                     // expanded cell the step comes from
+} _hda_message;
+
+/**
+ * @class hda_lane
+ * @brief Lock-free single producer, single consumer ring of messages. The producer
+ *        only writes tail and the consumer only head; a release store on each makes
+ *        the slots it covers visible to the other side. The two indices sit on their
+ *        own cache lines.
+ */
+class hda_lane {
+    private:
+        alignas(64) atomic<uint32_t> head;  // next slot to read, written by the consumer
+        alignas(64) atomic<uint32_t> tail;  // next slot to write, written by the producer
+        alignas(64) _hda_message slots[HDA_LANE_SLOTS];
+    public:
+        hda_lane() : head(0), tail(0) {}
+
+        /**
+         * @brief Method to add a message, producer side
+         * @param m message
+         * @returns false if the ring is full
+         *
+         */
+        bool push(const _hda_message &m) {
+            uint32_t t = tail.load(memory_order_relaxed);
+            if (t - head.load(memory_order_acquire) == HDA_LANE_SLOTS) {
+                return false;
+            }
+            slots[t & (HDA_LANE_SLOTS - 1)] = m;
+            tail.store(t + 1, memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Method to take the oldest message, consumer side
+         * @param m pointer receiving the message
+         * @returns false if the ring is empty
+         *
+         */
+        bool pop(_hda_message *m) {
+            uint32_t h = head.load(memory_order_relaxed);
+            if (h == tail.load(memory_order_acquire)) {
+                return false;
+            }
+            *m = slots[h & (HDA_LANE_SLOTS - 1)];
+            head.store(h + 1, memory_order_release);
+            return true;
+        }
+};
+
+/**
+ * @brief Struct to publish the next cell of a worker's open list, one cache line each.
+ *        The rank is f << 32 minus g: lower f first, then the deeper cell. Senders
+ *        lower inbound to the best rank they sent, so cells in flight count too.
+ *
+ */
+typedef struct alignas(64) HDA_FRONT {
+    atomic<int64_t> rank;           // rank of the next cell, INT64_MAX if the open list is empty
+    atomic<int64_t> inbound;        // best rank sent since the worker last read its inbox
+} _hda_front;
+
+/**
+ * @class hda_search
+ * @brief Hash distributed A* (HDA*) for one long query on a large map. Every cell is
+ *        owned by one worker thread, picked by a hash of its 16x16 block. A worker
+ *        keeps the open list of its cells and expands them in f order. Successors it
+ *        owns go straight into its open list; the others are sent to their owner
+ *        through the owner's inbox, one lock-free lane per sender, so the inbox is a
+ *        multi producer, single consumer queue without locks. A cell reached again
+ *        with a lower g is reopened, as workers do not expand in one global order.
+ *        Many cells share the lowest f on a grid, and A* reaches the target by
+ *        going deep among them. A worker left to itself would expand all of them in
+ *        its blocks while the deep end sits with another worker. So every worker
+ *        publishes the f and g of its next cell and waits while that is behind the
+ *        best of the others: a higher f, or the same f more than HDA_DEPTH_SLACK
+ *        shallower. The worker holding the best cell always goes on.
+ *
+ *        A worker that pops the target with a lower g than the incumbent lowers the
+ *        incumbent, and every worker drops open cells with f not below it. The
+ *        search ends when no worker has work left. One counter holds the working
+ *        workers plus the messages in flight: a message counts from its send until
+ *        its owner has handled it, and an idle worker counts itself again before it
+ *        handles a message. The counter only grows while it is above zero, so once
+ *        it reads zero it stays zero, and every cell with f below the incumbent has
+ *        been expanded with its lowest g. With a consistent heuristic the incumbent
+ *        is then the optimal cost, the same as astar_search().
+ *
+ *        g costs and parents are written only by the owner of a cell and read after
+ *        the workers are joined. Workers are started per query, which costs well
+ *        under a millisecond and only pays off on long routes.
+ */
+class hda_search {
+    private:
+        battleship *bu;                     // map, read only during a search
+        int threads;                        // workers per search
+        uint32_t generation;                // current search generation
+        vector<uint32_t> stamp;             // generation in which a cell was last touched
+        vector<int> g_cost;                 // cost from the start, valid where stamped
+        vector<int> parent;                 // parent cell, valid where stamped
+        vector<unique_ptr<hda_lane>> lanes; // inbox lanes, lanes[receiver * threads + sender]
+        unique_ptr<_hda_front[]> fronts;    // next cell rank of every worker
+        vector<uint8_t> block_owner;        // worker owning each block, row major
+        int block_cols;                     // blocks per map row
+        atomic<long> work;                  // working workers plus messages in flight
+        atomic<int> incumbent;              // cost of the best path found, INT_MAX if none
+        long expanded;                      // cells expanded by the last search, all workers
+        long messages;                      // messages sent by the last search
+
+        void worker(int id, int start, int target, long *exp, long *sent);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param b pointer to the battleship holding the map
+         * @param t number of workers, 0 for one per hardware thread, at most HDA_MAX_THREADS
+         *
+         */
+        hda_search(battleship *b, int t = 0);
+
+        /**
+         * @brief Method to fetch the worker owning a cell
+         * @param x cell row
+         * @param y cell column
+         * @returns worker id
+         *
+         */
+        int owner(int x, int y) const {
+            return block_owner[(x >> HDA_BLOCK_SHIFT) * block_cols + (y >> HDA_BLOCK_SHIFT)];
+        }
+
+        /**
+         * @brief Method to find a shortest path between two cells
+         * @param start start cell index
+         * @param target target cell index
+         * @param cells pointer to vector receiving the path cells, start first
+         * @returns 1 if a valid path is found. 0 if no path
+         *
+         */
+        int find_path(int start, int target, vector<int> *cells);
+
+        int get_threads(void) const { return threads; }
+        long get_expanded(void) const { return expanded; }
+        long get_messages(void) const { return messages; }
+};
+
+/**
+ * @brief Function to find a path from start to target of the battleship with HDA*
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @param threads number of workers, 0 for one per hardware thread
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_hda(battleship *bu, vector<_points*> *sol, int threads = 0);
+
+#endif //_HDA_
@@ -0,0 +1,154 @@
+#ifndef _HPA_
+#define _HPA_
+
+#include <unordered_map>
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+#define HPA_CLUSTER         16      // default cluster side in cells
+#define HPA_LONG_ENTRANCE   6       // entrances at least this wide get a node at both ends
+#define HPA_SMOOTH_MARGIN   2       // cells a smoothing search may stray beside the path window
+
+/**
+ * @brief Struct to store one edge of the abstract graph
+ *
+ */
+typedef struct HPA_EDGE {
+    int to;                         // abstract node id
+    int cost;                       // steps between the two cells
+} _hpa_edge;
+
+/**
+ * @brief Struct to store one abstract node, an entrance cell of a cluster
+ *
+ */
+typedef struct HPA_NODE {
+    int cell;                       // cell index, -1 for a free node id
+    int cluster;                    // cluster holding the cell
+    vector<_hpa_edge> edges;        // intra-cluster and inter-cluster edges
+} _hpa_node;
+
+/**
+ * @class hpa_state
+ * @brief Per-query scratch of hpa_graph. Cluster searches use arrays of one cluster's
+ *        size, the abstract search uses arrays over the abstract nodes. Entries are
+ *        generation stamped like search_state, so a query never clears them.
+ */
+class hpa_state {
+    public:
+        uint32_t local_gen;                 // generation of the cluster search
+        vector<uint32_t> local_stamp;       // per cluster cell: generation
+        vector<int> local_dist;             // per cluster cell: steps from the search source
+        vector<int> local_parent;           // per cluster cell: parent cell index
+        vector<int> local_queue;            // BFS queue of cell indices
+
+        uint32_t gen;                       // generation of the abstract search
+        vector<uint32_t> stamp;             // per abstract node: generation
+        vector<int> g_cost;                 // per abstract node: cost from the start
+        vector<int> parent;                 // per abstract node: parent node
+        vector<uint8_t> closed;             // per abstract node: 1 once expanded
+        bucket_queue open_list;             // open list of the abstract search
+        vector<_hpa_edge> start_edges;      // edges of the start into its cluster
+        vector<_hpa_edge> target_edges;     // edges of the target cluster into the target
+        vector<int> cells;                  // refined path, cell indices
+        vector<int> smoothed;               // path being shortened by smooth_path()
+
+        long abstract_expanded;             // abstract nodes expanded by the last query
+        long refined_cells;                 // cells searched while refining the last query
+        _search_counters counters;          // events of the abstract search, counted with PATH_STATS only
+
+        hpa_state() : local_gen(0), gen(0), abstract_expanded(0), refined_cells(0), counters() {}
+};
+
+/**
+ * @class hpa_graph
+ * @brief Hierarchical path-finding A* (HPA*) over the battleship map. The grid is cut
+ *        into square clusters. Every run of cells that is passable on both sides of a
+ *        cluster border is an entrance: one node pair in its middle, or one pair at each
+ *        end if it is long. Nodes of one cluster are joined by their in-cluster BFS
+ *        distances. A query links start and target into their clusters, runs A* on the
+ *        abstract graph and then refines each abstract edge of the result into cells with
+ *        a BFS bounded to one cluster. A smoothing pass then searches windows of the
+ *        path again to cut the detours entrances force. Paths are near optimal, not
+ *        optimal.
+ *        The graph is read only during queries, so one graph can serve many threads with
+ *        one hpa_state each. After a terrain change update_cell() rebuilds only the
+ *        clusters the cell can affect.
+ */
+class hpa_graph {
+    private:
+        battleship *bu;                     // map
+        int cluster;                        // cluster side in cells
+        int rows;                           // clusters along x
+        int cols;                           // clusters along y
+        vector<_hpa_node> nodes;            // abstract nodes, indexed by id
+        vector<int> free_ids;               // ids of removed nodes, reused first
+        unordered_map<int, int> node_of;    // cell index -> abstract node id
+        vector<vector<int>> members;        // per cluster: abstract node ids
+        vector<vector<int>> down;           // per cluster: entrance cells on the border to cluster + cols
+        vector<vector<int>> right;          // per cluster: entrance cells on the border to cluster + 1
+        hpa_state build_state;              // scratch for building and updating
+        uint64_t version;                   // map version the graph was last brought in line with
+
+        int cluster_of(int cell) const {
+            return (bu->x_of(cell) / cluster) * cols + bu->y_of(cell) / cluster;
+        }
+        int local_index(int k, int cell) const {
+            return (bu->x_of(cell) - (k / cols) * cluster) * cluster + bu->y_of(cell) - (k % cols) * cluster;
+        }
+        int node_for(int cell);
+        void add_edge(int a, int b, int cost);
+        void find_entrances(int k);
+        void link_borders(int k);
+        void link_members(int k);
+        void drop_cluster(int k);
+        int box_bfs(hpa_state *st, int x0, int y0, int x1, int y1, int stride, int from, int to) const;
+        int cluster_bfs(hpa_state *st, int k, int from, int to) const;
+        void smooth_path(hpa_state *st) const;
+    public:
+        /**
+         * @brief Constructor for class. Builds the abstract graph of the loaded map.
+         *
+         * @param b pointer to the battleship holding the map
+         * @param size cluster side in cells
+         *
+         */
+        hpa_graph(battleship *b, int size = HPA_CLUSTER);
+
+        /**
+         * @brief Method to find a path between two cells
+         * @param st per-query scratch, one per thread
+         * @param start start cell index
+         * @param target target cell index
+         * @returns number of path cells left in st->cells, start first, 0 if no path
+         *
+         */
+        int find_path(hpa_state *st, int start, int target) const;
+
+        /**
+         * @brief Method to rebuild the clusters a changed cell can affect: its own
+         *        cluster and, for a cell on a cluster edge, the cluster across it.
+         *        Call it after battleship::set_terrain() for every changed cell.
+         * @param cell cell index
+         *
+         */
+        void update_cell(int cell);
+
+        int get_cluster(void) const { return cluster; }
+        size_t get_nodes(void) const { return nodes.size() - free_ids.size(); }
+        size_t get_edges(void) const;
+        bool is_current(void) const { return version == bu->get_version(); }
+};
+
+/**
+ * @brief Function to find a path from start to target of the battleship with HPA*.
+ *        Builds a one-off hpa_graph, so it only pays off for large maps; keep an
+ *        hpa_graph around to answer many queries.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_hpa(battleship *bu, vector<_points*> *sol);
+
+#endif //_HPA_
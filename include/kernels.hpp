@@ -0,0 +1,220 @@
+#ifndef _KERNELS_
+#define _KERNELS_
+
+#include <climits>
+#include <cstring>
+#include "definitions.hpp"
+#include "landmarks.hpp"
+
+/**
+ * @brief make GENERIC=1 defines GENERIC_SEARCH, which turns the kernels off so the
+ *        generic best_first() loop answers every query, to compare the two
+ *
+ */
+#ifdef GENERIC_SEARCH
+#define SEARCH_KERNELS      0
+#else
+#define SEARCH_KERNELS      1
+#endif
+
+#define KERNEL_SMALL_MAX    64          // largest side the stack kernels cover
+
+/**
+ * @brief Manhattan distance heuristic of the kernels. Kernels pass the position of a
+ *        cell along with its index, so no division is needed to find it.
+ *
+ */
+typedef struct MANHATTAN_BOUND {
+    int tx;                         // target row
+    int ty;                         // target column
+
+    int operator()(int, int x, int y) const { return abs(x - tx) + abs(y - ty); }
+} _manhattan_bound;
+
+/**
+ * @brief ALT heuristic of the kernels: the larger of the Manhattan distance and the
+ *        landmark bound
+ *
+ */
+typedef struct ALT_BOUND {
+    int tx;                         // target row
+    int ty;                         // target column
+    const landmark_set *lm;         // landmark tables
+    const uint16_t *row;            // landmark distances of the target
+
+    int operator()(int cell, int x, int y) const {
+        int m = abs(x - tx) + abs(y - ty);
+        int l = lm->bound(cell, row);
+        return (l > m) ? l : m;
+    }
+} _alt_bound;
+
+/**
+ * @brief Function to run unit cost A* on the sentinel border of the map. Same loop,
+ *        neighbour order and tie break as best_first(), so the expansions and paths
+ *        are the same, but the position of a cell is found once per expansion
+ *        instead of once per heuristic call, the four neighbours are written out
+ *        and the frame of elevated cells replaces the bounds checks.
+ * @param bu pointer the the battleship class, build_border() called
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @param h heuristic taking (cell index, row, column)
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+template <typename HEURISTIC>
+int grid_astar(battleship *bu, search_state *ss, int start, int target, HEURISTIC h) {
+    const int y_max = bu->get_y_max(), w = y_max + 2;
+    const uint8_t *pass = bu->get_border();
+    bucket_queue *open = &ss->open_list;
+
+    ss->reset();
+    if (!bu->connected(start, target)) {
+        return 0;
+    }
+    ss->touch(start);
+    ss->g_cost[start] = 0;
+    open->push(h(start, bu->x_of(start), bu->y_of(start)), start);
+    STAT_ADD(ss, pushes, 1);
+
+    while (!open->empty()) {
+        STAT_PEAK(ss, peak_open, open->size());
+        int node = open->pop();
+        STAT_ADD(ss, pops, 1);
+        if (ss->visited[node] == CLOSED) {
+            STAT_ADD(ss, stale, 1);
+            continue;
+        }
+        ss->visited[node] = CLOSED;
+        ++ss->expanded;
+        if (node == target) {
+            return 1;
+        }
+
+        int x = node / y_max, y = node - x * y_max;
+        const uint8_t *p = pass + bu->border_index(x, y);
+        int g = ss->g_cost[node] + 1;
+        auto relax = [&](int next, int nx, int ny) {
+            STAT_ADD(ss, generated, 1);
+            ss->touch(next);
+            if ((ss->visited[next] != CLOSED) && (g < ss->g_cost[next])) {
+                ss->g_cost[next] = g;
+                ss->parent[next] = node;
+                open->push(g + h(next, nx, ny), next);
+                STAT_ADD(ss, pushes, 1);
+            }
+        };
+        if (p[-w]) relax(node - y_max, x - 1, y);
+        if (p[w]) relax(node + y_max, x + 1, y);
+        if (p[-1]) relax(node - 1, x, y - 1);
+        if (p[1]) relax(node + 1, x, y + 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function to run unit cost A* on a map of at most N x N cells with all search
+ *        state in stack arrays sized at compile time: g costs, parents and cell
+ *        states over the bordered grid, and the open list as a bucket array of
+ *        linked LIFO stacks, the tie break of bucket_queue. Nothing is allocated, no
+ *        generation stamps are checked and only the cell states are cleared per
+ *        search. The parent links of the path are copied
+ *        into the search state afterwards, so trace_path() works as after
+ *        grid_astar(), and the expansions and path are the same as there.
+ * @param bu pointer the the battleship class, build_border() called, sides at most N
+ * @param ss search state receiving the path links and the expanded count
+ * @param start start cell index
+ * @param target target cell index
+ * @param h heuristic taking (cell index, row, column), at most the number of cells
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+template <int N, typename HEURISTIC>
+int small_astar(battleship *bu, search_state *ss, int start, int target, HEURISTIC h) {
+    constexpr int CELLS = (N + 2) * (N + 2);                    // bordered grid
+    constexpr int KEYS = 2 * N * N + 1;                         // g and h are each below N * N
+    constexpr int PUSHES = 4 * N * N + 1;                       // a cell is pushed once per improving neighbour
+    static_assert(CELLS < INT16_MAX && PUSHES < INT16_MAX, "kernel indices are 16 bit");
+
+    const int y_max = bu->get_y_max(), w = y_max + 2;
+    const uint8_t *pass = bu->get_border();
+    int g[CELLS];                                               // valid where reached
+    int16_t parent[CELLS];
+    uint8_t state[CELLS];                                       // 0 untouched, 1 reached, 2 closed
+    int16_t head[KEYS];                                         // top entry of each bucket, -1 if empty
+    int16_t below[PUSHES];                                      // entry under each entry in its bucket
+    int16_t value[PUSHES];                                      // bordered cell of each entry
+    int pushes = 0, cur = 0, top = -1, count = 0;
+    long expanded = 0;
+
+    ss->reset();
+    if (!bu->connected(start, target)) {
+        return 0;
+    }
+    memset(state, 0, sizeof(state));                            // the only array cleared in full
+    auto push = [&](int key, int cell) {
+        while (top < key) {                                     // buckets are cleared as keys first reach them
+            head[++top] = -1;
+        }
+        value[pushes] = (int16_t)cell;
+        below[pushes] = head[key];
+        head[key] = (int16_t)pushes++;
+        cur = (key < cur) ? key : cur;
+        ++count;
+    };
+
+    int sx = bu->x_of(start), sy = bu->y_of(start);
+    int s = (int)bu->border_index(sx, sy), t = (int)bu->border_index(bu->x_of(target), bu->y_of(target));
+    g[s] = 0;
+    parent[s] = -1;
+    state[s] = 1;
+    cur = h(start, sx, sy);
+    push(cur, s);
+    int found = 0;
+    while (count) {
+        while (head[cur] < 0) {
+            ++cur;
+        }
+        int e = head[cur];
+        head[cur] = below[e];
+        --count;
+        int node = value[e];
+        if (state[node] == 2) {
+            continue;
+        }
+        state[node] = 2;
+        ++expanded;
+        if (node == t) {
+            found = 1;
+            break;
+        }
+
+        int x = node / w - 1, y = node - (x + 1) * w - 1;
+        int gn = g[node] + 1;
+        auto relax = [&](int next, int nx, int ny) {
+            if (pass[next] && ((state[next] == 0) || ((state[next] == 1) && (gn < g[next])))) {
+                state[next] = 1;
+                g[next] = gn;
+                parent[next] = (int16_t)node;
+                push(gn + h(nx * y_max + ny, nx, ny), next);
+            }
+        };
+        relax(node - w, x - 1, y);
+        relax(node + w, x + 1, y);
+        relax(node - 1, x, y - 1);
+        relax(node + 1, x, y + 1);
+    }
+
+    ss->expanded = expanded;
+    for (int node = found ? t : -1; node >= 0; node = parent[node]) {   // path links for trace_path()
+        int cell = (node / w - 1) * y_max + (node % w - 1);
+        ss->touch(cell);
+        ss->visited[cell] = CLOSED;
+        ss->g_cost[cell] = g[node];
+        ss->parent[cell] = (parent[node] < 0) ? -1 : (parent[node] / w - 1) * y_max + (parent[node] % w - 1);
+    }
+    return found;
+}
+
+#endif //_KERNELS_
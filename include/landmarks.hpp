@@ -0,0 +1,101 @@
+#ifndef _LANDMARKS_
+#define _LANDMARKS_
+
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+#define ALT_LANDMARKS       8           // default number of landmarks
+#define ALT_MAX_LANDMARKS   32          // most landmarks a set holds
+#define LANDMARK_NONE       0xFFFF      // distance of a cell the landmark can not reach
+
+/**
+ * @class landmark_set
+ * @brief Landmarks and their distance tables for the ALT heuristic (A*, landmarks,
+ *        triangle inequality). For every landmark L the BFS distance d(L, n) of each
+ *        cell is kept in 16 bits, and for any two cells of one component
+ *        |d(L, t) - d(L, n)| <= dist(n, t). The largest of these bounds over the
+ *        landmarks is admissible and consistent for every start/target pair, so
+ *        nothing is tied to one target.
+ *        Landmarks are picked farthest-point in the largest component: the first is
+ *        the cell farthest from a seed, each next one the cell farthest from all
+ *        landmarks so far. A landmark whose distances do not fit in 16 bits is
+ *        dropped. Cells of other components keep LANDMARK_NONE, which gives a zero
+ *        bound there and leaves their queries on Manhattan distance.
+ *        On a map with traversal costs the tables hold Dijkstra costs instead. A step
+ *        costs the cell it enters, so d(n, L) = d(L, n) + c(L) - c(n) and the bound
+ *        towards a landmark takes the difference of the target and cell costs.
+ *        The tables are read only during queries and are interleaved per cell, so
+ *        one cache line holds all distances of a cell. They hold the terrain as it
+ *        was built; after terrain changes build a new set.
+ */
+class landmark_set {
+    private:
+        battleship *bu;                     // map
+        int count;                          // landmarks kept
+        vector<int> cells;                  // landmark cell indices
+        vector<uint16_t> dist;              // per cell: count distances, LANDMARK_NONE if unreached
+        uint64_t version;                   // map version the tables were built for
+    public:
+        /**
+         * @brief Constructor for class. Picks the landmarks and runs one BFS from each, or
+         *        one Dijkstra on a map with traversal costs.
+         *
+         * @param b pointer to the battleship holding the map, components built
+         * @param k number of landmarks to pick, at most ALT_MAX_LANDMARKS
+         *
+         */
+        landmark_set(battleship *b, int k = ALT_LANDMARKS);
+
+        /**
+         * @brief Method to copy the distances of a target, for bound() to compare against
+         * @param target target cell index
+         * @param row pointer to get_count() values
+         *
+         */
+        void target_row(int target, uint16_t *row) const {
+            const uint16_t *d = &dist[(size_t)target * count];
+            for (int k = 0; k < count; ++k) {
+                row[k] = d[k];
+            }
+        }
+
+        /**
+         * @brief Method to bound the distance from a cell to a target from below
+         * @param cell cell index
+         * @param row distances of the target from target_row()
+         * @param skew cost of entering the target minus the cost of entering the cell,
+         *        0 without traversal costs
+         * @returns max over the landmarks of d(L, target) - d(L, cell) and
+         *          d(L, cell) - d(L, target) + skew
+         *
+         */
+        int bound(int cell, const uint16_t *row, int skew = 0) const {
+            const uint16_t *d = &dist[(size_t)cell * count];
+            int best = 0;
+            for (int k = 0; k < count; ++k) {
+                int to = (int)row[k] - (int)d[k];               // via d(L, cell) + d(cell, target) >= d(L, target)
+                int from = skew - to;                           // via d(cell, L) <= d(cell, target) + d(target, L)
+                best = (to > best) ? to : best;
+                best = (from > best) ? from : best;
+            }
+            return best;
+        }
+
+        int get_count(void) const { return count; }
+        int get_landmark(int k) const { return cells[k]; }
+        size_t get_bytes(void) const { return dist.size() * sizeof(uint16_t); }
+        bool is_current(void) const { return version == bu->get_version(); }
+};
+
+/**
+ * @brief Function to find a path from start to target of the battleship with ALT.
+ *        Builds a one-off landmark_set, which costs a BFS over the map per landmark;
+ *        keep a landmark_set around to answer many queries.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_alt(battleship *bu, vector<_points*> *sol);
+
+#endif //_LANDMARKS_
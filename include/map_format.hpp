@@ -0,0 +1,120 @@
+#ifndef _MAP_FORMAT_
+#define _MAP_FORMAT_
+
+#include <string>
+#include "definitions.hpp"
+
+#define MAP_FORMAT_MAGIC    "BSMP"      // first four bytes of a binary map
+#define MAP_FORMAT_VERSION  1           // current binary map version
+
+/**
+ * @brief ENUMs for the terrain encoding of a binary map
+ *
+ */
+typedef enum MAP_ENCODING {
+    MAP_ENC_BYTE = 1,               // one _f_type byte per cell, loaded without a copy
+    MAP_ENC_2BIT = 2,               // 2 bits per cell: ground, elevated, start, target
+    MAP_ENC_CHUNKED = 3             // 2 bits per cell in square chunks, paged in by chunked_map
+} _map_encoding;
+
+/**
+ * @brief Header of a binary map file. The terrain data follows at header_size.
+ *        All fields are little endian.
+ *
+ */
+typedef struct MAP_HEADER {
+    char magic[4];                  // MAP_FORMAT_MAGIC
+    uint32_t version;               // MAP_FORMAT_VERSION
+    int32_t x_max;                  // maximum x distance
+    int32_t y_max;                  // maximum y distance
+    int32_t start_x;                // start position, -1 if none
+    int32_t start_y;
+    int32_t target_x;               // target position, -1 if none
+    int32_t target_y;
+    uint32_t encoding;              // _map_encoding of the terrain data
+    uint32_t header_size;           // offset of the terrain data
+    uint64_t data_size;             // bytes of terrain data
+    uint64_t checksum;              // FNV-1a 64 of the terrain data
+    uint8_t reserved[8];
+} _map_header;
+
+static_assert(sizeof(_map_header) == 64, "binary map header must stay 64 bytes");
+
+#define MAP_CHECKSUM_SEED   0xcbf29ce484222325ULL   // FNV-1a 64 offset basis
+
+/**
+ * @brief Function to compute the FNV-1a 64 bit checksum of a buffer
+ * @param data pointer to the buffer
+ * @param len length of the buffer
+ * @param h checksum of the data before the buffer, to checksum a file piece by piece
+ * @returns checksum
+ */
+uint64_t map_checksum(const uint8_t *data, size_t len, uint64_t h = MAP_CHECKSUM_SEED);
+
+/**
+ * @brief Function to check if a file starts with the binary map magic
+ * @param f_name string containing map file path
+ * @returns 1 if the file is a binary map, 0 otherwise
+ */
+int is_binary_map(string f_name);
+
+/**
+ * @brief Function to check the start and target of a binary map header
+ * @param head pointer to the header
+ * @returns 1 if each position is -1/-1 or inside the map, 0 otherwise
+ */
+int map_endpoints_valid(const _map_header *head);
+
+/**
+ * @brief Function to read the header of a binary map file without mapping the terrain
+ * @param f_name string containing map file path
+ * @param head pointer to the header to fill
+ * @returns 1 if succeeded, 0 if the file has no binary map header
+ */
+int read_map_header(string f_name, _map_header *head);
+
+/**
+ * @brief Function to write the map of a battleship as a binary map file
+ * @param f_name string containing output file path
+ * @param bu pointer to the battleship holding the map
+ * @param start pointer to start position, x_pos -1 if none
+ * @param target pointer to target position, x_pos -1 if none
+ * @param encoding terrain encoding to write
+ * @returns 1 if succeeded, 0 if failed
+ */
+int write_map_binary(string f_name, battleship *bu, _field *start, _field *target, _map_encoding encoding);
+
+/**
+ * @class mapped_map
+ * @brief Binary map file mapped into memory. Byte encoded terrain is used in place:
+ *        the pages come straight from the page cache and are shared by every process
+ *        mapping the same file. The mapping is private, so cells changed later are
+ *        copied on write and never reach the file. 2-bit terrain is unpacked once.
+ */
+class mapped_map {
+    private:
+        void *base;                         // start of the mapping
+        size_t length;                      // length of the mapping
+        _map_header head;                   // copy of the file header
+        vector<int8_t> unpacked;            // terrain of a 2-bit encoded map
+        int8_t *terrain;                    // terrain bytes, in the mapping or unpacked
+    public:
+        mapped_map() : base(NULL), length(0), head(), terrain(NULL) {}
+        ~mapped_map();
+        mapped_map(const mapped_map &) = delete;
+        mapped_map &operator=(const mapped_map &) = delete;
+
+        /**
+         * @brief Method to map a binary map file
+         * @param f_name string containing map file path
+         * @param verify 1 to check the terrain checksum
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int open(string f_name, int verify);
+
+        const _map_header *get_header(void) const { return &head; }
+        int8_t *get_terrain(void) { return terrain; }
+};
+
+#endif //_MAP_FORMAT_
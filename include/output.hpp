@@ -0,0 +1,175 @@
+#ifndef _OUTPUT_
+#define _OUTPUT_
+
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+
+#define OUT_BUFFER_SIZE     (1 << 20)   // bytes gathered before a write to the stream
+#define PATH_FORMAT_MAGIC   "BSPT"      // first four bytes of a binary path record
+#define PATH_RUN_MAX        64          // steps one binary run byte holds
+
+/**
+ * @brief ENUMs for what a run writes to stdout
+ *
+ */
+typedef enum OUTPUT_MODE {
+    OUTPUT_TEXT = 0,                // readable text, map rendering only with --render
+    OUTPUT_SILENT = 1,              // nothing, results only in the exit status and --stats
+    OUTPUT_JSON = 2,                // one JSON object per path, directions as runs
+    OUTPUT_BINARY = 3               // one _path_record per path, directions as run bytes
+} _output_mode;
+
+/**
+ * @brief ENUMs for the step directions of a path. x is the map row, so DIR_UP
+ *        goes to the row above.
+ *
+ */
+typedef enum PATH_DIR {
+    DIR_UP = 0,                     // x - 1
+    DIR_DOWN = 1,                   // x + 1
+    DIR_LEFT = 2,                   // y - 1
+    DIR_RIGHT = 3                   // y + 1
+} _path_dir;
+
+/**
+ * @brief Struct to store a run of steps in one direction
+ *
+ */
+typedef struct DIR_RUN {
+    _path_dir dir;                  // direction of every step of the run
+    int steps;                      // number of steps
+} _dir_run;
+
+/**
+ * @brief Header of a binary path record. The run bytes follow the header: bits 7-6
+ *        hold the _path_dir, bits 5-0 the steps - 1, so runs longer than
+ *        PATH_RUN_MAX steps take several bytes. All fields are little endian.
+ *
+ */
+typedef struct PATH_RECORD {
+    char magic[4];                  // PATH_FORMAT_MAGIC
+    int32_t query;                  // query number, 0 for a single run
+    int32_t found;                  // 1 if a valid path is found, 0 if no path
+    int32_t start_x;                // first path point, -1 if no path
+    int32_t start_y;
+    uint32_t points;                // path points, start included
+    uint32_t runs;                  // run bytes after the header
+    uint32_t reserved;
+} _path_record;
+
+static_assert(sizeof(_path_record) == 32, "binary path record header must stay 32 bytes");
+
+/**
+ * @class out_buffer
+ * @brief Buffered writer for everything a run prints. Text is gathered in one block
+ *        and handed to the stream when the block is full, on flush() and when the
+ *        writer goes away, so printing a large map costs a handful of writes instead
+ *        of one stream call per cell.
+ */
+class out_buffer {
+    private:
+        ostream &out;                       // stream the blocks go to
+        vector<char> buf;                   // pending bytes
+        size_t used;                        // bytes pending in buf
+    public:
+        out_buffer(ostream &o, size_t size = OUT_BUFFER_SIZE) : out(o), buf(size), used(0) {}
+        ~out_buffer() { flush(); }
+        out_buffer(const out_buffer &) = delete;
+        out_buffer &operator=(const out_buffer &) = delete;
+
+        /**
+         * @brief Method to hand the pending bytes to the stream and flush it
+         *
+         */
+        void flush(void) {
+            if (used) {
+                out.write(buf.data(), used);
+                used = 0;
+            }
+            out.flush();
+        }
+
+        void put(char c) {
+            if (used == buf.size()) {
+                flush();
+            }
+            buf[used++] = c;
+        }
+
+        void write(const char *s, size_t n) {
+            if (used + n > buf.size()) {
+                flush();
+                if (n > buf.size()) {
+                    out.write(s, n);
+                    return;
+                }
+            }
+            memcpy(buf.data() + used, s, n);
+            used += n;
+        }
+
+        void number(long v) {
+            char tmp[24];
+            char *end = to_chars(tmp, tmp + sizeof(tmp), v).ptr;
+            write(tmp, end - tmp);
+        }
+
+        out_buffer &operator<<(const char *s) { write(s, strlen(s)); return *this; }
+        out_buffer &operator<<(const string &s) { write(s.data(), s.size()); return *this; }
+        out_buffer &operator<<(char c) { put(c); return *this; }
+        out_buffer &operator<<(int v) { number(v); return *this; }
+        out_buffer &operator<<(long v) { number(v); return *this; }
+        out_buffer &operator<<(size_t v) { number((long)v); return *this; }
+};
+
+/**
+ * @brief Function to look up an output mode by name
+ * @param name "text", "silent", "json" or "binary"
+ * @param mode pointer receiving the mode
+ * @returns 1 if the name is known, 0 otherwise
+ */
+int output_mode_of(const string &name, _output_mode *mode);
+
+/**
+ * @brief Function to encode a path as runs of steps in one direction
+ * @param path path points, start first, each a step from the one before
+ * @param runs pointer to vector receiving the runs
+ * @returns number of runs
+ */
+int encode_runs(const vector<_points> &path, vector<_dir_run> *runs);
+
+/**
+ * @brief Function to write one path in a compact output mode.
+ *        OUTPUT_TEXT:   <query> <points>: (x,y) (x,y) ...
+ *        OUTPUT_JSON:   {"query": 0, "found": 1, "points": 5, "start": [2,2], "runs": "D2R2"}
+ *        OUTPUT_BINARY: a _path_record and its run bytes
+ *        OUTPUT_SILENT writes nothing.
+ * @param ob writer
+ * @param mode output mode
+ * @param query query number, 0 for a single run
+ * @param found 1 if a valid path is found, 0 if no path
+ * @param path path points, start first
+ */
+void write_path(out_buffer *ob, _output_mode mode, long query, int found, const vector<_points> &path);
+
+/**
+ * @brief Function to render the loaded map, one character per cell: '-' ground,
+ *        '8' elevated, '@' start and '*' target
+ *
+ * @param ob writer
+ * @param bu pointer to the battleship holding the map
+ */
+void render_map(out_buffer *ob, battleship *bu);
+
+/**
+ * @brief Function to render the map with the path of the last search marked '@'
+ *
+ * @param ob writer
+ * @param bu pointer to the battleship holding the map and the marked path
+ */
+void render_path(out_buffer *ob, battleship *bu);
+
+#endif //_OUTPUT_
@@ -0,0 +1,106 @@
+#ifndef _PATH_CACHE_
+#define _PATH_CACHE_
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "definitions.hpp"
+
+#define CACHE_ENTRY_BYTES   96          // charged per path: list node, key index node, bookkeeping
+#define CACHE_CELL_BYTES    48          // charged per path cell: the cell and its subpath index node
+
+/**
+ * @class path_cache
+ * @brief Bounded LRU cache of solved paths keyed by (map hash, start, target). The
+ *        map hash is battleship::get_map_hash(), so a terrain change makes every
+ *        lookup miss the paths of the old terrain, which then age out of the LRU, and
+ *        a map changed back finds its paths again. Every path is charged for its
+ *        memory and the least recently used paths are dropped to stay in the budget.
+ *        A cache of optimal paths also indexes every cell of every path: any piece
+ *        of a shortest path is a shortest path between its ends, in either direction,
+ *        so a query whose endpoints both lie on a cached path is answered with that
+ *        piece. All methods lock, so one cache serves many threads.
+ */
+class path_cache {
+    private:
+        typedef struct CACHE_ENTRY {
+            uint64_t map;                   // map hash the path was found on
+            int start;                      // start cell index
+            int target;                     // target cell index
+            vector<int> cells;              // path, start first
+            size_t bytes;                   // memory charged
+        } _cache_entry;
+        typedef list<_cache_entry>::iterator _entry_ref;
+
+        typedef struct CELL_REF {
+            _entry_ref entry;               // path holding the cell
+            int pos;                        // position of the cell on the path
+        } _cell_ref;
+
+        struct key_hash {
+            size_t operator()(const pair<uint64_t, uint64_t> &k) const {
+                return (size_t)(k.first ^ (k.second * 0x9E3779B97F4A7C15ULL));
+            }
+        };
+
+        list<_cache_entry> lru;                                             // most recently used first
+        unordered_map<pair<uint64_t, uint64_t>, _entry_ref, key_hash> keys; // (map, start:target) to path
+        unordered_multimap<int, _cell_ref> on_path;                         // cell to the paths crossing it
+        bool subpaths;                      // paths are optimal, pieces may be served
+        mutex lock;                         // guards everything below too
+        _cache_stats stats;                 // counters, budget and bytes included
+
+        static pair<uint64_t, uint64_t> key_of(uint64_t map, int start, int target) {
+            return {map, ((uint64_t)(uint32_t)start << 32) | (uint32_t)target};
+        }
+        void evict(void);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param budget memory budget in bytes
+         * @param optimal the cached paths are shortest paths, enables subpath reuse
+         *
+         */
+        path_cache(size_t budget, bool optimal);
+
+        /**
+         * @brief Method to look up a path and mark it most recently used
+         * @param map map hash of the query
+         * @param start start cell index
+         * @param target target cell index
+         * @param cells pointer to vector receiving the path, start first
+         * @returns 1 for a cached path, 2 for a piece of a cached path, 0 on a miss
+         *
+         */
+        int lookup(uint64_t map, int start, int target, vector<int> *cells);
+
+        /**
+         * @brief Method to add a found path, dropping the least recently used paths
+         *        while the budget is exceeded. Paths larger than the budget are not kept.
+         * @param map map hash the path was found on
+         * @param start start cell index
+         * @param target target cell index
+         * @param cells path, start first
+         *
+         */
+        void insert(uint64_t map, int start, int target, const vector<int> &cells);
+
+        /**
+         * @brief Method to add the time of one query to the hit or miss latency
+         * @param hit the query was answered from the cache
+         * @param us query time in microseconds
+         *
+         */
+        void record(bool hit, double us);
+
+        /**
+         * @brief Method to drop every path
+         *
+         */
+        void clear(void);
+
+        _cache_stats get_stats(void);
+};
+
+#endif //_PATH_CACHE_
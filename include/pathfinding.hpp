@@ -8,16 +8,151 @@ typedef struct POINTS {
     int y;
 } _points;
 
+class landmark_set;
+
+/**
+ * @brief Search modes available to find_path()
+ * 
+ */
+typedef enum SEARCH_MODE {
+    SEARCH_GREEDY = 0,              // original greedy depth first walk
+    SEARCH_ASTAR = 1,               // best-first A* with a bucket open list
+    SEARCH_JPS = 2,                 // jump point search for the 4-connected grid
+    SEARCH_HPA = 3,                 // hierarchical A* over cluster entrances, near optimal
+    SEARCH_BIDIR = 4,               // bidirectional A* from both ends, optimal
+    SEARCH_BFS = 5,                 // bit-parallel BFS wavefront, optimal
+    SEARCH_ALT = 6,                 // A* with landmark lower bounds, optimal
+    SEARCH_HDA = 7                  // hash distributed A* over worker threads, optimal
+} _search_mode;
+
+/**
+ * @brief Function to find the vaild path from start to target of the battleship
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @param mode search mode to use
+ * @return return 1 if a valid path is found. 0 if no path
+ * 
+ */
+int find_path(battleship *bu, vector<_points*> *sol, _search_mode mode = SEARCH_ASTAR);
+
+/**
+ * @brief Function to find a path with the original greedy depth first walk.
+ *        It uses the precalculated costs for each nodes and the state machine
+ *        to iterate through the probable path. The path is not optimal.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points
+ * @return return 1 if a valid path is found. 0 if no path
+ * 
+ */
+int find_path_greedy(battleship *bu, vector<_points*> *sol);
+
+/**
+ * @brief Function to run A* between two cells of the battleship map. The open list
+ *        is a bucket queue on f = g + Manhattan distance, expanded cells are closed
+ *        and parent links are left in the search state for trace_path(). On a map
+ *        with traversal costs (battleship::set_costs()) the path has the lowest cost:
+ *        g adds up the costs of the entered cells, the Manhattan distance is scaled
+ *        by the lowest cost and the bucket queue works as Dial's algorithm.
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ * 
+ */
+int astar_search(battleship *bu, search_state *ss, int start, int target);
+
+/**
+ * @brief Function to run A* with the ALT heuristic between two cells. The bound of
+ *        a cell is the larger of its Manhattan distance and the landmark bound of
+ *        landmark_set::bound(), so fewer cells are expanded behind obstacles and the
+ *        path is as short as the one of astar_search(). On a map with traversal costs
+ *        the landmark tables hold costs and the path is as cheap as with A*.
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param lm landmark tables built for the current terrain
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int alt_search(battleship *bu, search_state *ss, const landmark_set *lm, int start, int target);
+
 /**
- * @brief Function to find the vaild path from start to target
- *        It uses A* method on the precalculated costs for each nodes
- *        and uses the state machine to iterate through the probable 
- *        path
+ * @brief Function to run 4-connected Jump Point Search between two cells. Moves
+ *        along a row continue until a forced neighbour shows up in an adjacent
+ *        row; moves across rows stop wherever a row jump from the cell finds a
+ *        jump point. Only jump points enter the open list, parent links join
+ *        jump points on straight lines. Same path length as astar_search().
  * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
  * @return return 1 if a valid path is found. 0 if no path
  * 
  */
-int find_path(battleship *bu, vector<_points*> *sol);
+int jps_search(battleship *bu, search_state *ss, int start, int target);
+
+/**
+ * @brief Function to run a bidirectional A* between two cells. Both sides order their
+ *        open lists by f = g + Manhattan distance to the other end and the side with
+ *        the smaller open list expands next. The search stops once the best meeting
+ *        path costs no more than max(fmin_fwd, fmin_bwd), so the path is optimal. The
+ *        two halves are spliced into the forward state, ready for trace_path().
+ * @param bu pointer the the battleship class
+ * @param ss forward search state, reset by the call, receives the spliced path
+ * @param back backward search state, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int bidir_search(battleship *bu, search_state *ss, search_state *back, int start, int target);
+
+/**
+ * @brief Function to add up the costs of the cells a path enters
+ * @param bu pointer the the battleship class
+ * @param path path points, start first
+ * @return path cost, the number of steps on a map without costs
+ *
+ */
+long path_cost(battleship *bu, const vector<_points> &path);
+
+/**
+ * @brief Function to rebuild a path from the parent links of a finished search,
+ *        marks the path cells in the search state. Parent links that skip along
+ *        a straight line are filled in cell by cell
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param sol pointer to vector receiving the path points, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<_points*> *sol);
+
+/**
+ * @brief Function to rebuild a path into a vector of point values, see trace_path()
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param sol pointer to vector receiving the path points, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<_points> *sol);
+
+/**
+ * @brief Function to rebuild a path into a vector of cell indices, see trace_path().
+ *        The vector is overwritten, so a reused one keeps its capacity.
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param cells pointer to vector receiving the path cells, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<int> *cells);
 
 
 #endif //_PATHFINDING_
\ No newline at end of file
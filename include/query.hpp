@@ -0,0 +1,95 @@
+#ifndef _QUERY_
+#define _QUERY_
+
+#include "definitions.hpp"
+#include "pathfinding.hpp"
+#include "landmarks.hpp"
+
+/**
+ * @brief Struct to view the path of the last route() call. The cells are packed as
+ *        cell indices (x * y_max + y, see battleship::x_of() and y_of()), start first,
+ *        and live in the arena until its next query.
+ *
+ */
+typedef struct PATH_SPAN {
+    const int *cells;               // path cells, start first, NULL if no path
+    int points;                     // path points, start included, 0 if no path
+} _path_span;
+
+/**
+ * @class query_arena
+ * @brief Caller owned scratch for route(): the search states and the path buffer of
+ *        one map, sized from the map so no query has to grow them. The open list gets
+ *        a bucket ring covering the largest f step of a search (a jump of JPS, or two
+ *        of the highest step cost) and a pool of four entries per cell, as a cell is
+ *        pushed at most once per neighbour; the path buffer gets one point per cell.
+ *        That is about 36 bytes per cell on top of the search state, but it is only
+ *        reserved, and pages a search never reaches are not touched. The backward
+ *        state is sized by the first SEARCH_BIDIR query. One arena per thread; the map
+ *        and the landmark tables may be shared.
+ */
+class query_arena {
+    private:
+        size_t cells;                       // cells of the map the states are sized for
+        int spread;                         // key spread the open lists are sized for
+        search_state fwd;                   // search state of every mode
+        search_state back;                  // backward state of SEARCH_BIDIR
+        vector<int> path;                   // cells of the last path
+        const landmark_set *lm;             // landmark tables for SEARCH_ALT, NULL if none
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param bu pointer to the battleship holding the map
+         * @param landmarks landmark tables of the map for SEARCH_ALT, NULL if not used
+         *
+         */
+        query_arena(battleship *bu, const landmark_set *landmarks = NULL);
+
+        /**
+         * @brief Method to fit the states to a map, a no-op if the size is unchanged
+         * @param bu pointer to the battleship holding the map
+         *
+         */
+        void bind(battleship *bu);
+
+        search_state *get_state(void) { return &fwd; }
+        search_state *get_back_state(void) {
+            if (back.size() != cells) {                         // sized on first use only
+                back.resize(cells);
+                back.open_list.reserve(spread, 4 * cells + 1);
+            }
+            return &back;
+        }
+        vector<int> *get_path(void) { return &path; }
+        const landmark_set *get_landmarks(void) const { return lm; }
+};
+
+/**
+ * @brief Function to find a path between two cells with no heap allocation once the
+ *        arena is sized. Modes SEARCH_ASTAR, SEARCH_JPS, SEARCH_BIDIR and, with
+ *        landmarks in the arena, SEARCH_ALT are served; the others build tables per
+ *        call and go through find_path() or the batch engine instead.
+ * @param bu pointer the the battleship class
+ * @param qa arena of the calling thread, fitted to the map by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @param mode search mode
+ * @param path pointer to the span receiving the path, valid until the next query
+ * @return return 1 if a valid path is found. 0 if no path. -1 if the mode is not served
+ *
+ */
+int route(battleship *bu, query_arena *qa, int start, int target, _search_mode mode, _path_span *path);
+
+/**
+ * @brief Function to write the steps of a path as _path_dir codes (output.hpp), one
+ *        byte per step
+ * @param bu pointer the the battleship class
+ * @param path path from route()
+ * @param dirs pointer to at least path.points - 1 bytes receiving the codes
+ * @return number of steps
+ *
+ */
+int path_steps(battleship *bu, const _path_span &path, uint8_t *dirs);
+
+#endif //_QUERY_
@@ -5,6 +5,18 @@
 
 using namespace rapidjson;
 
+#define COST_MAX            255         // highest traversal cost of a cell
+
+/**
+ * @brief Struct to store one entry of a traversal cost table
+ *
+ */
+typedef struct COST_RULE {
+    string layer;                   // Tiled layer name
+    double tile;                    // tile value in that layer
+    int cost;                       // cost of entering a cell with that tile, 1..COST_MAX
+} _cost_rule;
+
 /**
  * @brief Function to read JSON file passed in as agrument. It reads and 
  *        stores the json formatted data to the doc object and closes the 
@@ -29,4 +41,43 @@ int read_file(Document *doc, string f_name);
  */
 void print_map_and_mark(const Value *buff, _field *start, _field *target, int y_max);
 
+/**
+ * @brief Function to stream the "world" layer of a Tiled JSON map straight into the
+ *        terrain of a battleship. It uses the rapidjson SAX Reader over a timed fread() stream,
+ *        so no Document is built: other layers are skipped without being stored, the
+ *        tile values are written to the packed terrain in one pass and start/target
+ *        are picked up on the way. Parsing stops once the world layer is complete.
+ *        start and target are left untouched if the map does not mark them.
+ *
+ * @param f_name string containing map file path
+ * @param bu pointer to the battleship sized for the map
+ * @param start pointer to start position
+ * @param target pointer to target position
+ * @param times pointer receiving the read and parse phase times, NULL if not needed
+ * @returns 1 if succeeded, 0 if failed
+ */
+int read_map_stream(string f_name, battleship *bu, _field *start, _field *target, _phase_times *times = NULL);
+
+/**
+ * @brief Function to read a traversal cost table, one "<layer> <tile> <cost>" per line.
+ *        Empty lines and lines starting with '#' are skipped.
+ * @param f_name string containing the table file path
+ * @param table pointer to vector receiving the entries
+ * @returns 1 if succeeded, 0 if a line could not be parsed
+ */
+int read_cost_table(string f_name, vector<_cost_rule> *table);
+
+/**
+ * @brief Function to stream the layers a cost table names out of a Tiled JSON map and
+ *        give the battleship its traversal costs. A cell costs the highest cost of the
+ *        table entries its tiles match, 1 if none matches. Layers the table does not
+ *        name are skipped without being stored.
+ *
+ * @param f_name string containing map file path
+ * @param bu pointer to the battleship holding the map
+ * @param table cost table
+ * @returns 1 if succeeded, 0 if failed
+ */
+int read_cost_layers(string f_name, battleship *bu, const vector<_cost_rule> &table);
+
 #endif // _READ_MAP_
\ No newline at end of file
@@ -0,0 +1,164 @@
+#ifndef _SERVER_
+#define _SERVER_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include "definitions.hpp"
+#include "batch.hpp"
+#include "dstar.hpp"
+#include "map_format.hpp"
+#include "read_map.hpp"
+
+#define SERVER_MAP          "default"   // name of the map given on the command line
+#define SERVER_LINE_MAX     4096        // longest request line
+
+/**
+ * @brief Struct to store how a server searches its maps
+ *
+ */
+typedef struct SERVER_OPTIONS {
+    int threads;                    // workers per map, 0 for one per hardware thread
+    _search_mode mode;              // search mode for every route request
+    int cluster;                    // HPA* cluster side
+    size_t cache_bytes;             // path cache budget per map, 0 for no cache
+    int landmarks;                  // ALT landmarks
+    vector<_cost_rule> costs;       // traversal cost table for JSON maps, empty for unit costs
+} _server_options;
+
+/**
+ * @class route_server
+ * @brief Long running server that keeps maps resident and answers a line protocol on
+ *        a Unix domain socket or on stdin/stdout. Every map has a batch_engine, so
+ *        route requests run concurrently on the map's workers with per-worker search
+ *        state, and replies can come back out of request order. A terrain update first
+ *        waits for the routes its connection sent before it, then takes the map
+ *        exclusively, waiting for the routes of other connections. Tracked ships keep a
+ *        D* Lite plan each; a terrain update only queues the repair of their plans and
+ *        the next move of a ship repairs its plan. Requests, one per line:
+ *
+ *          route <id> <map> <sx> <sy> <tx> <ty>    find a path
+ *          set <id> <map> <x> <y> ground|elevated  change one cell
+ *          track <id> <map> <sx> <sy> <tx> <ty>    plan a ship with D* Lite, kept as track <id>
+ *          move <id> <map> <track> <x> <y>         move a tracked ship and repair its plan
+ *          untrack <id> <map> <track>              drop a tracked ship
+ *          load <id> <map> <file> [<x_max> <y_max>] load another map
+ *          stats <id>                              request count and latency percentiles
+ *          quit                                    close the connection
+ *          shutdown                                close the connection and stop the server
+ *
+ *        Replies carry the request id and the service time in microseconds, from the
+ *        request line being read to the reply being ready:
+ *
+ *          <id> path <points> <sx> <sy> <runs> <us>   route, track and move; runs as in --output json, e.g. D2R2
+ *          <id> none <us>                             no path
+ *          <id> ok <us>                               set, load and untrack
+ *          <id> stats {...}
+ *          <id> error <message>
+ */
+class route_server {
+    private:
+        typedef struct RESIDENT_MAP {
+            mapped_map mapped;              // binary map pages, must outlive the battleship
+            _field start;                   // start and target from the map file
+            _field target;
+            unique_ptr<battleship> bu;      // terrain, components and map hash
+            unique_ptr<batch_engine> engine;// workers, per-worker search state, cache
+            shared_mutex lock;              // routes share it, terrain updates and tracks own it
+            map<long, unique_ptr<dstar_lite>> tracks;   // D* Lite plans by track id, guarded by lock
+        } _resident_map;
+
+        typedef struct CONNECTION {
+            int in_fd;                      // requests
+            int out_fd;                     // replies
+            bool is_socket;                 // out_fd is a socket
+            mutex write_lock;               // one reply at a time
+            mutex pending_lock;             // guards pending
+            condition_variable drained;     // signalled when pending drops to 0
+            int pending;                    // routes queued or running
+        } _connection;
+
+        _server_options opts;
+        mutex maps_lock;                    // guards maps, not the maps themselves
+        map<string, unique_ptr<_resident_map>> maps;
+        mutex latency_lock;                 // guards latency
+        vector<double> latency;             // service time of every route in microseconds
+        atomic<long> requests;              // requests answered, errors included
+        atomic<long> errors;                // requests answered with an error
+        atomic<bool> stopping;              // shutdown received
+        int listen_fd;                      // listening socket, -1 for stdin
+        mutex conn_lock;                    // guards conns
+        vector<_connection *> conns;        // socket connections being served
+
+        _resident_map *find_map(const string &name);
+        void reply(_connection *c, const string &line);
+        void route(_connection *c, _resident_map *rm, long id, const _query &q,
+                   chrono::steady_clock::time_point t0);
+        int handle(_connection *c, const string &line);
+        void serve(_connection *c);
+    public:
+        /**
+         * @brief Constructor for class.
+         *
+         * @param o search options used for every map
+         *
+         */
+        route_server(const _server_options &o);
+
+        /**
+         * @brief Method to load a map and make it resident. JSON maps need their size,
+         *        binary maps carry it.
+         * @param name name the requests use
+         * @param file map file, JSON or binary
+         * @param x_max map rows, 0 for a binary map
+         * @param y_max map columns, 0 for a binary map
+         * @param err pointer to string receiving the reason of a failure
+         * @returns 1 if succeeded, 0 if failed
+         *
+         */
+        int load(const string &name, const string &file, int x_max, int y_max, string *err);
+
+        /**
+         * @brief Method to serve a Unix domain socket, one thread per connection, until
+         *        a shutdown request. The socket file is replaced and removed again.
+         * @param path socket path
+         * @returns 0 if succeeded, -1 if failed
+         *
+         */
+        int run_socket(const string &path);
+
+        /**
+         * @brief Method to serve requests from stdin with replies on stdout until the
+         *        input ends or a quit or shutdown request
+         * @returns 0 if succeeded, -1 if failed
+         *
+         */
+        int run_stdin(void);
+};
+
+/**
+ * @brief Function to connect to a server socket, send the request lines of stdin and
+ *        print every reply, waiting for the replies of all routes before it returns
+ * @param path socket path
+ * @returns 0 if succeeded, -1 if failed
+ */
+int run_client(const string &path);
+
+/**
+ * @brief Function to measure a server with closed loop clients: every connection sends
+ *        one route request, waits for its reply and sends the next. Queries are read
+ *        like batch queries and used round robin. Prints throughput and round-trip and
+ *        service time percentiles.
+ * @param path socket path
+ * @param query_file query file, "-" for stdin
+ * @param map_name map the routes go to
+ * @param connections number of client connections
+ * @param requests number of route requests over all connections
+ * @returns 0 if succeeded, -1 if failed
+ */
+int run_load(const string &path, const string &query_file, const string &map_name, int connections, long requests);
+
+#endif //_SERVER_
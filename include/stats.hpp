@@ -0,0 +1,151 @@
+#ifndef _STATS_
+#define _STATS_
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Search event counters. They are only updated in builds with PATH_STATS
+ *        defined (make STATS=1); otherwise STAT_ADD()/STAT_PEAK() expand to nothing
+ *        and the search loops carry no extra work.
+ *
+ */
+#ifdef PATH_STATS
+#define STATS_ENABLED               1
+#define STAT_ADD(owner, counter, n) ((owner)->counters.counter += (n))
+#define STAT_PEAK(owner, counter, v)                                            \
+    do {                                                                        \
+        if ((long)(v) > (owner)->counters.counter) {                           \
+            (owner)->counters.counter = (long)(v);                              \
+        }                                                                       \
+    } while (0)
+#else
+#define STATS_ENABLED               0
+#define STAT_ADD(owner, counter, n) ((void)0)
+#define STAT_PEAK(owner, counter, v) ((void)0)
+#endif
+
+/**
+ * @brief Struct to store the event counters of a search
+ *
+ */
+typedef struct SEARCH_COUNTERS {
+    long generated;                 // neighbours looked at
+    long pushes;                    // open list pushes (stack pushes for greedy)
+    long pops;                      // open list pops, stale entries included
+    long stale;                     // pops of entries already closed
+    long backtracks;                // greedy dead ends walked back from
+    long peak_open;                 // largest open list (stack for greedy)
+} _search_counters;
+
+/**
+ * @brief Function to add the counters of one search to a running total
+ * @param total pointer to the total
+ * @param c counters to add
+ */
+inline void add_counters(_search_counters *total, const _search_counters &c) {
+    total->generated += c.generated;
+    total->pushes += c.pushes;
+    total->pops += c.pops;
+    total->stale += c.stale;
+    total->backtracks += c.backtracks;
+    if (c.peak_open > total->peak_open) {
+        total->peak_open = c.peak_open;
+    }
+}
+
+/**
+ * @brief Struct to store the counters of a path cache. They are always kept, a
+ *        lookup costs far more than the counting.
+ *
+ */
+typedef struct CACHE_STATS {
+    long lookups;                   // queries looked up
+    long hits;                      // answered with a cached path between the same endpoints
+    long sub_hits;                  // answered with a piece of a longer cached path
+    long misses;                    // searched
+    long inserts;                   // paths added
+    long evictions;                 // paths dropped to stay in the budget
+    long entries;                   // paths held
+    long bytes;                     // memory charged for the held paths
+    long budget;                    // memory budget in bytes
+    double hit_us;                  // time of all hit queries in microseconds
+    double miss_us;                 // time of all missed queries, search included
+} _cache_stats;
+
+/**
+ * @brief Struct to store the counters of an out-of-core chunked map: its chunk cache
+ *        and the search scratch allocated per touched chunk
+ *
+ */
+typedef struct CHUNK_STATS {
+    long hits;                      // chunk lookups answered from memory
+    long misses;                    // chunk lookups read from the file
+    long evictions;                 // chunks dropped to stay in the budget
+    long bytes_read;                // terrain bytes read from the file
+    long resident;                  // chunks held
+    long budget;                    // chunk cache budget in bytes
+    long scratch_chunks;            // most chunks of search scratch one search used
+    long scratch_bytes;             // memory of the scratch chunks allocated
+} _chunk_stats;
+
+/**
+ * @brief Struct to store the time of each phase of a run in milliseconds
+ *
+ */
+typedef struct PHASE_TIMES {
+    double read;                    // file read, or map and check of a binary map
+    double parse;                   // JSON parse, start/target scan and terrain fill
+    double grid;                    // terrain allocation and connected components
+    double search;                  // path search
+    double output;                  // printing map, path and results
+} _phase_times;
+
+/**
+ * @class phase_clock
+ * @brief Stopwatch for the phases of a run, lap() returns the time since the
+ *        previous lap
+ */
+class phase_clock {
+    private:
+        chrono::steady_clock::time_point last;
+    public:
+        phase_clock() : last(chrono::steady_clock::now()) {}
+
+        double lap(void) {
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            double ms = chrono::duration<double, milli>(now - last).count();
+            last = now;
+            return ms;
+        }
+};
+
+/**
+ * @brief Function to fetch a percentile of sorted latencies
+ * @param v sorted latencies
+ * @param p percentile, 0..100
+ * @returns latency
+ */
+double percentile(const vector<double> &v, double p);
+
+/**
+ * @brief Function to print the stats of a run as one JSON object
+ * @param out stream to write to
+ * @param mode search mode name
+ * @param t phase times
+ * @param queries searches run
+ * @param found searches that found a path
+ * @param points path points over all found paths
+ * @param expanded nodes expanded over all searches
+ * @param c event counters over all searches, only printed when STATS_ENABLED
+ * @param cache path cache counters, NULL if no cache was used
+ * @param chunks chunked map counters, NULL for a map held in memory
+ */
+void print_stats_json(ostream &out, const char *mode, const _phase_times &t, long queries, long found, long points,
+                      long expanded, const _search_counters &c, const _cache_stats *cache = NULL,
+                      const _chunk_stats *chunks = NULL);
+
+#endif //_STATS_
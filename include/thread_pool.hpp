@@ -0,0 +1,80 @@
+#ifndef _THREAD_POOL_
+#define _THREAD_POOL_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class thread_pool
+ * @brief Fixed size pool of worker threads with work stealing. Every worker owns
+ *        a task deque; it takes work from the front of its own deque and steals
+ *        from the front of the other deques when it runs dry. Tasks are handed
+ *        out round robin, so taking the oldest first costs no locality and keeps
+ *        a task of a waiting client from being passed over by later ones. Tasks
+ *        receive the id of the worker running them so callers can keep
+ *        per-worker scratch.
+ */
+class thread_pool {
+    private:
+        struct worker_queue {
+            mutex lock;                             // guards tasks
+            deque<function<void(int)>> tasks;       // tasks queued on this worker
+        };
+        vector<unique_ptr<worker_queue>> queues;    // one deque per worker
+        vector<thread> workers;                     // worker threads
+        mutex state_lock;                           // guards the counters below
+        condition_variable wake;                    // signalled when work arrives or on stop
+        condition_variable idle;                    // signalled when all work is done
+        size_t queued;                              // tasks sitting in a deque
+        size_t pending;                             // tasks submitted but not finished
+        size_t next_queue;                          // round robin submit position
+        bool stopping;                              // set by the destructor
+
+        bool try_pop(int id, function<void(int)> *task);
+        void worker_main(int id);
+    public:
+        /**
+         * @brief Constructor for class, starts the workers
+         * @param threads number of workers, 0 for one per hardware thread
+         *
+         */
+        thread_pool(int threads);
+
+        /**
+         * @brief Destructor for class, finishes queued work and joins the workers
+         *
+         */
+        ~thread_pool();
+
+        /**
+         * @brief Method to queue a task
+         * @param task callable taking the worker id
+         *
+         */
+        void submit(function<void(int)> task);
+
+        /**
+         * @brief Method to block until every submitted task has finished
+         *
+         */
+        void wait(void);
+
+        /**
+         * @brief Method to finish queued work and join the workers, for owners that must
+         *        know no task runs before they tear down what tasks use. No task may be
+         *        submitted afterwards.
+         *
+         */
+        void stop(void);
+
+        int size(void) const { return (int)workers.size(); }
+};
+
+#endif //_THREAD_POOL_
@@ -0,0 +1,315 @@
+/**
+ * @brief   Batch query file
+ * @details This file contains the batch engine which loads a map once and solves a stream of
+ *          start/target pairs across all cores. Results come back in input order.
+ *
+ */
+#include <chrono>
+#include <sstream>
+#include "batch.hpp"
+
+/**
+ * @brief Function to read routing queries, one "sx sy tx ty" per line.
+ *        Empty lines and lines starting with '#' are skipped.
+ * @param in stream to read from
+ * @param queries pointer to vector receiving the queries
+ * @returns 1 if succeeded, 0 if a line could not be parsed
+ */
+int read_queries(istream &in, vector<_query> *queries) {
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        ++line_no;
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == string::npos) || (line[first] == '#')) {
+            continue;
+        }
+        istringstream fields(line);
+        _query q;
+        if (!(fields >> q.start.x >> q.start.y >> q.target.x >> q.target.y)) {
+            cerr << "Error: Bad query on line " << line_no << ": " << line << endl;
+            return 0;
+        }
+        queries->push_back(q);
+    }
+    return 1;
+}
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param b pointer to the battleship holding the map
+ * @param threads number of workers, 0 for one per hardware thread
+ * @param m search mode, SEARCH_ASTAR, SEARCH_JPS, SEARCH_HPA, SEARCH_BIDIR, SEARCH_BFS or SEARCH_ALT
+ * @param cluster HPA* cluster side, the graph is built here for SEARCH_HPA
+ * @param cache_bytes memory budget of the path cache, 0 for no cache
+ * @param k number of landmarks, the tables are built here for SEARCH_ALT
+ *
+ */
+batch_engine::batch_engine(battleship *b, int threads, _search_mode m, int cluster, size_t cache_bytes, int k)
+    : bu(b), mode(m), pool(threads), scratch(pool.size()), expanded(pool.size(), 0),
+      counters(pool.size(), _search_counters()), landmark_epoch(0), rebuilding(false), chunk(16), landmark_count(k) {
+    if (!bu->has_border()) {                                    // read by the A* and ALT kernels of every worker
+        bu->build_border();
+    }
+    if (mode == SEARCH_BIDIR) {
+        back_scratch.resize(pool.size());
+    }
+    if (mode == SEARCH_HPA) {
+        hierarchy = make_unique<hpa_graph>(bu, cluster);
+        hpa_scratch.resize(pool.size());
+    }
+    if (mode == SEARCH_BFS) {
+        bits = make_unique<bit_grid>(bu);
+        bfs_scratch.resize(pool.size());
+    }
+    if (mode == SEARCH_ALT) {
+        landmarks.store(make_shared<const landmark_set>(bu, k));
+    }
+    if (cache_bytes) {                                          // HPA* paths are near optimal, no pieces of them
+        if (!bu->has_map_hash()) {
+            bu->build_map_hash();
+        }
+        cache = make_unique<path_cache>(cache_bytes, mode != SEARCH_HPA);
+        cache_cells.resize(pool.size());
+    }
+}
+
+/**
+ * @brief Destructor for class, stops the workers first, so no query can start a
+ *        rebuild or use the scratch, then waits for a landmark rebuild in the background
+ *
+ */
+batch_engine::~batch_engine() {
+    pool.stop();
+    if (rebuild_thread.joinable()) {
+        rebuild_thread.join();
+    }
+}
+
+/**
+ * @brief Method to solve one query on the calling thread's behalf
+ * @param worker worker id, selects the search state
+ * @param q query to solve
+ * @param res pointer to the result
+ *
+ */
+void batch_engine::solve(int worker, const _query &q, _query_result *res) {
+    res->found = 0;
+    res->path.clear();
+    if ((q.start.x < 0) || (q.start.x >= bu->get_x_max()) || (q.start.y < 0) || (q.start.y >= bu->get_y_max()) ||
+        (q.target.x < 0) || (q.target.x >= bu->get_x_max()) || (q.target.y < 0) || (q.target.y >= bu->get_y_max())) {
+        return;
+    }
+
+    int start = bu->index(q.start.x, q.start.y);
+    int target = bu->index(q.target.x, q.target.y);
+    if (!cache) {
+        search(worker, start, target, res);
+        return;
+    }
+
+    // answer from the cache, or search and keep the path
+    auto t0 = chrono::steady_clock::now();
+    vector<int> *cells = &cache_cells[worker];
+    uint64_t map = bu->get_map_hash();
+    bool hit = cache->lookup(map, start, target, cells) > 0;
+    if (hit) {
+        res->found = 1;
+        res->path.resize(cells->size());
+        for (size_t i = 0; i < cells->size(); ++i) {
+            res->path[i].x = bu->x_of((*cells)[i]);
+            res->path[i].y = bu->y_of((*cells)[i]);
+        }
+    } else {
+        search(worker, start, target, res);
+        if (res->found) {
+            cells->resize(res->path.size());
+            for (size_t i = 0; i < res->path.size(); ++i) {
+                (*cells)[i] = bu->index(res->path[i].x, res->path[i].y);
+            }
+            cache->insert(map, start, target, *cells);
+        }
+    }
+    cache->record(hit, chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+}
+
+/**
+ * @brief Method to refresh the shared search structures after a terrain change.
+ *        Call it after battleship::set_terrain() for every changed cell, with no
+ *        query running. A blocked cell only lengthens distances, so the landmark
+ *        bounds stay admissible and consistent. A cleared cell can shorten them, so
+ *        the tables are dropped and rebuilt in the background.
+ * @param cell cell index
+ *
+ */
+void batch_engine::update_cell(int cell) {
+    if (hierarchy) {
+        hierarchy->update_cell(cell);
+    }
+    if (bits) {
+        bits->update_cell(cell);
+    }
+    if ((mode == SEARCH_ALT) && bu->is_passable(cell)) {
+        {
+            lock_guard<mutex> guard(landmark_lock);
+            ++landmark_epoch;
+            landmarks.store(nullptr);
+        }
+        rebuild_landmarks();
+    }
+}
+
+/**
+ * @brief Method to start a background rebuild of the landmark tables unless one is
+ *        running. The terrain is copied here, so call it with no terrain change
+ *        running: from update_cell() or from a query. The rebuild only swaps its
+ *        tables in if no cell was cleared since the copy. landmark_lock guards
+ *        rebuild_thread, so workers racing here start one rebuild between them.
+ *
+ */
+void batch_engine::rebuild_landmarks(void) {
+    if (rebuilding.load()) {                                    // the common case while stale, no lock taken
+        return;
+    }
+    lock_guard<mutex> guard(landmark_lock);
+    if (rebuilding.load()) {
+        return;
+    }
+    if (rebuild_thread.joinable()) {                            // finished: it clears rebuilding after its last lock
+        rebuild_thread.join();
+    }
+    rebuilding.store(true);
+    auto build = make_shared<_landmark_build>();
+    build->terrain.assign(bu->get_terrain_data(), bu->get_terrain_data() + bu->get_cells());
+    long epoch = landmark_epoch;
+    rebuild_thread = thread([this, build, epoch]() {
+        _field none = {};
+        none.x_pos = -1;
+        build->map = make_unique<battleship>(1, bu->get_x_max(), bu->get_y_max(), &none, &none, build->terrain.data());
+        if (bu->has_costs()) {                                  // costs never change after loading
+            vector<uint8_t> costs(bu->get_cells());
+            for (size_t i = 0; i < costs.size(); ++i) {
+                costs[i] = (uint8_t)bu->step_cost((int)i);
+            }
+            build->map->set_costs(move(costs));
+        }
+        build->map->build_components();
+        build->set = make_unique<landmark_set>(build->map.get(), landmark_count);
+        {
+            lock_guard<mutex> guard(landmark_lock);
+            if (landmark_epoch == epoch) {                      // the tables keep the copy alive
+                landmarks.store(shared_ptr<const landmark_set>(build, build->set.get()));
+            }
+        }
+        rebuilding.store(false);
+    });
+}
+
+/**
+ * @brief Method to search one query with the engine's mode
+ * @param worker worker id, selects the search state
+ * @param start start cell index
+ * @param target target cell index
+ * @param res pointer to the result, found and path are set
+ *
+ */
+void batch_engine::search(int worker, int start, int target, _query_result *res) {
+    if (mode == SEARCH_HPA) {                                   // no full-map scratch needed
+        hpa_state *hs = &hpa_scratch[worker];
+        res->found = (hierarchy->find_path(hs, start, target) > 0);
+        expanded[worker] += hs->abstract_expanded;
+        add_counters(&counters[worker], hs->counters);
+        res->path.resize(hs->cells.size());
+        for (size_t i = 0; i < hs->cells.size(); ++i) {
+            res->path[i].x = bu->x_of(hs->cells[i]);
+            res->path[i].y = bu->y_of(hs->cells[i]);
+        }
+        return;
+    }
+    if (mode == SEARCH_BFS) {
+        bfs_state *bs = &bfs_scratch[worker];
+        res->found = (bits->find_path(bs, start, target) > 0);
+        expanded[worker] += bs->reached;
+        add_counters(&counters[worker], bs->counters);
+        res->path.resize(bs->cells.size());
+        for (size_t i = 0; i < bs->cells.size(); ++i) {
+            res->path[i].x = bu->x_of(bs->cells[i]);
+            res->path[i].y = bu->y_of(bs->cells[i]);
+        }
+        return;
+    }
+
+    search_state *ss = &scratch[worker];
+    if (ss->size() != (size_t)bu->get_cells()) {                // sized on first use by this worker
+        ss->resize(bu->get_cells());
+    }
+    if (mode == SEARCH_JPS) {
+        res->found = jps_search(bu, ss, start, target);
+    } else if (mode == SEARCH_BIDIR) {
+        search_state *back = &back_scratch[worker];
+        if (back->size() != (size_t)bu->get_cells()) {
+            back->resize(bu->get_cells());
+        }
+        res->found = bidir_search(bu, ss, back, start, target);
+    } else if (mode == SEARCH_ALT) {
+        shared_ptr<const landmark_set> lm = landmarks.load();
+        if (lm) {
+            res->found = alt_search(bu, ss, lm.get(), start, target);
+        } else {                                                // stale tables, Manhattan until the rebuild lands
+            rebuild_landmarks();
+            res->found = astar_search(bu, ss, start, target);
+        }
+    } else {
+        res->found = astar_search(bu, ss, start, target);
+    }
+    expanded[worker] += ss->expanded;
+    add_counters(&counters[worker], ss->counters);
+    if (res->found) {
+        trace_path(bu, ss, target, &res->path);
+    }
+}
+
+/**
+ * @brief Method to solve a batch of queries
+ * @param queries queries to solve
+ * @param results pointer to vector receiving one result per query, in input order
+ *
+ */
+void batch_engine::run(const vector<_query> &queries, vector<_query_result> *results) {
+    results->resize(queries.size());
+    for (size_t first = 0; first < queries.size(); first += chunk) {
+        size_t last = min(queries.size(), first + chunk);
+        pool.submit([this, &queries, results, first, last](int worker) {
+            for (size_t i = first; i < last; ++i) {
+                solve(worker, queries[i], &(*results)[i]);
+            }
+        });
+    }
+    pool.wait();
+}
+
+/**
+ * @brief Method to count the nodes expanded by all workers, abstract nodes for SEARCH_HPA
+ *        and reached cells for SEARCH_BFS
+ *
+ */
+long batch_engine::get_expanded(void) const {
+    long total = 0;
+    for (long n : expanded) {
+        total += n;
+    }
+    return total;
+}
+
+/**
+ * @brief Method to add up the search event counters of all workers
+ *
+ */
+_search_counters batch_engine::get_counters(void) const {
+    _search_counters total = {};
+    for (const _search_counters &c : counters) {
+        add_counters(&total, c);
+    }
+    return total;
+}
@@ -0,0 +1,102 @@
+/**
+ * @brief   Bidirectional search file
+ * @details This file contains the bidirectional search: two A* searches, one from the start and
+ *          one from the target, that meet in the middle. It keeps the optimal path length of
+ *          astar_search() and wins when the sea around the target misleads the heuristic of a
+ *          forward search, e.g. a target in a bay that opens away from the start.
+ *
+ */
+#include "pathfinding.hpp"
+
+/**
+ * @brief Function to run a bidirectional A* between two cells (Pohl's BHPA with the
+ *        cardinality rule). Each side orders its open list by f = g + Manhattan distance
+ *        to the other end, and the side with the smaller open list expands next. U is
+ *        the cost of the best path through a cell reached by both sides. Since the
+ *        heuristic is consistent, every path not found yet runs through an open cell
+ *        of each side and costs at least max(fmin_fwd, fmin_bwd), so the search stops
+ *        once U is no larger and U is optimal. The backward parent links are then
+ *        reversed into the forward state, so trace_path() on the forward state
+ *        rebuilds the whole path.
+ * @param bu pointer the the battleship class
+ * @param ss forward search state, reset by the call, receives the spliced path
+ * @param back backward search state, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int bidir_search(battleship *bu, search_state *ss, search_state *back, int start, int target) {
+    int y_max = bu->get_y_max();
+    search_state *side[2] = {ss, back};
+    int goal_x[2] = {bu->x_of(target), bu->x_of(start)};        // each side heads for the other end
+    int goal_y[2] = {bu->y_of(target), bu->y_of(start)};
+    int nb[4];
+
+    ss->reset();
+    back->reset();
+    if (!bu->connected(start, target)) {                        // different components, nothing to search
+        return 0;
+    }
+
+    int origin[2] = {start, target};
+    for (int s = 0; s < 2; ++s) {
+        int cell = origin[s];
+        side[s]->touch(cell);
+        side[s]->g_cost[cell] = 0;
+        side[s]->open_list.push(abs(bu->x_of(cell) - goal_x[s]) + abs(bu->y_of(cell) - goal_y[s]), cell);
+        STAT_ADD(side[s], pushes, 1);
+    }
+
+    int best = (start == target) ? 0 : INT32_MAX, meet = start;
+    while (!ss->open_list.empty() && !back->open_list.empty()) {
+        // stale entries only lower the top keys, which keeps the bound safe
+        if (best <= max(ss->open_list.top_key(), back->open_list.top_key())) {
+            break;
+        }
+        int s = (ss->open_list.size() <= back->open_list.size()) ? 0 : 1;
+        search_state *cur = side[s], *other = side[1 - s];
+        STAT_PEAK(cur, peak_open, cur->open_list.size());
+        int node = cur->open_list.pop();
+        STAT_ADD(cur, pops, 1);
+        if (cur->visited[node] == CLOSED) {                     // stale duplicate entry
+            STAT_ADD(cur, stale, 1);
+            continue;
+        }
+        cur->visited[node] = CLOSED;
+        ++cur->expanded;
+
+        int g = cur->g_cost[node] + 1;
+        int n = bu->get_passable_neighbours(node, nb);
+        STAT_ADD(cur, generated, n);
+        for (int i = 0; i < n; ++i) {
+            int next = nb[i];
+            cur->touch(next);
+            if ((cur->visited[next] == CLOSED) || (g >= cur->g_cost[next])) {
+                continue;
+            }
+            cur->g_cost[next] = g;
+            cur->parent[next] = node;
+            int nx = next / y_max, ny = next - nx * y_max;
+            cur->open_list.push(g + abs(nx - goal_x[s]) + abs(ny - goal_y[s]), next);
+            STAT_ADD(cur, pushes, 1);
+            int g_other = other->get_g_cost(next);
+            if ((g_other != INT32_MAX) && (g + g_other < best)) {
+                best = g + g_other;
+                meet = next;
+            }
+        }
+    }
+    ss->expanded += back->expanded;
+    add_counters(&ss->counters, back->counters);                // peak_open is the larger side's
+    if (best == INT32_MAX) {
+        return 0;
+    }
+
+    // splice: reverse the backward links from the meeting cell into the forward state
+    for (int prev = meet, node = back->get_parent(meet); node >= 0; prev = node, node = back->get_parent(node)) {
+        ss->touch(node);
+        ss->parent[node] = prev;
+    }
+    return 1;
+}
@@ -0,0 +1,316 @@
+/**
+ * @brief   Bit-parallel BFS file
+ * @details This file contains the bit-packed passability rows and the wavefront sweep over
+ *          them: shortest paths, full distance fields and nearest port queries, 64 cells per
+ *          word operation.
+ *
+ */
+#include <algorithm>
+#include "bitbfs.hpp"
+
+/**
+ * @brief Constructor for class. Packs the passability of the loaded map.
+ *
+ * @param b pointer to the battleship holding the map
+ *
+ */
+bit_grid::bit_grid(battleship *b) : bu(b) {
+    rows = bu->get_x_max();
+    y_max = bu->get_y_max();
+    row_words = (y_max + BFS_WORD_BITS - 1) / BFS_WORD_BITS;
+    pass.assign((size_t)rows * row_words, 0);
+    for (int x = 0; x < rows; ++x) {
+        for (int y = 0; y < y_max; ++y) {
+            if (bu->is_passable(bu->index(x, y))) {
+                pass[(size_t)x * row_words + y / BFS_WORD_BITS] |= (uint64_t)1 << (y % BFS_WORD_BITS);
+            }
+        }
+    }
+    version = bu->get_version();
+}
+
+/**
+ * @brief Method to size the scratch for this grid and forget the last sweep.
+ *        front and next are left all zero by every sweep, only seen is cleared.
+ *        The word lists are used as fixed arrays of one slot per word.
+ * @param st per-query scratch
+ *
+ */
+void bit_grid::prepare(bfs_state *st) const {
+    size_t words = pass.size();
+    if (st->seen.size() != words) {
+        st->seen.assign(words, 0);
+        st->front.assign(words, 0);
+        st->next.assign(words, 0);
+        st->goal.assign(words, 0);
+        st->front_list.assign(words + 1, 0);                   // spread() writes one slot past the last word
+        st->next_list.assign(words + 1, 0);
+        st->dist.assign((size_t)rows * y_max, 0);
+    } else {
+        fill(st->seen.begin(), st->seen.end(), 0);
+    }
+    st->layers = 0;
+    st->words = 0;
+    st->reached = 0;
+    st->counters = {};
+}
+
+/**
+ * @brief Method to sweep the wavefront out of a cell, layer by layer. Each layer is
+ *        stamped into the distance field and checked for the target and goal bits
+ *        before it spreads, so the sweep stops on the layer that reaches them.
+ * @param st per-query scratch, receives the reached cells and their distances
+ * @param source source cell index, passable
+ * @param target cell to stop at, -1 to sweep the whole component
+ * @param use_goal stop at the first layer holding a goal bit
+ * @returns cell the sweep stopped at, the lowest goal cell of its layer, -1 if none
+ *
+ */
+int bit_grid::sweep(bfs_state *st, int source, int target, bool use_goal) const {
+    prepare(st);
+    // raw pointers: the lists are sized to the word count, a word joins a layer once
+    const uint64_t *pw = pass.data();
+    uint64_t *seen = st->seen.data(), *front = st->front.data(), *next = st->next.data();
+    const uint64_t *goal = st->goal.data();
+    int *dist = st->dist.data(), *flist = st->front_list.data(), *nlist = st->next_list.data();
+    int fn = 0, nn = 0, last = (int)pass.size() - row_words;
+
+    int sw = bu->x_of(source) * row_words + bu->y_of(source) / BFS_WORD_BITS;
+    seen[sw] = front[sw] = (uint64_t)1 << (bu->y_of(source) % BFS_WORD_BITS);
+    flist[fn++] = sw;
+    int tw = -1;
+    uint64_t tb = 0;
+    if (target >= 0) {
+        tw = bu->x_of(target) * row_words + bu->y_of(target) / BFS_WORD_BITS;
+        tb = (uint64_t)1 << (bu->y_of(target) % BFS_WORD_BITS);
+    }
+
+    auto spread = [&](int j, uint64_t bits) {
+        uint64_t add = bits & pw[j] & ~seen[j];
+        STAT_ADD(st, generated, 1);
+        if (add) {
+            nlist[nn] = j;
+            nn += (next[j] == 0);
+            next[j] |= add;
+            seen[j] |= add;
+        }
+    };
+
+    int found = -1;
+    for (int d = 0; fn > 0; ++d) {
+        ++st->layers;
+        STAT_PEAK(st, peak_open, fn);
+        for (int i = 0; i < fn; ++i) {                          // stamp the layer into the distance field
+            int j = flist[i];
+            uint64_t f = front[j];
+            int base = (j / row_words) * y_max + (j % row_words) * BFS_WORD_BITS;
+            if (use_goal && (f & goal[j])) {
+                int hit = base + __builtin_ctzll(f & goal[j]);
+                if ((found < 0) || (hit < found)) {
+                    found = hit;
+                }
+            }
+            st->reached += __builtin_popcountll(f);
+            STAT_ADD(st, pushes, __builtin_popcountll(f));
+            while (f) {
+                dist[base + __builtin_ctzll(f)] = d;
+                f &= f - 1;
+            }
+        }
+        if ((tw >= 0) && (front[tw] & tb)) {
+            found = target;
+        }
+        if (found >= 0) {
+            break;
+        }
+
+        nn = 0;
+        for (int i = 0; i < fn; ++i) {
+            int j = flist[i], w = j % row_words;
+            uint64_t f = front[j];
+            front[j] = 0;
+            ++st->words;
+            STAT_ADD(st, pops, 1);
+            spread(j, (f << 1) | (f >> 1));
+            if (w > 0) {
+                spread(j - 1, f << (BFS_WORD_BITS - 1));
+            }
+            if (w + 1 < row_words) {
+                spread(j + 1, f >> (BFS_WORD_BITS - 1));
+            }
+            if (j >= row_words) {
+                spread(j - row_words, f);
+            }
+            if (j < last) {
+                spread(j + row_words, f);
+            }
+        }
+        swap(front, next);
+        swap(flist, nlist);
+        fn = nn;
+    }
+    for (int i = 0; i < fn; ++i) {                              // leave both layers all zero for the next sweep
+        front[flist[i]] = 0;
+    }
+    return found;
+}
+
+/**
+ * @brief Method to walk the distance field from a reached cell back to the source
+ * @param st scratch of the sweep, receives the path in cells, source first
+ * @param source source cell index
+ * @param cell reached cell index
+ * @returns number of path cells
+ *
+ */
+int bit_grid::trace(bfs_state *st, int source, int cell) const {
+    st->cells.clear();
+    st->cells.push_back(cell);
+    while (cell != source) {
+        int next[4], n = bu->get_passable_neighbours(cell, next);
+        for (int i = 0; i < n; ++i) {
+            if (get_distance(st, next[i]) == st->dist[cell] - 1) {
+                cell = next[i];
+                break;
+            }
+        }
+        st->cells.push_back(cell);
+    }
+    reverse(st->cells.begin(), st->cells.end());
+    return (int)st->cells.size();
+}
+
+/**
+ * @brief Method to find a shortest path between two cells
+ * @param st per-query scratch, one per thread
+ * @param start start cell index
+ * @param target target cell index
+ * @returns number of path cells left in st->cells, start first, 0 if no path
+ *
+ */
+int bit_grid::find_path(bfs_state *st, int start, int target) const {
+    st->cells.clear();
+    if (!bu->connected(start, target)) {
+        st->layers = st->words = st->reached = 0;
+        st->counters = {};
+        return 0;
+    }
+    if (sweep(st, target, start, false) < 0) {
+        return 0;
+    }
+    trace(st, target, start);                                   // swept from the target, so the trace comes target first
+    reverse(st->cells.begin(), st->cells.end());
+    return (int)st->cells.size();
+}
+
+/**
+ * @brief Method to compute the distance from one cell to every cell reachable
+ *        from it, read with get_distance()
+ * @param st per-query scratch, receives the field
+ * @param source source cell index
+ * @returns number of cells reached, 0 if the source is not passable
+ *
+ */
+long bit_grid::distance_field(bfs_state *st, int source) const {
+    if (!bu->is_passable(source)) {
+        prepare(st);
+        return 0;
+    }
+    sweep(st, source, -1, false);
+    return st->reached;
+}
+
+/**
+ * @brief Method to read the distance field of the last sweep
+ * @param st scratch of the sweep
+ * @param cell cell index
+ * @returns steps from the source, -1 if the sweep did not reach the cell
+ *
+ */
+int bit_grid::get_distance(const bfs_state *st, int cell) const {
+    int x = bu->x_of(cell), y = cell - x * y_max;
+    if (st->seen.empty() || !(st->seen[x * row_words + y / BFS_WORD_BITS] & ((uint64_t)1 << (y % BFS_WORD_BITS)))) {
+        return -1;
+    }
+    return st->dist[cell];
+}
+
+/**
+ * @brief Method to find the nearest reachable port. The sweep stops at the
+ *        first layer that reaches a port; ties go to the lowest cell index.
+ * @param st per-query scratch, receives the path to the port in st->cells
+ * @param source source cell index
+ * @param ports port cell indices
+ * @returns position of the nearest port in ports, -1 if none is reachable
+ *
+ */
+int bit_grid::nearest(bfs_state *st, int source, const vector<int> &ports) const {
+    st->cells.clear();
+    prepare(st);
+    bool any = false;
+    for (int p : ports) {
+        if (bu->connected(source, p)) {
+            st->goal[bu->x_of(p) * row_words + bu->y_of(p) / BFS_WORD_BITS] |=
+                (uint64_t)1 << (bu->y_of(p) % BFS_WORD_BITS);
+            any = true;
+        }
+    }
+    int hit = any ? sweep(st, source, -1, true) : -1;
+    for (int p : ports) {                                       // leave goal all zero for the next query
+        st->goal[bu->x_of(p) * row_words + bu->y_of(p) / BFS_WORD_BITS] = 0;
+    }
+    if (hit < 0) {
+        return -1;
+    }
+    trace(st, source, hit);
+    return (int)(find(ports.begin(), ports.end(), hit) - ports.begin());
+}
+
+/**
+ * @brief Method to refresh the passability bit of a changed cell. Call it
+ *        after battleship::set_terrain() for every changed cell.
+ * @param cell cell index
+ *
+ */
+void bit_grid::update_cell(int cell) {
+    int x = bu->x_of(cell), y = cell - x * y_max;
+    uint64_t bit = (uint64_t)1 << (y % BFS_WORD_BITS);
+    size_t j = (size_t)x * row_words + y / BFS_WORD_BITS;
+    if (bu->is_passable(cell)) {
+        pass[j] |= bit;
+    } else {
+        pass[j] &= ~bit;
+    }
+    version = bu->get_version();
+}
+
+/**
+ * @brief Function to find a path from start to target of the battleship with the
+ *        bit-parallel BFS. Packs a one-off bit_grid; keep a bit_grid around to
+ *        answer many queries.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_bfs(battleship *bu, vector<_points*> *sol) {
+    bit_grid grid(bu);
+    bfs_state st;
+    search_state *ss = bu->get_scratch();
+    ss->reset();
+    int found = grid.find_path(&st, bu->get_start(), bu->get_target());
+    ss->expanded = st.reached;                                  // reported like the other modes
+    ss->counters = st.counters;
+    if (!found) {
+        return 0;
+    }
+    for (int cell : st.cells) {
+        ss->touch(cell);
+        ss->marked_path[cell] = 1;
+        _points *p = new _points;
+        p->x = bu->x_of(cell);
+        p->y = bu->y_of(cell);
+        sol->push_back(p);
+    }
+    return 1;
+}
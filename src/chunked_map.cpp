@@ -0,0 +1,436 @@
+/**
+ * @brief   Chunked map file
+ * @details This file contains the out-of-core map backend: the chunked binary map writer,
+ *          the LRU chunk cache that pages terrain in from the file, and A* on per-chunk
+ *          search scratch, so a route across a map larger than memory runs in bounded memory.
+ *
+ */
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "chunked_map.hpp"
+
+#define SCRATCH_DIR         0x03    // direction of the step into the cell, index into step_dx/step_dy
+#define SCRATCH_PARENT      0x04    // the cell has a parent
+#define SCRATCH_CLOSED      0x08    // the cell was expanded
+
+/**
+ * @brief Steps in the neighbour order of get_passable_neighbours(): up, down, left, right
+ *
+ */
+static const int step_dx[4] = {-1, 1, 0, 0};
+static const int step_dy[4] = {0, 0, -1, 1};
+
+/**
+ * @brief Method to create the file and write a provisional header
+ * @param f_name string containing output file path
+ * @param x_max map rows
+ * @param y_max map columns
+ * @param start pointer to start position, x_pos -1 if none
+ * @param target pointer to target position, x_pos -1 if none
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int chunk_writer::open(string f_name, int x_max, int y_max, _field *start, _field *target) {
+    fp = fopen(f_name.c_str(), "wb");
+    if (!fp) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, MAP_FORMAT_MAGIC, sizeof(head.magic));
+    head.version = MAP_FORMAT_VERSION;
+    head.x_max = x_max;
+    head.y_max = y_max;
+    set_endpoints(start, target);
+    head.encoding = MAP_ENC_CHUNKED;
+    head.header_size = sizeof(head);
+    head.reserved[0] = CHUNK_SHIFT;
+    chunk_cols = (y_max + CHUNK_MASK) >> CHUNK_SHIFT;
+    row = 0;
+    checksum = MAP_CHECKSUM_SEED;
+    band.assign((size_t)chunk_cols * CHUNK_BYTES, 0x55);        // code 1 in every cell: elevated padding
+    return fwrite(&head, sizeof(head), 1, fp) == 1;
+}
+
+/**
+ * @brief Method to write the chunks of the current band and start the next one
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int chunk_writer::flush_band(void) {
+    if (fwrite(band.data(), 1, band.size(), fp) != band.size()) {
+        return 0;
+    }
+    checksum = map_checksum(band.data(), band.size(), checksum);
+    head.data_size += band.size();
+    memset(band.data(), 0x55, band.size());
+    return 1;
+}
+
+/**
+ * @brief Method to add the next terrain row
+ * @param terrain y_max _f_type bytes
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int chunk_writer::add_row(const int8_t *terrain) {
+    if (!fp || (row >= head.x_max)) {
+        return 0;
+    }
+    int base = (row & CHUNK_MASK) << CHUNK_SHIFT;               // offset of the row in its chunks
+    for (int y = 0; y < head.y_max; ++y) {
+        int8_t dot = terrain[y];
+        uint8_t code = (dot == ELEVATED_TERRAIN) ? 1 : (dot == BU_START) ? 2 : (dot == BU_TARGET) ? 3 : 0;
+        int local = base | (y & CHUNK_MASK);
+        uint8_t *byte = &band[(size_t)(y >> CHUNK_SHIFT) * CHUNK_BYTES + (local >> 2)];
+        int shift = (local & 3) * 2;
+        *byte = (uint8_t)((*byte & ~(3 << shift)) | (code << shift));
+    }
+    ++row;
+    return ((row & CHUNK_MASK) != 0) || flush_band();
+}
+
+/**
+ * @brief Method to write the last band and the final header and close the file.
+ *        All x_max rows must have been added.
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int chunk_writer::close(void) {
+    if (!fp) {
+        return 0;
+    }
+    int ret = (row == head.x_max);
+    if (ret && (row & CHUNK_MASK)) {                            // partial last band
+        ret = flush_band();
+    }
+    head.checksum = checksum;
+    ret = ret && (fseek(fp, 0, SEEK_SET) == 0) && (fwrite(&head, sizeof(head), 1, fp) == 1);
+    ret = (fclose(fp) == 0) && ret;
+    fp = NULL;
+    if (!ret) {
+        cerr << "Error: Could not write chunked map" << endl;
+    }
+    return ret;
+}
+
+/**
+ * @brief Function to write the map of a battleship as a chunked binary map file
+ * @param f_name string containing output file path
+ * @param bu pointer to the battleship holding the map
+ * @param start pointer to start position, x_pos -1 if none
+ * @param target pointer to target position, x_pos -1 if none
+ * @returns 1 if succeeded, 0 if failed
+ */
+int write_map_chunked(string f_name, battleship *bu, _field *start, _field *target) {
+    chunk_writer out;
+    if (!out.open(f_name, bu->get_x_max(), bu->get_y_max(), start, target)) {
+        return 0;
+    }
+    const int8_t *terrain = bu->get_terrain_data();
+    for (int x = 0; x < bu->get_x_max(); ++x) {
+        if (!out.add_row(terrain + (size_t)x * bu->get_y_max())) {
+            return 0;
+        }
+    }
+    return out.close();
+}
+
+/**
+ * @brief Constructor for class
+ *
+ */
+chunked_map::chunked_map()
+    : fd(-1), head(), chunk_rows(0), chunk_cols(0), slots(0), mru(-1), lru(-1), used(0), last_chunk(-1),
+      last_data(NULL), stats() {}
+
+/**
+ * @brief Destructor for class, closes the file
+ *
+ */
+chunked_map::~chunked_map() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+/**
+ * @brief Method to open a chunked map file. Only the header is read.
+ * @param f_name string containing map file path
+ * @param cache_bytes chunk cache budget, at least a few chunks are kept
+ * @param verify 1 to stream the file once and check the terrain checksum
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int chunked_map::open(string f_name, size_t cache_bytes, int verify) {
+    fd = ::open(f_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    if (pread(fd, &head, sizeof(head), 0) != (ssize_t)sizeof(head)) {
+        cerr << "Error: " << f_name << " is too short for a binary map" << endl;
+        return 0;
+    }
+    chunk_rows = (head.x_max + CHUNK_MASK) >> CHUNK_SHIFT;
+    chunk_cols = (head.y_max + CHUNK_MASK) >> CHUNK_SHIFT;
+    uint64_t chunks = (uint64_t)chunk_rows * chunk_cols;
+    off_t length = lseek(fd, 0, SEEK_END);
+    if ((memcmp(head.magic, MAP_FORMAT_MAGIC, sizeof(head.magic)) != 0) || (head.version != MAP_FORMAT_VERSION) ||
+        (head.encoding != MAP_ENC_CHUNKED) || (head.reserved[0] != CHUNK_SHIFT) || (head.x_max <= 0) ||
+        (head.y_max <= 0) || (chunks > INT_MAX) || (head.header_size < sizeof(head)) ||
+        (head.data_size != chunks * CHUNK_BYTES) || (head.header_size + head.data_size > (uint64_t)length) ||
+        !map_endpoints_valid(&head)) {
+        cerr << "Error: " << f_name << " is not a valid version " << MAP_FORMAT_VERSION << " chunked map" << endl;
+        return 0;
+    }
+
+    if (verify) {                                               // one band at a time, the file need not fit
+        vector<uint8_t> buf((size_t)CHUNK_BYTES * 256);
+        uint64_t h = MAP_CHECKSUM_SEED;
+        for (uint64_t off = 0; off < head.data_size; off += buf.size()) {
+            size_t n = (size_t)min<uint64_t>(buf.size(), head.data_size - off);
+            if (pread(fd, buf.data(), n, head.header_size + off) != (ssize_t)n) {
+                cerr << "Error: Could not read " << f_name << endl;
+                return 0;
+            }
+            h = map_checksum(buf.data(), n, h);
+        }
+        if (h != head.checksum) {
+            cerr << "Error: Checksum mismatch in " << f_name << endl;
+            return 0;
+        }
+    }
+
+    slots = (int)min<uint64_t>(max<size_t>(cache_bytes / CHUNK_BYTES, 4), chunks);
+    pool.reset(new uint8_t[(size_t)slots * CHUNK_BYTES]);
+    slot_chunk.assign(slots, -1);
+    prev.assign(slots, -1);
+    next.assign(slots, -1);
+    where.reserve(slots);
+    return 1;
+}
+
+/**
+ * @brief Method to take a slot out of the LRU list
+ * @param slot slot in the list
+ *
+ */
+void chunked_map::unlink(int slot) {
+    if (prev[slot] >= 0) {
+        next[prev[slot]] = next[slot];
+    } else {
+        mru = next[slot];
+    }
+    if (next[slot] >= 0) {
+        prev[next[slot]] = prev[slot];
+    } else {
+        lru = prev[slot];
+    }
+    prev[slot] = next[slot] = -1;
+}
+
+/**
+ * @brief Method to make a slot the most recently used one
+ * @param slot slot not in the list
+ *
+ */
+void chunked_map::push_front(int slot) {
+    prev[slot] = -1;
+    next[slot] = mru;
+    if (mru >= 0) {
+        prev[mru] = slot;
+    }
+    mru = slot;
+    if (lru < 0) {
+        lru = slot;
+    }
+}
+
+/**
+ * @brief Method to look a chunk up in the cache, reading it from the file on a miss
+ *        into a free slot or the least recently used one
+ * @param chunk chunk index
+ * @returns terrain of the chunk
+ *
+ */
+const uint8_t *chunked_map::lookup(int chunk) {
+    int slot;
+    auto it = where.find(chunk);
+    if (it != where.end()) {
+        ++stats.hits;
+        slot = it->second;
+        if (slot != mru) {
+            unlink(slot);
+            push_front(slot);
+        }
+    } else {
+        ++stats.misses;
+        if (used < slots) {
+            slot = used++;
+        } else {
+            slot = lru;
+            unlink(slot);
+            where.erase(slot_chunk[slot]);
+            ++stats.evictions;
+        }
+        uint8_t *data = &pool[(size_t)slot * CHUNK_BYTES];
+        off_t off = (off_t)head.header_size + (off_t)chunk * CHUNK_BYTES;
+        if (pread(fd, data, CHUNK_BYTES, off) != CHUNK_BYTES) { // the size was checked, only an I/O error gets here
+            cerr << "Error: Could not read chunk " << chunk << ", treated as land" << endl;
+            memset(data, 0x55, CHUNK_BYTES);
+        }
+        stats.bytes_read += CHUNK_BYTES;
+        slot_chunk[slot] = chunk;
+        where[chunk] = slot;
+        push_front(slot);
+    }
+    last_chunk = chunk;
+    last_data = &pool[(size_t)slot * CHUNK_BYTES];
+    return last_data;
+}
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param budget_bytes memory the blocks may take
+ *
+ */
+chunk_scratch::chunk_scratch(size_t budget_bytes) : expanded(0), used(0), peak(0), chunk_cols(0) {
+    size_t fit = budget_bytes / sizeof(_scratch_chunk);
+    size_t names = (size_t)INT_MAX >> (2 * CHUNK_SHIFT);        // slots a node name can hold
+    max_blocks = (int)max<size_t>(1, min(fit, names));
+}
+
+/**
+ * @brief Method to start a new search; blocks are kept for reuse
+ * @param cols chunks per map row of the map to search
+ *
+ */
+void chunk_scratch::reset(int cols) {
+    open_list.clear();
+    where.clear();
+    used = 0;
+    expanded = 0;
+    chunk_cols = cols;
+}
+
+/**
+ * @brief Method to fetch the slot of a chunk, creating its block on first touch
+ * @param cx chunk row
+ * @param cy chunk column
+ * @returns slot, -1 if the budget is used up
+ *
+ */
+int chunk_scratch::slot(int cx, int cy) {
+    auto it = where.find(cx * chunk_cols + cy);
+    if (it != where.end()) {
+        return it->second;
+    }
+    if (used >= max_blocks) {
+        return -1;
+    }
+    if (used == (int)blocks.size()) {
+        blocks.emplace_back(new _scratch_chunk);
+    }
+    _scratch_chunk *b = blocks[used].get();
+    b->cx = cx;
+    b->cy = cy;
+    fill(b->g, b->g + CHUNK_CELLS, INT_MAX);
+    memset(b->from, 0, sizeof(b->from));
+    where.emplace(cx * chunk_cols + cy, used);
+    peak = (used + 1 > peak) ? used + 1 : peak;
+    return used++;
+}
+
+/**
+ * @brief Function to rebuild the path of a finished search from the parent
+ *        directions, walking back from the target
+ * @param sc scratch holding the finished search
+ * @param target target cell
+ * @param path pointer to vector receiving the path points, start first
+ */
+static void trace_chunked(chunk_scratch *sc, _points target, vector<_points> *path) {
+    path->clear();
+    int x = target.x, y = target.y;
+    while (true) {
+        path->push_back({x, y});
+        chunk_scratch::_scratch_chunk *b = sc->block(sc->find(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT));
+        uint8_t from = b->from[((x & CHUNK_MASK) << CHUNK_SHIFT) | (y & CHUNK_MASK)];
+        if (!(from & SCRATCH_PARENT)) {
+            break;
+        }
+        x -= step_dx[from & SCRATCH_DIR];
+        y -= step_dy[from & SCRATCH_DIR];
+    }
+    reverse(path->begin(), path->end());
+}
+
+/**
+ * @brief Function to run A* on a chunked map. Terrain comes from the chunk cache and
+ *        the search state from per-chunk scratch blocks, so memory is bounded by the
+ *        two budgets rather than by the map size. Neighbours are visited in the order
+ *        of astar_search() and ties break the same way, so paths match it.
+ * @param map chunked map
+ * @param sc scratch for the search, reset by the call
+ * @param start start cell
+ * @param target target cell
+ * @param path pointer to vector receiving the path points, start first
+ * @returns 1 if a path is found, 0 if no path, -1 if the scratch budget ran out
+ */
+int chunked_search(chunked_map *map, chunk_scratch *sc, _points start, _points target, vector<_points> *path) {
+    const int name_shift = 2 * CHUNK_SHIFT;
+    bucket_queue *open = &sc->open_list;
+    int tx = target.x, ty = target.y;
+
+    path->clear();
+    sc->reset(map->get_chunk_cols());
+    if (!map->is_passable(start.x, start.y) || !map->is_passable(tx, ty)) {
+        return 0;
+    }
+    int s = sc->slot(start.x >> CHUNK_SHIFT, start.y >> CHUNK_SHIFT);
+    int s_local = ((start.x & CHUNK_MASK) << CHUNK_SHIFT) | (start.y & CHUNK_MASK);
+    sc->block(s)->g[s_local] = 0;
+    open->push(abs(start.x - tx) + abs(start.y - ty), (s << name_shift) | s_local);
+
+    while (!open->empty()) {
+        int node = open->pop();
+        int slot = node >> name_shift, local = node & (CHUNK_CELLS - 1);
+        chunk_scratch::_scratch_chunk *b = sc->block(slot);
+        if (b->from[local] & SCRATCH_CLOSED) {                  // stale duplicate entry
+            continue;
+        }
+        b->from[local] |= SCRATCH_CLOSED;
+        ++sc->expanded;
+        int x = (b->cx << CHUNK_SHIFT) | (local >> CHUNK_SHIFT);
+        int y = (b->cy << CHUNK_SHIFT) | (local & CHUNK_MASK);
+        if ((x == tx) && (y == ty)) {
+            trace_chunked(sc, target, path);
+            return 1;
+        }
+
+        int g = b->g[local] + 1;
+        int cx = b->cx, cy = b->cy;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + step_dx[d], ny = y + step_dy[d];
+            if (!map->is_passable(nx, ny)) {
+                continue;
+            }
+            int ns = slot;
+            if (((nx >> CHUNK_SHIFT) != cx) || ((ny >> CHUNK_SHIFT) != cy)) {
+                if ((ns = sc->slot(nx >> CHUNK_SHIFT, ny >> CHUNK_SHIFT)) < 0) {
+                    return -1;
+                }
+            }
+            chunk_scratch::_scratch_chunk *nb = sc->block(ns);
+            int nl = ((nx & CHUNK_MASK) << CHUNK_SHIFT) | (ny & CHUNK_MASK);
+            if (!(nb->from[nl] & SCRATCH_CLOSED) && (g < nb->g[nl])) {
+                nb->g[nl] = g;
+                nb->from[nl] = (uint8_t)(SCRATCH_PARENT | d);
+                open->push(g + abs(nx - tx) + abs(ny - ty), (ns << name_shift) | nl);
+            }
+        }
+    }
+    return 0;
+}
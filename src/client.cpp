@@ -0,0 +1,201 @@
+/**
+ * @brief   Client file
+ * @details This file contains the local client of the routing server and the closed loop
+ *          load generator used to measure its round-trip latency.
+ *
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.hpp"
+
+/**
+ * @brief Function to connect to a server socket
+ * @param path socket path
+ * @returns socket, -1 if failed
+ */
+static int connect_to(const string &path) {
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: Socket path too long: " << path << endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((fd < 0) || (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)) {
+        cerr << "Error: Could not connect to " << path << ": " << strerror(errno) << endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Function to send a whole buffer
+ * @param fd socket
+ * @param data bytes
+ * @param n number of bytes
+ * @returns 1 if succeeded, 0 if failed
+ */
+static int send_all(int fd, const char *data, size_t n) {
+    while (n) {
+        ssize_t sent = send(fd, data, n, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        data += sent;
+        n -= sent;
+    }
+    return 1;
+}
+
+/**
+ * @brief Function to connect to a server socket, send the request lines of stdin and
+ *        print every reply, waiting for the replies of all routes before it returns
+ * @param path socket path
+ * @returns 0 if succeeded, -1 if failed
+ */
+int run_client(const string &path) {
+    int fd = connect_to(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // replies are printed while requests are still sent, the server answers out of order
+    thread printer([fd]() {
+        char buf[1 << 16];
+        ssize_t n;
+        while (((n = read(fd, buf, sizeof(buf))) > 0) || ((n < 0) && (errno == EINTR))) {
+            if (n > 0) {
+                cout.write(buf, n);
+            }
+        }
+        cout.flush();
+    });
+    string line;
+    int ret = 0;
+    while (getline(cin, line)) {
+        line += '\n';
+        if (!send_all(fd, line.data(), line.size())) {
+            cerr << "Error: Server closed the connection" << endl;
+            ret = -1;
+            break;
+        }
+    }
+    ::shutdown(fd, SHUT_WR);                                    // the server closes after the last reply
+    printer.join();
+    close(fd);
+    return ret;
+}
+
+/**
+ * @brief Function to measure a server with closed loop clients: every connection sends
+ *        one route request, waits for its reply and sends the next. Queries are read
+ *        like batch queries and used round robin. Prints throughput and round-trip and
+ *        service time percentiles.
+ * @param path socket path
+ * @param query_file query file, "-" for stdin
+ * @param map_name map the routes go to
+ * @param connections number of client connections
+ * @param requests number of route requests over all connections
+ * @returns 0 if succeeded, -1 if failed
+ */
+int run_load(const string &path, const string &query_file, const string &map_name, int connections, long requests) {
+    vector<_query> queries;
+    int ok;
+    if (query_file == "-") {
+        ok = read_queries(cin, &queries);
+    } else {
+        ifstream in(query_file);
+        if (!in.is_open()) {
+            cerr << "Error: Could not open file " << query_file << endl;
+            return -1;
+        }
+        ok = read_queries(in, &queries);
+    }
+    if (!ok || queries.empty() || (connections < 1) || (requests < 1)) {
+        cerr << "Error: Need queries, connections and requests" << endl;
+        return -1;
+    }
+    vector<int> fds(connections);
+    for (int i = 0; i < connections; ++i) {
+        if ((fds[i] = connect_to(path)) < 0) {
+            return -1;
+        }
+    }
+
+    vector<vector<double>> round_trip(connections), service(connections);
+    vector<long> found(connections, 0), failed(connections, 0);
+    vector<thread> clients;
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&, i]() {
+            char buf[SERVER_LINE_MAX * 4];
+            string pending;
+            for (long r = i; r < requests; r += connections) {
+                const _query &q = queries[r % queries.size()];
+                string line = "route " + to_string(r) + ' ' + map_name + ' ' + to_string(q.start.x) + ' ' +
+                              to_string(q.start.y) + ' ' + to_string(q.target.x) + ' ' + to_string(q.target.y) + '\n';
+                auto sent = chrono::steady_clock::now();
+                if (!send_all(fds[i], line.data(), line.size())) {
+                    ++failed[i];
+                    return;
+                }
+                size_t eol;
+                while ((eol = pending.find('\n')) == string::npos) {
+                    ssize_t n = read(fds[i], buf, sizeof(buf));
+                    if (n <= 0) {
+                        ++failed[i];
+                        return;
+                    }
+                    pending.append(buf, n);
+                }
+                round_trip[i].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+                string reply = pending.substr(0, eol);
+                pending.erase(0, eol + 1);
+                size_t last = reply.rfind(' ');                 // service time ends every route reply
+                if ((reply.find(" path ") != string::npos) || (reply.find(" none ") != string::npos)) {
+                    found[i] += (reply.find(" path ") != string::npos);
+                    service[i].push_back(stod(reply.substr(last + 1)));
+                } else {
+                    ++failed[i];
+                }
+            }
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    for (int fd : fds) {
+        close(fd);
+    }
+
+    vector<double> rtt, svc;
+    long paths = 0, errors = 0;
+    for (int i = 0; i < connections; ++i) {
+        rtt.insert(rtt.end(), round_trip[i].begin(), round_trip[i].end());
+        svc.insert(svc.end(), service[i].begin(), service[i].end());
+        paths += found[i];
+        errors += failed[i];
+    }
+    sort(rtt.begin(), rtt.end());
+    sort(svc.begin(), svc.end());
+    cout << "Sent " << rtt.size() << " routes on " << connections << " connections in " << secs << " s ("
+         << (secs > 0 ? rtt.size() / secs : 0) << " requests/sec), " << paths << " paths, " << errors << " errors\n";
+    cout << "Round trip us: p50 " << percentile(rtt, 50) << ", p90 " << percentile(rtt, 90) << ", p99 "
+         << percentile(rtt, 99) << ", max " << percentile(rtt, 100) << "\n";
+    cout << "Service us:    p50 " << percentile(svc, 50) << ", p90 " << percentile(svc, 90) << ", p99 "
+         << percentile(svc, 99) << ", max " << percentile(svc, 100) << endl;
+    return errors ? -1 : 0;
+}
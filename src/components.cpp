@@ -0,0 +1,264 @@
+/**
+ * @brief   Connected component file
+ * @details This file contains the connected component index of the passable cells. It is
+ *          built once at map load and kept in line with single cell terrain changes, so a
+ *          query between two components is rejected without a search.
+ *
+ */
+#include <algorithm>
+#include "components.hpp"
+
+#define ELEVATED_CELL   3               // ELEVATED_TERRAIN of _f_type
+#define RACE_MAX        4               // one race BFS per neighbour
+
+/**
+ * @brief Method to join the components of two labels
+ * @param a label
+ * @param b label
+ * @returns 1 if two components were joined, 0 if they were one already
+ *
+ */
+int component_index::unite(int a, int b) {
+    a = root_compress(a);
+    b = root_compress(b);
+    if (a == b) {
+        return 0;
+    }
+    if (weight[a] < weight[b]) {                                // smaller tree below the bigger one
+        swap(a, b);
+    }
+    uf[b] = a;
+    weight[a] += weight[b];
+    return 1;
+}
+
+/**
+ * @brief Method to fetch the passable neighbours of a cell
+ * @param idx cell index
+ * @param out array receiving up to 4 cell indices
+ * @returns number of neighbours written
+ *
+ */
+int component_index::passable_neighbours(int idx, int out[4]) const {
+    int x = idx / y_max, y = idx - x * y_max, n = 0;
+    if ((x - 1) >= 0 && terrain[idx - y_max] != ELEVATED_CELL) out[n++] = idx - y_max;
+    if ((x + 1) < x_max && terrain[idx + y_max] != ELEVATED_CELL) out[n++] = idx + y_max;
+    if ((y - 1) >= 0 && terrain[idx - 1] != ELEVATED_CELL) out[n++] = idx - 1;
+    if ((y + 1) < y_max && terrain[idx + 1] != ELEVATED_CELL) out[n++] = idx + 1;
+    return n;
+}
+
+/**
+ * @brief Method to label all passable cells of a map. A scanline pass gives each
+ *        cell the label of its upper or left neighbour and unions the two when both
+ *        exist, then a second pass replaces every label by a dense component id.
+ * @param t terrain of the map, must stay valid while the index is used
+ * @param x max x units
+ * @param y max y units
+ *
+ */
+void component_index::build(const int8_t *t, int x, int y) {
+    terrain = t;
+    x_max = x;
+    y_max = y;
+    size_t cells = (size_t)x_max * y_max;
+    label.assign(cells, -1);
+    uf.clear();
+    weight.clear();
+
+    for (int i = 0; i < x_max; ++i) {
+        int row = i * y_max;
+        for (int j = 0; j < y_max; ++j) {
+            int idx = row + j;
+            if (terrain[idx] == ELEVATED_CELL) {
+                continue;
+            }
+            int up = (i > 0) ? label[idx - y_max] : -1;
+            int left = (j > 0) ? label[idx - 1] : -1;
+            if (left >= 0) {
+                label[idx] = left;
+                if ((up >= 0) && (up != left)) {
+                    unite(up, left);
+                }
+            } else if (up >= 0) {
+                label[idx] = up;
+            } else {
+                label[idx] = new_label();
+            }
+        }
+    }
+
+    vector<int32_t> dense(uf.size(), -1);                       // label -> component id
+    count = 0;
+    for (size_t l = 0; l < uf.size(); ++l) {
+        int r = root_compress((int)l);
+        if (dense[r] < 0) {
+            dense[r] = count++;
+        }
+        dense[l] = dense[r];
+    }
+    for (size_t idx = 0; idx < cells; ++idx) {
+        if (label[idx] >= 0) {
+            label[idx] = dense[label[idx]];
+        }
+    }
+    uf.resize(count);
+    weight.assign(count, 1);
+    for (int l = 0; l < count; ++l) {
+        uf[l] = l;
+    }
+}
+
+/**
+ * @brief Method to label a cell that became passable and join its neighbours
+ * @param idx cell index
+ *
+ */
+void component_index::add_cell(int idx) {
+    int nb[4];
+    int n = passable_neighbours(idx, nb);
+    int l = -1;
+    for (int i = 0; i < n; ++i) {
+        if (l < 0) {
+            l = label[nb[i]];
+        } else {
+            count -= unite(l, label[nb[i]]);
+        }
+    }
+    if (l < 0) {                                                // isolated cell, new component
+        l = new_label();
+        ++count;
+    }
+    label[idx] = l;
+}
+
+/**
+ * @brief Method to unlabel a cell that became elevated. Its neighbours race one BFS
+ *        each over the passable cells, taking one cell per turn. BFSs that reach a
+ *        cell of another BFS are one side. A side whose BFSs all ran dry is a
+ *        component of its own; the race ends once at most one side is still growing,
+ *        and every dry side but the last growing one is relabelled.
+ * @param idx cell index
+ *
+ */
+void component_index::remove_cell(int idx) {
+    int nb[RACE_MAX];
+    int n = passable_neighbours(idx, nb);
+    label[idx] = -1;
+    if (n == 0) {                                               // the cell was a component of its own
+        --count;
+        return;
+    }
+    if (n == 1) {                                               // a dead end never splits
+        return;
+    }
+
+    if (mark.size() != label.size()) {                          // sized on the first removal
+        mark.assign(label.size(), 0);
+        owner.assign(label.size(), 0);
+        gen = 0;
+    }
+    if (++gen == 0) {
+        fill(mark.begin(), mark.end(), 0);
+        gen = 1;
+    }
+
+    vector<int> seen[RACE_MAX];                                 // cells reached by each BFS, also its queue
+    size_t head[RACE_MAX] = {0};
+    int side[RACE_MAX];                                         // side of each BFS, BFSs that met share one
+    for (int i = 0; i < n; ++i) {
+        side[i] = i;
+        seen[i].push_back(nb[i]);
+        mark[nb[i]] = gen;
+        owner[nb[i]] = (uint8_t)i;
+    }
+    auto side_of = [&](int i) { while (side[i] != i) i = side[i]; return i; };
+    auto growing = [&](int s) {
+        for (int i = 0; i < n; ++i) {
+            if ((side_of(i) == s) && (head[i] < seen[i].size())) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int live = n;
+    while (live > 1) {
+        for (int i = 0; i < n; ++i) {
+            if (head[i] == seen[i].size()) {
+                continue;
+            }
+            int cell = seen[i][head[i]++], next[4];
+            int m = passable_neighbours(cell, next);
+            for (int k = 0; k < m; ++k) {
+                int c = next[k];
+                if (mark[c] != gen) {
+                    mark[c] = gen;
+                    owner[c] = (uint8_t)i;
+                    seen[i].push_back(c);
+                } else {
+                    int a = side_of(i), b = side_of(owner[c]);
+                    if (a != b) {                               // the BFSs met, one side
+                        side[max(a, b)] = min(a, b);
+                    }
+                }
+            }
+        }
+        live = 0;
+        for (int s = 0; s < n; ++s) {
+            live += (side_of(s) == s) && growing(s);
+        }
+    }
+
+    // the last growing side keeps the old label, or the biggest one if none is left
+    int keep = -1;
+    size_t keep_size = 0;
+    for (int s = 0; s < n; ++s) {
+        if (side_of(s) != s) {
+            continue;
+        }
+        size_t size = 0;
+        for (int i = 0; i < n; ++i) {
+            size += (side_of(i) == s) ? seen[i].size() : 0;
+        }
+        if (growing(s)) {
+            keep = s;
+            break;
+        }
+        if ((keep < 0) || (size > keep_size)) {
+            keep = s;
+            keep_size = size;
+        }
+    }
+    for (int s = 0; s < n; ++s) {
+        if ((side_of(s) != s) || (s == keep)) {
+            continue;
+        }
+        int l = new_label();                                    // split off as a new component
+        ++count;
+        for (int i = 0; i < n; ++i) {
+            if (side_of(i) == s) {
+                for (int cell : seen[i]) {
+                    label[cell] = l;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        walked += (long)seen[i].size();
+    }
+}
+
+/**
+ * @brief Method to bring the labels in line with the terrain of one changed cell
+ * @param idx cell index
+ *
+ */
+void component_index::update(int idx) {
+    bool passable = (terrain[idx] != ELEVATED_CELL);
+    if (passable && (label[idx] < 0)) {
+        add_cell(idx);
+    } else if (!passable && (label[idx] >= 0)) {
+        remove_cell(idx);
+    }
+}
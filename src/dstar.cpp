@@ -0,0 +1,352 @@
+/**
+ * @brief   Incremental planning file
+ * @details This file contains the D* Lite planner. It keeps the search tree of the last
+ *          plan and repairs only the part that terrain changes or ship moves invalidate,
+ *          so replanning after a minefield appears costs a fraction of a new search.
+ *
+ */
+#include "dstar.hpp"
+
+#define DSTAR_INF (INT32_MAX / 2)   // unreachable distance, safe to add a step cost to
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param b pointer to the battleship holding the map
+ *
+ */
+dstar_lite::dstar_lite(battleship *b) : bu(b), goal(-1), ship(-1), last(-1), km(0), scale(1), expanded(0) {
+}
+
+/**
+ * @brief Methods to restore the heap order after a key moved up or down
+ * @param i heap position
+ *
+ */
+void dstar_lite::heap_up(int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!less(heap_key[i], heap_key[p])) {
+            break;
+        }
+        swap(heap[i], heap[p]);
+        swap(heap_key[i], heap_key[p]);
+        heap_pos[heap[i]] = i;
+        heap_pos[heap[p]] = p;
+        i = p;
+    }
+}
+
+void dstar_lite::heap_down(int i) {
+    int n = (int)heap.size();
+    while (true) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if ((l < n) && less(heap_key[l], heap_key[m])) m = l;
+        if ((r < n) && less(heap_key[r], heap_key[m])) m = r;
+        if (m == i) {
+            break;
+        }
+        swap(heap[i], heap[m]);
+        swap(heap_key[i], heap_key[m]);
+        heap_pos[heap[i]] = i;
+        heap_pos[heap[m]] = m;
+        i = m;
+    }
+}
+
+/**
+ * @brief Method to insert a cell into the heap or change its key
+ * @param s cell index
+ * @param k new key
+ *
+ */
+void dstar_lite::heap_set(int s, _key k) {
+    int i = heap_pos[s];
+    if (i < 0) {
+        i = (int)heap.size();
+        heap.push_back(s);
+        heap_key.push_back(k);
+        heap_pos[s] = i;
+        heap_up(i);
+    } else {
+        bool up = less(k, heap_key[i]);
+        heap_key[i] = k;
+        if (up) {
+            heap_up(i);
+        } else {
+            heap_down(i);
+        }
+    }
+}
+
+/**
+ * @brief Method to remove a cell from the heap if it is queued
+ * @param s cell index
+ *
+ */
+void dstar_lite::heap_remove(int s) {
+    int i = heap_pos[s];
+    if (i < 0) {
+        return;
+    }
+    int back = (int)heap.size() - 1;
+    heap_pos[s] = -1;
+    if (i == back) {
+        heap.pop_back();
+        heap_key.pop_back();
+        return;
+    }
+    int moved = heap[back];                                     // the last entry fills the hole
+    heap[i] = moved;
+    heap_key[i] = heap_key[back];
+    heap_pos[moved] = i;
+    heap.pop_back();
+    heap_key.pop_back();
+    heap_up(i);
+    heap_down(heap_pos[moved]);
+}
+
+/**
+ * @brief Method to fetch the cells next to a cell, passable or not
+ * @param s cell index
+ * @param out array receiving up to 4 cell indices
+ * @returns number of neighbours written
+ *
+ */
+int dstar_lite::neighbours(int s, int out[4]) const {
+    int x = bu->x_of(s), y = bu->y_of(s), y_max = bu->get_y_max(), n = 0;
+    if (x > 0) out[n++] = s - y_max;
+    if (x + 1 < bu->get_x_max()) out[n++] = s + y_max;
+    if (y > 0) out[n++] = s - 1;
+    if (y + 1 < y_max) out[n++] = s + 1;
+    return n;
+}
+
+/**
+ * @brief Method to compute the one step lookahead of a cell, min over its
+ *        neighbours of the neighbour's step cost + g. Steps into or out of elevated
+ *        cells cost DSTAR_INF.
+ * @param s cell index
+ * @returns lookahead distance to the target
+ *
+ */
+int dstar_lite::best_rhs(int s) const {
+    if (!bu->is_passable(s)) {
+        return DSTAR_INF;
+    }
+    int nb[4], best = DSTAR_INF;
+    int n = neighbours(s, nb);
+    for (int i = 0; i < n; ++i) {
+        if (bu->is_passable(nb[i]) && (g[nb[i]] + step(nb[i]) < best)) {
+            best = g[nb[i]] + step(nb[i]);
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Method to queue a cell if it is inconsistent, unqueue it otherwise
+ * @param s cell index
+ *
+ */
+void dstar_lite::update_vertex(int s) {
+    if (g[s] != rhs[s]) {
+        heap_set(s, calc_key(s));
+    } else {
+        heap_remove(s);
+    }
+}
+
+/**
+ * @brief Method to expand inconsistent cells until the ship's cell is consistent
+ *        and no queued key is below its key
+ *
+ */
+void dstar_lite::compute(void) {
+    int nb[4];
+    expanded = 0;
+    while (!heap.empty() && (less(heap_key[0], calc_key(ship)) || (rhs[ship] > g[ship]))) {
+        int u = heap[0];
+        _key k_old = heap_key[0], k_new = calc_key(u);
+        ++expanded;
+        if (less(k_old, k_new)) {                               // key went stale through km
+            heap_set(u, k_new);
+        } else if (g[u] > rhs[u]) {                             // overconsistent, settle it
+            g[u] = rhs[u];
+            heap_remove(u);
+            int cost = step(u);                                 // every step into u
+            int n = neighbours(u, nb);
+            for (int i = 0; i < n; ++i) {
+                int s = nb[i];
+                if ((s != goal) && bu->is_passable(s) && (g[u] + cost < rhs[s])) {
+                    rhs[s] = g[u] + cost;
+                    update_vertex(s);
+                }
+            }
+        } else {                                                // underconsistent, raise it
+            int g_old = g[u], cost = step(u);
+            g[u] = DSTAR_INF;
+            int n = neighbours(u, nb);
+            nb[n++] = u;
+            for (int i = 0; i < n; ++i) {
+                int s = nb[i];
+                if ((s != goal) && ((rhs[s] == g_old + cost) || (s == u))) {
+                    rhs[s] = best_rhs(s);
+                }
+                update_vertex(s);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Method to plan from scratch, placing the ship on a start cell
+ * @param start ship cell index
+ * @param target target cell index
+ * @returns 1 if a path exists, 0 if not
+ *
+ */
+int dstar_lite::plan(int start, int target) {
+    size_t cells = (size_t)bu->get_cells();
+    g.assign(cells, DSTAR_INF);
+    rhs.assign(cells, DSTAR_INF);
+    heap_pos.assign(cells, -1);
+    heap.clear();
+    heap_key.clear();
+    goal = target;
+    ship = start;
+    last = ship;
+    km = 0;
+    scale = bu->has_costs() ? bu->get_min_cost() : 1;
+    if (bu->is_passable(goal)) {
+        rhs[goal] = 0;
+        heap_set(goal, calc_key(goal));
+    }
+    return replan();
+}
+
+/**
+ * @brief Method to flip a cell between ground and elevated terrain
+ * @param cell cell index
+ * @param type GROUND_TERRAIN or ELEVATED_TERRAIN
+ *
+ */
+void dstar_lite::set_cell(int cell, _f_type type) {
+    bool was = bu->is_passable(cell);
+    bu->set_terrain(cell, type);
+    if (was != bu->is_passable(cell)) {
+        update_cell(cell);
+    }
+}
+
+/**
+ * @brief Method to queue the repair of a cell changed through battleship::set_terrain()
+ * @param cell cell index
+ *
+ */
+void dstar_lite::update_cell(int cell) {
+    if (goal < 0) {
+        return;
+    }
+    km += h(last, ship);                                        // keys queued so far stay lower bounds
+    last = ship;
+
+    int nb[5];
+    int n = neighbours(cell, nb);
+    nb[n++] = cell;
+    for (int i = 0; i < n; ++i) {                               // every cell with a changed step cost
+        int s = nb[i];
+        if (s != goal) {
+            rhs[s] = best_rhs(s);
+        } else {
+            rhs[s] = bu->is_passable(goal) ? 0 : DSTAR_INF;
+        }
+        update_vertex(s);
+    }
+}
+
+/**
+ * @brief Method to move the ship. The battleship is not touched, so several plans
+ *        can share one map.
+ * @param cell new ship cell index
+ *
+ */
+void dstar_lite::move_to(int cell) {
+    ship = cell;
+}
+
+/**
+ * @brief Method to repair the plan after set_cell() and move_to() calls. A target
+ *        outside the ship's component is reported at once and the repair waits for
+ *        a later call.
+ * @returns 1 if a path exists, 0 if not
+ *
+ */
+int dstar_lite::replan(void) {
+    expanded = 0;
+    if ((goal < 0) || !bu->connected(ship, goal)) {
+        return 0;
+    }
+    km += h(last, ship);                                        // edits queued before a move keep lower bounds
+    last = ship;
+    compute();
+    return rhs[ship] < DSTAR_INF;                               // g[ship] may stay unsettled
+}
+
+/**
+ * @brief Method to pick the next cell of a shortest path. Cells whose key lies above
+ *        the ship's may still hold an outdated g, so only consistent cells one step
+ *        cost closer to the target qualify.
+ * @param s cell index
+ * @param dist distance from s to the target
+ * @returns cell index, -1 if no neighbour qualifies
+ *
+ */
+int dstar_lite::step_from(int s, int dist) const {
+    int nb[4];
+    int n = neighbours(s, nb);
+    for (int i = 0; i < n; ++i) {
+        int t = nb[i];
+        if (bu->is_passable(t) && (g[t] == dist - step(t)) && (rhs[t] == g[t])) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Method to fetch the next cell on the planned path
+ * @returns cell index, -1 if there is no path or the ship is on the target
+ *
+ */
+int dstar_lite::next_step(void) const {
+    if ((goal < 0) || (ship == goal) || (rhs[ship] >= DSTAR_INF)) {
+        return -1;
+    }
+    return step_from(ship, rhs[ship]);
+}
+
+/**
+ * @brief Method to read the planned path from the ship to the target
+ * @param sol pointer to vector receiving the path points, ship first
+ * @returns number of points in the path, 0 if there is no path
+ *
+ */
+int dstar_lite::get_path(vector<_points> *sol) const {
+    sol->clear();
+    if ((goal < 0) || (rhs[ship] >= DSTAR_INF) || !bu->connected(ship, goal)) {
+        return 0;
+    }
+    for (int s = ship, dist = rhs[ship]; ; dist -= step(s)) {
+        sol->push_back({bu->x_of(s), bu->y_of(s)});
+        if (s == goal) {
+            break;
+        }
+        s = step_from(s, dist);
+        if (s < 0) {                                            // plan not repaired yet
+            sol->clear();
+            return 0;
+        }
+    }
+    return (int)sol->size();
+}
@@ -0,0 +1,444 @@
+/**
+ * @brief   Fleet planning file
+ * @details This file contains the cooperative multi-ship planner. Ships are planned one after
+ *          another against a shared space-time reservation table (windowed cooperative A*),
+ *          so no two ships share a cell at a time step or swap cells between two steps.
+ *
+ */
+#include <algorithm>
+#include "fleet.hpp"
+
+/**
+ * @brief Function to hash a 32 bit key
+ *
+ */
+static inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    return x ^ (x >> 16);
+}
+
+/**
+ * @brief Method to size the table
+ * @param slots number of time steps held, at least window + 2
+ * @param ships number of ships that can reserve a time step
+ *
+ */
+void reservation_table::init(int slots, int ships) {
+    int cap = 8;
+    while (cap < 2 * ships) {
+        cap *= 2;
+    }
+    mask = cap - 1;
+    now = 0;
+    keys.assign(slots, vector<int>(cap, -1));
+    owners.assign(slots, vector<int>(cap, -1));
+    used.assign(slots, vector<int>());
+}
+
+/**
+ * @brief Method to look up the ship holding a cell at a time step
+ * @param cell cell index
+ * @param t time step, must be in [now, now + slots)
+ * @returns ship id, -1 if the cell is free
+ *
+ */
+int reservation_table::owner(int cell, int t) const {
+    const vector<int> &k = keys[t % keys.size()];
+    for (uint32_t h = hash32(cell) & mask; k[h] != -1; h = (h + 1) & mask) {
+        if (k[h] == cell) {
+            return owners[t % keys.size()][h];
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Method to reserve a cell at a time step for a ship
+ * @param cell cell index
+ * @param t time step, must be in [now, now + slots)
+ * @param ship ship id
+ *
+ */
+void reservation_table::reserve(int cell, int t, int ship) {
+    size_t s = t % keys.size();
+    uint32_t h = hash32(cell) & mask;
+    while ((keys[s][h] != -1) && (keys[s][h] != cell)) {
+        h = (h + 1) & mask;
+    }
+    if (keys[s][h] == -1) {
+        keys[s][h] = cell;
+        used[s].push_back(h);
+    }
+    owners[s][h] = ship;
+}
+
+/**
+ * @brief Method to move the clock one step, dropping the reservations of the old now
+ *
+ */
+void reservation_table::advance(void) {
+    size_t s = now % keys.size();
+    for (int h : used[s]) {
+        keys[s][h] = -1;
+    }
+    used[s].clear();
+    ++now;
+}
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param b pointer to the battleship holding the map
+ * @param w window length in time steps
+ *
+ */
+fleet_planner::fleet_planner(battleship *b, int w)
+    : bu(b), window(w > 0 ? w : 1), way_gen(0), node_gen(0), replans(0), yields(0) {
+    hold.assign(bu->get_cells(), -1);
+    way_mark.assign(bu->get_cells(), 0);
+    route_state.resize(bu->get_cells());
+}
+
+/**
+ * @brief Method to add a ship to the fleet before planning
+ * @param start start position
+ * @param target target position
+ * @returns ship id, -1 if a position is off the map, elevated or already taken
+ *          by another ship's start or target
+ *
+ */
+int fleet_planner::add_ship(_points start, _points target) {
+    int x_max = bu->get_x_max(), y_max = bu->get_y_max();
+    if ((start.x < 0) || (start.x >= x_max) || (start.y < 0) || (start.y >= y_max) ||
+        (target.x < 0) || (target.x >= x_max) || (target.y < 0) || (target.y >= y_max)) {
+        return -1;
+    }
+    int s = bu->index(start.x, start.y), t = bu->index(target.x, target.y);
+    if (!bu->is_passable(s) || !bu->is_passable(t) || (hold[s] >= 0)) {
+        return -1;
+    }
+    for (auto &other : ships) {                                 // two ships can not park on one cell
+        if (other.target == t) {
+            return -1;
+        }
+    }
+
+    _ship ship;
+    ship.start = s;
+    ship.target = t;
+    ship.pos = s;
+    ship.expires = 0;
+    ship.parked = 0;
+    ship.yield_to = -1;
+    ship.arrived = 0;
+    ship.progress = 0;
+    ship.path.push_back({start.x, start.y, 0});
+    ships.push_back(ship);
+    hold[s] = (int)ships.size() - 1;
+    return (int)ships.size() - 1;
+}
+
+/**
+ * @brief Method to check if a ship may move from a cell at time t - 1 to a cell at time t
+ * @param ship ship id
+ * @param from cell at time t - 1
+ * @param to cell at time t, equal to from for a wait
+ * @param t time step of the arrival
+ * @returns 1 if the move collides with the map or another ship, 0 if it is allowed
+ *
+ */
+int fleet_planner::blocked(int ship, int from, int to, int t) const {
+    int h = hold[to];
+    if ((h >= 0) && (h != ship) && (t >= ships[h].expires)) {  // held until the other ship replans
+        return 1;
+    }
+    int o = table.owner(to, t);
+    if ((o >= 0) && (o != ship)) {                              // vertex collision
+        return 1;
+    }
+    if (to != from) {                                           // edge collision, ships swap cells
+        o = table.owner(to, t - 1);
+        if ((o >= 0) && (o != ship) && (table.owner(from, t) == o)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Method to check if a ship can stay on a cell from time t on
+ * @param ship ship id
+ * @param cell cell index
+ * @param t first time step of the stay
+ * @returns 1 if no other ship holds or reserves the cell from t on, 0 otherwise
+ *
+ */
+int fleet_planner::free_from(int ship, int cell, int t) const {
+    if ((hold[cell] >= 0) && (hold[cell] != ship)) {
+        return 0;
+    }
+    for (int tt = t; tt < table.get_now() + table.get_slots(); ++tt) {
+        int o = table.owner(cell, tt);
+        if ((o >= 0) && (o != ship)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Method to find or create the space-time node for a cell at a window offset
+ * @param cell cell index
+ * @param dt time steps since the window start
+ * @param created pointer set to 1 if the node is new
+ * @returns node index
+ *
+ */
+int fleet_planner::find_node(int cell, int dt, int *created) {
+    if ((nodes.size() + 1) * 2 > node_keys.size()) {          // keep the load factor under 1/2
+        size_t cap = node_keys.empty() ? 1024 : node_keys.size() * 2;
+        node_keys.assign(cap, 0);
+        node_index.assign(cap, 0);
+        node_stamp.assign(cap, 0);
+        node_gen = 1;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            uint64_t key = ((uint64_t)(nodes[i].t - nodes[0].t) << 32) | (uint32_t)nodes[i].cell;
+            size_t h = hash32((uint32_t)(key ^ (key >> 29))) & (cap - 1);
+            while (node_stamp[h] == node_gen) {
+                h = (h + 1) & (cap - 1);
+            }
+            node_stamp[h] = node_gen;
+            node_keys[h] = key;
+            node_index[h] = (int)i;
+        }
+    }
+
+    size_t m = node_keys.size() - 1;
+    uint64_t key = ((uint64_t)dt << 32) | (uint32_t)cell;
+    size_t h = hash32((uint32_t)(key ^ (key >> 29))) & m;
+    while (node_stamp[h] == node_gen) {
+        if (node_keys[h] == key) {
+            *created = 0;
+            return node_index[h];
+        }
+        h = (h + 1) & m;
+    }
+    node_stamp[h] = node_gen;
+    node_keys[h] = key;
+    node_index[h] = (int)nodes.size();
+    nodes.push_back({cell, 0, -1, 0});
+    *created = 1;
+    return (int)nodes.size() - 1;
+}
+
+/**
+ * @brief Method to compute the shortest spatial route of a ship from its current
+ *        cell to its target, ignoring the other ships
+ * @param id ship id
+ * @returns 1 if the target is reachable, 0 if not
+ *
+ */
+int fleet_planner::route_to_target(int id) {
+    _ship &s = ships[id];
+    s.route.clear();
+    s.progress = 0;
+    if (!astar_search(bu, &route_state, s.pos, s.target)) {
+        s.route.push_back(s.pos);                               // nowhere to go, wait in place
+        return 0;
+    }
+    for (int node = s.target; node >= 0; node = route_state.get_parent(node)) {
+        s.route.push_back(node);
+    }
+    reverse(s.route.begin(), s.route.end());
+    return 1;
+}
+
+/**
+ * @brief Method to plan the next window of a ship with a space-time A*. Moves and
+ *        waits cost one step each; the search ends on the target if the ship can
+ *        park there, or at the window end on a cell no other ship needs later.
+ *        The heuristic is the Manhattan distance to the point of the spatial route
+ *        one window ahead. If the window makes no step along the route, the ships
+ *        holding the route up to that point are asked to make way: parked ships
+ *        always, moving ships only if their id is higher and this ship has not
+ *        arrived yet. A ship making way searches
+ *        without a heuristic for a window end off the route of the ship it makes
+ *        way for, so that ship finds the cells free when it plans its next window.
+ * @param id ship id
+ * @param now time step at which the window starts
+ * @param depth window length
+ *
+ */
+void fleet_planner::plan_window(int id, int now, int depth) {
+    _ship &s = ships[id];
+    int y_max = bu->get_y_max();
+
+    int k = s.progress, last = min((int)s.route.size(), s.progress + 2 * window + 1);
+    while ((k < last) && (s.route[k] != s.pos)) {
+        ++k;
+    }
+    if (k < last) {
+        s.progress = k;
+    } else {                                                    // pushed off the route, route again
+        route_to_target(id);
+    }
+    int ahead = min((int)s.route.size() - 1, s.progress + window);
+    int way = s.route[ahead];
+    int wx = way / y_max, wy = way % y_max;
+    int dodge = (s.yield_to >= 0);
+    if (dodge) {                                                // mark the route to keep off
+        if (++way_gen == 0) {
+            fill(way_mark.begin(), way_mark.end(), 0);
+            way_gen = 1;
+        }
+        const _ship &first = ships[s.yield_to];
+        for (size_t j = first.progress; j < first.route.size(); ++j) {
+            way_mark[first.route[j]] = way_gen;
+        }
+        s.yield_to = -1;
+    }
+    auto h = [&](int cell) { return dodge ? 0 : abs(cell / y_max - wx) + abs(cell % y_max - wy); };
+
+    if (++node_gen == 0) {
+        fill(node_stamp.begin(), node_stamp.end(), 0);
+        node_gen = 1;
+    }
+    nodes.clear();
+    open.clear();
+
+    int created, nb[5];
+    int root = find_node(s.pos, 0, &created);
+    nodes[root].t = now;
+    open.push(h(s.pos), root);
+
+    int end = root, park = 0, fallback = -1;
+    while (!open.empty()) {
+        int n = open.pop();
+        if (nodes[n].closed) {
+            continue;
+        }
+        nodes[n].closed = 1;
+        int cell = nodes[n].cell, t = nodes[n].t;
+        if (!dodge && (cell == s.target) && free_from(id, cell, t)) {
+            end = n;
+            park = 1;
+            break;
+        }
+        if (t == now + depth) {
+            if (free_from(id, cell, t)) {
+                if (!dodge || (way_mark[cell] != way_gen)) {
+                    end = n;
+                    break;
+                }
+                fallback = (fallback < 0) ? n : fallback;        // on the route, only if nothing else is free
+            }
+            continue;
+        }
+
+        int cnt = bu->get_passable_neighbours(cell, nb);
+        nb[cnt++] = cell;                                       // wait in place
+        for (int i = 0; i < cnt; ++i) {
+            int to = nb[i];
+            if (blocked(id, cell, to, t + 1)) {
+                continue;
+            }
+            int m = find_node(to, t + 1 - now, &created);
+            if (!created) {                                     // g = t - now, a revisit never improves
+                continue;
+            }
+            nodes[m].t = t + 1;
+            nodes[m].parent = n;
+            open.push(t + 1 - now + h(to), m);
+        }
+    }
+    if ((end == root) && (fallback >= 0)) {
+        end = fallback;
+    }
+
+    // commit the window: timed points, reservations and the hold at the end cell
+    for (int t = s.path.back().t + 1; t <= now; ++t) {          // a ship unparked waited on its target
+        s.path.push_back({s.pos / y_max, s.pos % y_max, t});
+    }
+    size_t base = s.path.size();
+    for (int n = end; n >= 0; n = nodes[n].parent) {
+        table.reserve(nodes[n].cell, nodes[n].t, id);
+        if (nodes[n].parent >= 0) {
+            s.path.push_back({nodes[n].cell / y_max, nodes[n].cell % y_max, nodes[n].t});
+        }
+    }
+    reverse(s.path.begin() + base, s.path.end());
+
+    if (hold[s.pos] == id) {
+        hold[s.pos] = -1;
+    }
+    s.pos = nodes[end].cell;
+    s.expires = nodes[end].t;
+    s.parked = park;
+    s.arrived |= park;
+    hold[s.pos] = id;
+    ++replans;
+
+    // no step along the route in this window: ask the ships holding it to make way
+    int moved = park;
+    for (int j = s.progress + 1; (j <= ahead) && !moved; ++j) {
+        moved = (s.route[j] == s.pos);
+    }
+    if (moved || dodge) {
+        return;
+    }
+    for (int j = s.progress + 1; j <= ahead; ++j) {
+        int holder = hold[s.route[j]];
+        if ((holder < 0) || (holder == id) || (ships[holder].yield_to >= 0)) {
+            continue;
+        }
+        _ship &other = ships[holder];
+        if (other.parked && (other.pos == other.target)) {      // parked ships make way for anyone
+            other.parked = 0;
+            other.expires = max(other.expires, now + 1);        // it may still be on its way
+        } else if (other.parked || s.arrived || (holder < id)) {  // moving ships only for a lower id, so no cycles
+            continue;
+        }
+        other.yield_to = id;
+        ++yields;
+    }
+}
+
+/**
+ * @brief Method to plan the fleet until every ship is parked
+ * @param max_steps time step limit
+ * @returns number of ships parked on their target
+ *
+ */
+int fleet_planner::plan(int max_steps) {
+    int parked = 0;
+    table.init(window + 2, (int)ships.size());
+    for (int id = 0; id < (int)ships.size(); ++id) {
+        if (!route_to_target(id)) {                             // target unreachable, stay at the start
+            ships[id].parked = 1;
+        }
+    }
+
+    for (int now = 0; now < max_steps; ++now) {
+        parked = 0;
+        for (int id = 0; id < (int)ships.size(); ++id) {
+            if (!ships[id].parked && (ships[id].expires == now)) {
+                int depth = (now == 0) ? (1 + id % window) : window;  // stagger the first windows
+                plan_window(id, now, depth);
+            }
+            parked += ships[id].parked;
+        }
+        if (parked == (int)ships.size()) {
+            break;
+        }
+        table.advance();
+    }
+
+    parked = 0;
+    for (auto &s : ships) {
+        parked += (s.parked && (s.pos == s.target));
+    }
+    return parked;
+}
@@ -0,0 +1,279 @@
+/**
+ * @brief   Parallel search file
+ * @details This file contains hash distributed A* (HDA*), which spreads one query over
+ *          several worker threads that own the cells of the map by a block hash.
+ *
+ */
+#include <climits>
+#include "hda.hpp"
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param b pointer to the battleship holding the map
+ * @param t number of workers, 0 for one per hardware thread, at most HDA_MAX_THREADS
+ *
+ */
+hda_search::hda_search(battleship *b, int t)
+    : bu(b), threads(t), generation(1), work(0), incumbent(INT_MAX), expanded(0), messages(0) {
+    if (threads <= 0) {
+        threads = (int)thread::hardware_concurrency();
+        threads = (threads > 0) ? threads : 1;
+    }
+    threads = (threads > HDA_MAX_THREADS) ? HDA_MAX_THREADS : threads;
+    stamp.assign(bu->get_cells(), 0);
+    g_cost.resize(bu->get_cells());
+    parent.resize(bu->get_cells());
+    for (int i = 0; i < threads * threads; ++i) {
+        lanes.push_back(make_unique<hda_lane>());
+    }
+    fronts = make_unique<_hda_front[]>(threads);
+    block_cols = (bu->get_y_max() >> HDA_BLOCK_SHIFT) + 1;
+    int blocks = ((bu->get_x_max() >> HDA_BLOCK_SHIFT) + 1) * block_cols;
+    block_owner.resize(blocks);
+    for (int b = 0; b < blocks; ++b) {                          // a hash spreads neighbouring blocks over the workers
+        uint32_t h = ((uint32_t)(b / block_cols) * 0x9E3779B1u) ^ ((uint32_t)(b % block_cols) * 0x85EBCA77u);
+        block_owner[b] = (uint8_t)((h ^ (h >> 15)) % (uint32_t)threads);
+    }
+}
+
+/**
+ * @brief Method to run one worker of a search until no worker has work left
+ * @param id worker id
+ * @param start start cell index
+ * @param target target cell index
+ * @param exp pointer receiving the cells the worker expanded
+ * @param sent pointer receiving the messages the worker sent
+ *
+ */
+void hda_search::worker(int id, int start, int target, long *exp, long *sent) {
+    int y_max = bu->get_y_max();
+    int tx = bu->x_of(target), ty = bu->y_of(target);
+    bool costs = bu->has_costs();
+    int scale = costs ? bu->get_min_cost() : 1;
+    auto h = [=](int x, int y) { return scale * (abs(x - tx) + abs(y - ty)); };
+    const uint8_t *pass = bu->has_border() ? bu->get_border() : NULL;
+    int w = y_max + 2;
+
+    bucket_queue open;
+    vector<vector<_hda_message>> outbox(threads);               // messages waiting for room in a full lane
+    long expanded_here = 0, sent_here = 0;
+    bool idle = false;
+
+    // a cell of this worker reached with cost g; reopened if that is lower than before
+    auto relax = [&](int cell, int x, int y, int g, int from) {
+        if (stamp[cell] != generation) {
+            stamp[cell] = generation;
+            g_cost[cell] = INT_MAX;
+        }
+        if (g < g_cost[cell]) {
+            g_cost[cell] = g;
+            parent[cell] = from;
+            open.push(g + h(x, y), cell);
+        }
+    };
+
+    // a generated cell: relaxed here if this worker owns it, else sent to its owner
+    auto generate = [&](int next, int nx, int ny, int g, int node, int best) {
+        int gn = g + (costs ? bu->step_cost(next) : 1);
+        int f = gn + h(nx, ny);
+        if (f >= best) {
+            return;
+        }
+        int r = owner(nx, ny);
+        if (r == id) {
+            relax(next, nx, ny, gn, node);
+            return;
+        }
+        work.fetch_add(1, memory_order_acq_rel);                // counted before the owner can see it
+        ++sent_here;
+        int64_t sent_rank = ((int64_t)f << 32) - gn;
+        int64_t in = fronts[r].inbound.load(memory_order_relaxed);
+        while ((sent_rank < in) && !fronts[r].inbound.compare_exchange_weak(in, sent_rank, memory_order_relaxed)) {
+        }
+        _hda_message out = {next, gn, node};
+        if (!outbox[r].empty() || !lanes[r * threads + id]->push(out)) {
+            outbox[r].push_back(out);                           // keeps the order of messages to one owner
+        }
+    };
+
+    if (owner(bu->x_of(start), bu->y_of(start)) == id) {
+        relax(start, bu->x_of(start), bu->y_of(start), 0, -1);
+    }
+    while (true) {
+        // handle the messages of every sender
+        _hda_message m;
+        fronts[id].inbound.store(INT64_MAX, memory_order_relaxed);
+        for (int s = 0; s < threads; ++s) {
+            hda_lane *lane = lanes[id * threads + s].get();
+            while (lane->pop(&m)) {
+                if (idle) {                                     // counted again before the message is let go
+                    work.fetch_add(1, memory_order_acq_rel);
+                    idle = false;
+                }
+                relax(m.cell, bu->x_of(m.cell), bu->y_of(m.cell), m.g, m.parent);
+                work.fetch_sub(1, memory_order_acq_rel);
+            }
+        }
+
+        // hand on messages that found a full lane earlier
+        size_t waiting = 0;
+        for (int r = 0; r < threads; ++r) {
+            vector<_hda_message> &box = outbox[r];
+            size_t done = 0;
+            while ((done < box.size()) && lanes[r * threads + id]->push(box[done])) {
+                ++done;
+            }
+            box.erase(box.begin(), box.begin() + done);
+            waiting += box.size();
+        }
+
+        // publish the next cell and wait while another worker holds a better one
+        int best = incumbent.load(memory_order_acquire);
+        if (!open.empty() && (open.top_key() >= best)) {        // nothing left here can beat the incumbent
+            open.clear();
+        }
+        if ((threads > 1) && !open.empty()) {
+            int64_t rank = ((int64_t)open.top_key() << 32) - g_cost[open.top_value()];
+            int64_t low = INT64_MAX;
+            fronts[id].rank.store(rank, memory_order_relaxed);
+            for (int k = 0; k < threads; ++k) {
+                if (k != id) {
+                    int64_t r = fronts[k].rank.load(memory_order_relaxed);
+                    int64_t in = fronts[k].inbound.load(memory_order_relaxed);
+                    low = (r < low) ? r : low;
+                    low = (in < low) ? in : low;
+                }
+            }
+            if ((low < INT64_MAX) && (rank > low + HDA_DEPTH_SLACK)) {
+                this_thread::yield();
+                continue;
+            }
+        } else {
+            fronts[id].rank.store(INT64_MAX, memory_order_relaxed);
+        }
+
+        // expand a burst of cells between two looks at the inbox
+        for (int burst = 0; (burst < HDA_BURST) && !open.empty(); ++burst) {
+            int f;
+            int node = open.pop(&f);
+            int g = g_cost[node];
+            int x = node / y_max, y = node - x * y_max;
+            if (f > g + h(x, y)) {                              // reopened with a lower g since this push
+                continue;
+            }
+            if (f >= best) {
+                open.clear();
+                break;
+            }
+            ++expanded_here;
+            if (node == target) {
+                while ((g < best) && !incumbent.compare_exchange_weak(best, g, memory_order_acq_rel)) {
+                }
+                break;
+            }
+            if (pass) {                                         // order of get_passable_neighbours()
+                const uint8_t *p = pass + bu->border_index(x, y);
+                if (p[-w]) generate(node - y_max, x - 1, y, g, node, best);
+                if (p[w]) generate(node + y_max, x + 1, y, g, node, best);
+                if (p[-1]) generate(node - 1, x, y - 1, g, node, best);
+                if (p[1]) generate(node + 1, x, y + 1, g, node, best);
+            } else {
+                int nb[4];
+                int n = bu->get_passable_neighbours(node, nb);
+                for (int i = 0; i < n; ++i) {
+                    generate(nb[i], bu->x_of(nb[i]), bu->y_of(nb[i]), g, node, best);
+                }
+            }
+        }
+        if (!open.empty() || waiting) {
+            continue;
+        }
+
+        if (!idle) {
+            idle = true;
+            work.fetch_sub(1, memory_order_acq_rel);
+        }
+        if (work.load(memory_order_acquire) == 0) {
+            break;
+        }
+        this_thread::yield();
+    }
+    *exp = expanded_here;
+    *sent = sent_here;
+}
+
+/**
+ * @brief Method to find a shortest path between two cells
+ * @param start start cell index
+ * @param target target cell index
+ * @param cells pointer to vector receiving the path cells, start first
+ * @returns 1 if a valid path is found. 0 if no path
+ *
+ */
+int hda_search::find_path(int start, int target, vector<int> *cells) {
+    cells->clear();
+    expanded = messages = 0;
+    if (!bu->connected(start, target)) {
+        return 0;
+    }
+    if (++generation == 0) {
+        fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    work.store(threads);
+    incumbent.store(INT_MAX);
+    for (int i = 0; i < threads; ++i) {
+        fronts[i].rank.store(INT64_MAX);
+        fronts[i].inbound.store(INT64_MAX);
+    }
+
+    vector<long> exp(threads, 0), sent(threads, 0);
+    vector<thread> pool;
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back(&hda_search::worker, this, i, start, target, &exp[i], &sent[i]);
+    }
+    worker(0, start, target, &exp[0], &sent[0]);                // the calling thread is worker 0
+    for (thread &t : pool) {
+        t.join();
+    }
+    for (int i = 0; i < threads; ++i) {
+        expanded += exp[i];
+        messages += sent[i];
+    }
+    if (incumbent.load() == INT_MAX) {
+        return 0;
+    }
+
+    for (int node = target; node >= 0; node = parent[node]) {  // g falls along the parents, so this ends at the start
+        cells->push_back(node);
+    }
+    reverse(cells->begin(), cells->end());
+    return 1;
+}
+
+/**
+ * @brief Function to find a path from start to target of the battleship with HDA*
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @param threads number of workers, 0 for one per hardware thread
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_hda(battleship *bu, vector<_points*> *sol, int threads) {
+    hda_search hda(bu, threads);
+    vector<int> cells;
+    search_state *ss = bu->get_scratch();
+    ss->reset();
+    int found = hda.find_path(bu->get_start(), bu->get_target(), &cells);
+    ss->expanded = hda.get_expanded();                          // reported like the other modes
+    for (int cell : cells) {
+        ss->touch(cell);
+        ss->marked_path[cell] = 1;
+        _points *p = new _points;
+        p->x = bu->x_of(cell);
+        p->y = bu->y_of(cell);
+        sol->push_back(p);
+    }
+    return found;
+}
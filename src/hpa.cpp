@@ -0,0 +1,540 @@
+/**
+ * @brief   Hierarchical pathfinding file
+ * @details This file contains HPA*: the abstract graph of cluster entrances built at load
+ *          time, the query that searches the abstract graph and refines the result into
+ *          cells, and the rebuild of single clusters after terrain changes.
+ *
+ */
+#include <algorithm>
+#include "hpa.hpp"
+
+/**
+ * @brief Constructor for class. Builds the abstract graph of the loaded map.
+ *
+ * @param b pointer to the battleship holding the map
+ * @param size cluster side in cells
+ *
+ */
+hpa_graph::hpa_graph(battleship *b, int size) : bu(b), cluster(size > 1 ? size : 2) {
+    rows = (bu->get_x_max() + cluster - 1) / cluster;
+    cols = (bu->get_y_max() + cluster - 1) / cluster;
+    members.assign(rows * cols, vector<int>());
+    down.assign(rows * cols, vector<int>());
+    right.assign(rows * cols, vector<int>());
+
+    for (int k = 0; k < rows * cols; ++k) {
+        find_entrances(k);
+    }
+    for (int k = 0; k < rows * cols; ++k) {
+        link_borders(k);
+    }
+    for (int k = 0; k < rows * cols; ++k) {
+        link_members(k);
+    }
+    version = bu->get_version();
+}
+
+/**
+ * @brief Method to find or create the abstract node of an entrance cell
+ * @param cell cell index
+ * @returns abstract node id
+ *
+ */
+int hpa_graph::node_for(int cell) {
+    auto it = node_of.find(cell);
+    if (it != node_of.end()) {
+        return it->second;
+    }
+    int id;
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+    } else {
+        id = (int)nodes.size();
+        nodes.push_back(_hpa_node());
+    }
+    nodes[id].cell = cell;
+    nodes[id].cluster = cluster_of(cell);
+    nodes[id].edges.clear();
+    members[nodes[id].cluster].push_back(id);
+    node_of[cell] = id;
+    return id;
+}
+
+/**
+ * @brief Method to join two abstract nodes in both directions, once
+ * @param a abstract node id
+ * @param b abstract node id
+ * @param cost steps between the two cells
+ *
+ */
+void hpa_graph::add_edge(int a, int b, int cost) {
+    for (auto &e : nodes[a].edges) {
+        if (e.to == b) {
+            return;
+        }
+    }
+    nodes[a].edges.push_back({b, cost});
+    nodes[b].edges.push_back({a, cost});
+}
+
+/**
+ * @brief Method to find the entrances on the lower and right border of a cluster.
+ *        An entrance is a run of cells passable on both sides of the border. Short
+ *        runs get their middle cell, long runs both end cells.
+ * @param k cluster id
+ *
+ */
+void hpa_graph::find_entrances(int k) {
+    int x0 = (k / cols) * cluster, y0 = (k % cols) * cluster;
+    int x1 = min(x0 + cluster, bu->get_x_max()), y1 = min(y0 + cluster, bu->get_y_max());
+    auto add_run = [](vector<int> *out, int first, int last, int step) {
+        int len = (last - first) / step + 1;
+        if (len >= HPA_LONG_ENTRANCE) {
+            out->push_back(first);
+            out->push_back(last);
+        } else {
+            out->push_back(first + (len - 1) / 2 * step);
+        }
+    };
+
+    down[k].clear();
+    if ((k / cols) + 1 < rows) {                                // cells of row x1 - 1 facing row x1
+        int run = -1;
+        for (int y = y0; y <= y1; ++y) {
+            int cell = bu->index(x1 - 1, y);
+            bool open = (y < y1) && bu->is_passable(cell) && bu->is_passable(cell + bu->get_y_max());
+            if (open && (run < 0)) {
+                run = cell;
+            } else if (!open && (run >= 0)) {
+                add_run(&down[k], run, cell - 1, 1);
+                run = -1;
+            }
+        }
+    }
+
+    right[k].clear();
+    if ((k % cols) + 1 < cols) {                                // cells of column y1 - 1 facing column y1
+        int run = -1, step = bu->get_y_max();
+        for (int x = x0; x <= x1; ++x) {
+            int cell = bu->index(x, y1 - 1);
+            bool open = (x < x1) && bu->is_passable(cell) && bu->is_passable(cell + 1);
+            if (open && (run < 0)) {
+                run = cell;
+            } else if (!open && (run >= 0)) {
+                add_run(&right[k], run, cell - step, step);
+                run = -1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Method to create the nodes and inter-cluster edges of the entrances on
+ *        all four borders of a cluster
+ * @param k cluster id
+ *
+ */
+void hpa_graph::link_borders(int k) {
+    int y_max = bu->get_y_max();
+    for (int cell : down[k]) {
+        add_edge(node_for(cell), node_for(cell + y_max), 1);
+    }
+    for (int cell : right[k]) {
+        add_edge(node_for(cell), node_for(cell + 1), 1);
+    }
+    if (k / cols > 0) {
+        for (int cell : down[k - cols]) {
+            add_edge(node_for(cell), node_for(cell + y_max), 1);
+        }
+    }
+    if (k % cols > 0) {
+        for (int cell : right[k - 1]) {
+            add_edge(node_for(cell), node_for(cell + 1), 1);
+        }
+    }
+}
+
+/**
+ * @brief Method to join the nodes of a cluster by their in-cluster distances,
+ *        one cluster BFS per node
+ * @param k cluster id
+ *
+ */
+void hpa_graph::link_members(int k) {
+    hpa_state *st = &build_state;
+    for (int u : members[k]) {
+        cluster_bfs(st, k, nodes[u].cell, -1);
+        for (int v : members[k]) {
+            int li = local_index(k, nodes[v].cell);
+            if ((v != u) && (st->local_stamp[li] == st->local_gen)) {
+                nodes[u].edges.push_back({v, st->local_dist[li]});
+            }
+        }
+    }
+}
+
+/**
+ * @brief Method to remove all nodes of a cluster and the edges leading to them
+ * @param k cluster id
+ *
+ */
+void hpa_graph::drop_cluster(int k) {
+    for (int u : members[k]) {
+        for (auto &e : nodes[u].edges) {
+            vector<_hpa_edge> &back = nodes[e.to].edges;
+            if (nodes[e.to].cluster != k) {
+                back.erase(remove_if(back.begin(), back.end(), [u](const _hpa_edge &b) { return b.to == u; }),
+                           back.end());
+            }
+        }
+        node_of.erase(nodes[u].cell);
+        nodes[u].cell = -1;
+        nodes[u].edges.clear();
+        free_ids.push_back(u);
+    }
+    members[k].clear();
+}
+
+/**
+ * @brief Method to run a BFS that never leaves a box of cells. Distances and parents
+ *        land in the local arrays at (x - x0) * stride + (y - y0).
+ * @param st scratch receiving the distances and parent links
+ * @param x0 first row of the box
+ * @param y0 first column of the box
+ * @param x1 row past the box
+ * @param y1 column past the box
+ * @param stride local cells per box row, at least y1 - y0
+ * @param from source cell index
+ * @param to cell index to stop at, -1 to reach the whole box
+ * @returns steps to the cell to stop at, -1 if it is not reached
+ *
+ */
+int hpa_graph::box_bfs(hpa_state *st, int x0, int y0, int x1, int y1, int stride, int from, int to) const {
+    size_t area = (size_t)(x1 - x0) * stride;
+    if (st->local_stamp.size() < area) {                        // sized to the largest box seen
+        st->local_stamp.assign(area, 0);
+        st->local_dist.resize(area);
+        st->local_parent.resize(area);
+        st->local_gen = 0;
+    }
+    if (++st->local_gen == 0) {
+        fill(st->local_stamp.begin(), st->local_stamp.end(), 0);
+        st->local_gen = 1;
+    }
+
+    int li = (bu->x_of(from) - x0) * stride + bu->y_of(from) - y0, nb[4];
+    st->local_stamp[li] = st->local_gen;
+    st->local_dist[li] = 0;
+    st->local_parent[li] = -1;
+    st->local_queue.clear();
+    st->local_queue.push_back(from);
+    for (size_t head = 0; head < st->local_queue.size(); ++head) {
+        int cell = st->local_queue[head];
+        int d = st->local_dist[(bu->x_of(cell) - x0) * stride + bu->y_of(cell) - y0];
+        if (cell == to) {
+            st->refined_cells += (long)head;
+            return d;
+        }
+        int n = bu->get_passable_neighbours(cell, nb);
+        for (int i = 0; i < n; ++i) {
+            int x = bu->x_of(nb[i]), y = bu->y_of(nb[i]);
+            if ((x < x0) || (x >= x1) || (y < y0) || (y >= y1)) {
+                continue;
+            }
+            li = (x - x0) * stride + (y - y0);
+            if (st->local_stamp[li] != st->local_gen) {
+                st->local_stamp[li] = st->local_gen;
+                st->local_dist[li] = d + 1;
+                st->local_parent[li] = cell;
+                st->local_queue.push_back(nb[i]);
+            }
+        }
+    }
+    st->refined_cells += (long)st->local_queue.size();
+    return -1;
+}
+
+/**
+ * @brief Method to run a BFS that never leaves one cluster
+ * @param st scratch receiving the distances and parent links, see local_index()
+ * @param k cluster id
+ * @param from source cell index
+ * @param to cell index to stop at, -1 to reach the whole cluster
+ * @returns steps to the cell to stop at, -1 if it is not reached
+ *
+ */
+int hpa_graph::cluster_bfs(hpa_state *st, int k, int from, int to) const {
+    int x0 = (k / cols) * cluster, y0 = (k % cols) * cluster;
+    int x1 = min(x0 + cluster, bu->get_x_max()), y1 = min(y0 + cluster, bu->get_y_max());
+    return box_bfs(st, x0, y0, x1, y1, cluster, from, to);
+}
+
+/**
+ * @brief Method to shorten a refined path. Paths through entrances detour around
+ *        cluster borders, so every window of two clusters' steps whose ends are closer
+ *        than its length is searched again with a BFS in the window's bounding box,
+ *        grown by HPA_SMOOTH_MARGIN. A second pass with windows shifted by a cluster
+ *        catches detours across the window ends of the first. Detours around the far
+ *        side of an obstacle larger than a window stay.
+ * @param st per-query scratch holding the path in st->cells
+ *
+ */
+void hpa_graph::smooth_path(hpa_state *st) const {
+    int step = 2 * cluster;
+    for (int pass = 0; pass < 2; ++pass) {
+        vector<int> &in = st->cells, &out = st->smoothed;
+        int n = (int)in.size();
+        out.clear();
+        out.push_back(in[0]);
+        for (int i = 0, j; i + 1 < n; i = j) {
+            j = min(n - 1, i + ((pass && !i) ? step / 2 : step));
+            int a = in[i], b = in[j];
+            int ax = bu->x_of(a), ay = bu->y_of(a), bx = bu->x_of(b), by = bu->y_of(b);
+            if (abs(ax - bx) + abs(ay - by) == j - i) {             // already as short as it gets
+                out.insert(out.end(), in.begin() + i + 1, in.begin() + j + 1);
+                continue;
+            }
+            int x0 = ax, x1 = ax, y0 = ay, y1 = ay;
+            for (int c = i + 1; c <= j; ++c) {
+                x0 = min(x0, bu->x_of(in[c]));
+                x1 = max(x1, bu->x_of(in[c]));
+                y0 = min(y0, bu->y_of(in[c]));
+                y1 = max(y1, bu->y_of(in[c]));
+            }
+            x0 = max(0, x0 - HPA_SMOOTH_MARGIN);
+            y0 = max(0, y0 - HPA_SMOOTH_MARGIN);
+            x1 = min(bu->get_x_max(), x1 + HPA_SMOOTH_MARGIN + 1);
+            y1 = min(bu->get_y_max(), y1 + HPA_SMOOTH_MARGIN + 1);
+            int stride = y1 - y0;
+            if (box_bfs(st, x0, y0, x1, y1, stride, b, a) >= j - i) {   // the window holds the old path
+                out.insert(out.end(), in.begin() + i + 1, in.begin() + j + 1);
+                continue;
+            }
+            for (int cell = st->local_parent[(ax - x0) * stride + ay - y0]; cell >= 0;
+                 cell = st->local_parent[(bu->x_of(cell) - x0) * stride + bu->y_of(cell) - y0]) {
+                out.push_back(cell);                            // parents of a lead to b
+            }
+        }
+        in.swap(out);
+    }
+}
+
+/**
+ * @brief Method to find a path between two cells
+ * @param st per-query scratch, one per thread
+ * @param start start cell index
+ * @param target target cell index
+ * @returns number of path cells left in st->cells, start first, 0 if no path
+ *
+ */
+int hpa_graph::find_path(hpa_state *st, int start, int target) const {
+    st->cells.clear();
+    st->abstract_expanded = 0;
+    st->refined_cells = 0;
+    st->counters = {};
+    if (!bu->connected(start, target)) {
+        return 0;
+    }
+    if (start == target) {
+        st->cells.push_back(start);
+        return 1;
+    }
+
+    // link start and target into their clusters, the start may also reach the target directly
+    int ks = cluster_of(start), kt = cluster_of(target), direct = -1;
+    st->start_edges.clear();
+    st->target_edges.clear();
+    cluster_bfs(st, ks, start, -1);
+    for (int u : members[ks]) {
+        int li = local_index(ks, nodes[u].cell);
+        if (st->local_stamp[li] == st->local_gen) {
+            st->start_edges.push_back({u, st->local_dist[li]});
+        }
+    }
+    if ((ks == kt) && (st->local_stamp[local_index(kt, target)] == st->local_gen)) {
+        direct = st->local_dist[local_index(kt, target)];
+    }
+    cluster_bfs(st, kt, target, -1);
+    for (int u : members[kt]) {
+        int li = local_index(kt, nodes[u].cell);
+        if (st->local_stamp[li] == st->local_gen) {
+            st->target_edges.push_back({u, st->local_dist[li]});
+        }
+    }
+
+    // A* over the abstract nodes, S and T stand for the start and target
+    int S = (int)nodes.size(), T = S + 1;
+    if (st->stamp.size() < nodes.size() + 2) {
+        st->stamp.resize(nodes.size() + 2, 0);
+        st->g_cost.resize(nodes.size() + 2);
+        st->parent.resize(nodes.size() + 2);
+        st->closed.resize(nodes.size() + 2);
+    }
+    if (++st->gen == 0) {
+        fill(st->stamp.begin(), st->stamp.end(), 0);
+        st->gen = 1;
+    }
+    int tx = bu->x_of(target), ty = bu->y_of(target);
+    auto cell_of = [&](int u) { return (u == S) ? start : (u == T) ? target : nodes[u].cell; };
+    auto relax = [&](int u, int v, int g) {
+        if (st->stamp[v] != st->gen) {
+            st->stamp[v] = st->gen;
+            st->g_cost[v] = INT32_MAX;
+            st->closed[v] = 0;
+        }
+        if (!st->closed[v] && (g < st->g_cost[v])) {
+            st->g_cost[v] = g;
+            st->parent[v] = u;
+            int c = cell_of(v);
+            st->open_list.push(g + abs(bu->x_of(c) - tx) + abs(bu->y_of(c) - ty), v);
+            STAT_ADD(st, pushes, 1);
+        }
+    };
+
+    st->open_list.clear();
+    relax(-1, S, 0);
+    int found = 0;
+    while (!st->open_list.empty()) {
+        STAT_PEAK(st, peak_open, st->open_list.size());
+        int u = st->open_list.pop();
+        STAT_ADD(st, pops, 1);
+        if (st->closed[u]) {
+            STAT_ADD(st, stale, 1);
+            continue;
+        }
+        st->closed[u] = 1;
+        ++st->abstract_expanded;
+        if (u == T) {
+            found = 1;
+            break;
+        }
+        int g = st->g_cost[u];
+        STAT_ADD(st, generated, (u == S) ? st->start_edges.size() : nodes[u].edges.size());
+        if (u == S) {
+            for (auto &e : st->start_edges) {
+                relax(u, e.to, g + e.cost);
+            }
+            if (direct >= 0) {
+                relax(u, T, g + direct);
+            }
+            continue;
+        }
+        for (auto &e : nodes[u].edges) {
+            relax(u, e.to, g + e.cost);
+        }
+        if (nodes[u].cluster == kt) {
+            for (auto &e : st->target_edges) {
+                if (e.to == u) {
+                    relax(u, T, g + e.cost);
+                }
+            }
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+
+    // refine the abstract path: inter-cluster edges are single steps, the rest cluster BFSs
+    vector<int> way;
+    for (int u = T; u >= 0; u = st->parent[u]) {
+        way.push_back(cell_of(u));
+    }
+    reverse(way.begin(), way.end());
+    st->cells.push_back(start);
+    for (size_t i = 1; i < way.size(); ++i) {
+        int a = way[i - 1], b = way[i];
+        if (a == b) {
+            continue;
+        }
+        int k = cluster_of(a);
+        if (k != cluster_of(b)) {
+            st->cells.push_back(b);
+            continue;
+        }
+        cluster_bfs(st, k, b, a);                               // parents of a lead to b
+        for (int cell = st->local_parent[local_index(k, a)]; cell >= 0;
+             cell = st->local_parent[local_index(k, cell)]) {
+            st->cells.push_back(cell);
+        }
+    }
+    smooth_path(st);
+    return (int)st->cells.size();
+}
+
+/**
+ * @brief Method to rebuild the clusters a changed cell can affect
+ * @param cell cell index
+ *
+ */
+void hpa_graph::update_cell(int cell) {
+    int k = cluster_of(cell);
+    int xl = bu->x_of(cell) - (k / cols) * cluster, yl = bu->y_of(cell) - (k % cols) * cluster;
+    int touched[3], n = 0;                                      // clusters whose entrances may change
+    touched[n++] = k;
+    if ((xl == cluster - 1) && ((k / cols) + 1 < rows)) {
+        touched[n++] = k + cols;
+    } else if ((xl == 0) && (k / cols > 0)) {
+        touched[n++] = k - cols;
+    }
+    if ((yl == cluster - 1) && ((k % cols) + 1 < cols)) {
+        touched[n++] = k + 1;
+    } else if ((yl == 0) && (k % cols > 0)) {
+        touched[n++] = k - 1;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        drop_cluster(touched[i]);
+    }
+    for (int i = 0; i < n; ++i) {
+        find_entrances(touched[i]);
+    }
+    for (int i = 0; i < n; ++i) {
+        link_borders(touched[i]);
+    }
+    for (int i = 0; i < n; ++i) {
+        link_members(touched[i]);
+    }
+    version = bu->get_version();
+}
+
+/**
+ * @brief Method to count the directed edges of the abstract graph
+ *
+ */
+size_t hpa_graph::get_edges(void) const {
+    size_t count = 0;
+    for (auto &node : nodes) {
+        count += node.edges.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Function to find a path from start to target of the battleship with HPA*
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_hpa(battleship *bu, vector<_points*> *sol) {
+    hpa_graph graph(bu);
+    hpa_state st;
+    search_state *ss = bu->get_scratch();
+    ss->reset();
+    int found = graph.find_path(&st, bu->get_start(), bu->get_target());
+    ss->expanded = st.abstract_expanded;                        // reported like the other modes
+    ss->counters = st.counters;
+    if (!found) {
+        return 0;
+    }
+    for (int cell : st.cells) {
+        ss->touch(cell);
+        ss->marked_path[cell] = 1;
+        _points *p = new _points;
+        p->x = bu->x_of(cell);
+        p->y = bu->y_of(cell);
+        sol->push_back(p);
+    }
+    return 1;
+}
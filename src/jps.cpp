@@ -0,0 +1,193 @@
+/**
+ * @brief   Jump point search file
+ * @details This file contains the Jump Point Search (JPS) mode for the pathfinding problem. It is the
+ *          4-connected variant: moves along a row (the contiguous axis of the terrain array) are
+ *          scanned until a forced neighbour appears, moves across rows additionally stop where
+ *          a row scan finds a jump point. The search over jump points is A* with the same
+ *          bucket open list as astar_search(), so path lengths are optimal.
+ *
+ */
+#include <cstring>
+#include "pathfinding.hpp"
+#include "definitions.hpp"
+
+/**
+ * @brief Function to check 8 terrain bytes at once for ELEVATED_TERRAIN
+ * @param p pointer to the first byte
+ * @return true if any of the bytes is elevated terrain
+ *
+ */
+static inline bool has_wall8(const int8_t *p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    w ^= 0x0303030303030303ULL;                                 // elevated bytes become zero
+    return ((w - 0x0101010101010101ULL) & ~w & 0x8080808080808080ULL) != 0;
+}
+
+/**
+ * @brief Function to scan along row x from (x, y) in direction d (+1/-1)
+ *        until a jump point is found. The cell (x, y - d) is the one we came from.
+ * @param bu pointer the the battleship class
+ * @param x row of the scan
+ * @param y first column of the scan
+ * @param d direction along the row
+ * @param target target cell index
+ * @return cell index of the jump point, -1 if the scan runs into a wall or the edge
+ *
+ */
+static int jump_row(const battleship *bu, int x, int y, int d, int target) {
+    int x_max = bu->get_x_max(), y_max = bu->get_y_max();
+    const int8_t *row = bu->get_terrain_data() + (size_t)x * y_max;
+    const int8_t *up = (x > 0) ? (row - y_max) : NULL;
+    const int8_t *down = (x + 1 < x_max) ? (row + y_max) : NULL;
+    int t_col = (target / y_max == x) ? (target % y_max) : -1;
+
+    for (; (y >= 0) && (y < y_max); y += d) {
+        int lo = (d > 0) ? y : (y - 7);                         // skip 8 cells when the block and the
+        if ((lo >= 1) && (lo + 9 <= y_max) &&                   // rows around it hold no wall at all
+            ((t_col < lo) || (t_col > lo + 7)) && !has_wall8(row + lo) &&
+            (!up || (!has_wall8(up + lo - 1) && !has_wall8(up + lo + 1))) &&
+            (!down || (!has_wall8(down + lo - 1) && !has_wall8(down + lo + 1)))) {
+            y += 7 * d;
+            continue;
+        }
+        if (row[y] == ELEVATED_TERRAIN) {
+            return -1;
+        }
+        if (y == t_col) {
+            return x * y_max + y;
+        }
+        int py = y - d;                                         // forced neighbour above or below
+        if ((up && (up[y] != ELEVATED_TERRAIN) && (up[py] == ELEVATED_TERRAIN)) ||
+            (down && (down[y] != ELEVATED_TERRAIN) && (down[py] == ELEVATED_TERRAIN))) {
+            return x * y_max + y;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Function to scan across rows from (x, y) in direction d (+1/-1)
+ *        until a jump point is found. The cell (x - d, y) is the one we came from.
+ * @param bu pointer the the battleship class
+ * @param x first row of the scan
+ * @param y column of the scan
+ * @param d direction across the rows
+ * @param target target cell index
+ * @return cell index of the jump point, -1 if the scan runs into a wall or the edge
+ *
+ */
+static int jump_col(const battleship *bu, int x, int y, int d, int target) {
+    int x_max = bu->get_x_max(), y_max = bu->get_y_max();
+    const int8_t *t = bu->get_terrain_data();
+
+    for (; (x >= 0) && (x < x_max); x += d) {
+        int idx = x * y_max + y;
+        if (t[idx] == ELEVATED_TERRAIN) {
+            return -1;
+        }
+        if (idx == target) {
+            return idx;
+        }
+        int pidx = idx - d * y_max;                             // forced neighbour left or right
+        if (((y > 0) && (t[idx - 1] != ELEVATED_TERRAIN) && (t[pidx - 1] == ELEVATED_TERRAIN)) ||
+            ((y + 1 < y_max) && (t[idx + 1] != ELEVATED_TERRAIN) && (t[pidx + 1] == ELEVATED_TERRAIN))) {
+            return idx;
+        }
+        if (((y + 1 < y_max) && (jump_row(bu, x, y + 1, 1, target) >= 0)) ||
+            ((y > 0) && (jump_row(bu, x, y - 1, -1, target) >= 0))) {
+            return idx;                                         // a turn into the row leads somewhere
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Function to run 4-connected Jump Point Search between two cells. Moves
+ *        along a row continue until a forced neighbour shows up in an adjacent
+ *        row; moves across rows stop wherever a row jump from the cell finds a
+ *        jump point. Only jump points enter the open list, parent links join
+ *        jump points on straight lines. Same path length as astar_search().
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int jps_search(battleship *bu, search_state *ss, int start, int target) {
+    int x_max = bu->get_x_max(), y_max = bu->get_y_max();
+    int tx = bu->x_of(target), ty = bu->y_of(target);
+    bucket_queue *open = &ss->open_list;
+
+    ss->reset();
+    if (!bu->connected(start, target)) {                        // different components, nothing to search
+        return 0;
+    }
+
+    ss->touch(start);
+    ss->g_cost[start] = 0;
+    open->push(abs(bu->x_of(start) - tx) + abs(bu->y_of(start) - ty), start);
+
+    STAT_ADD(ss, pushes, 1);
+    while (!open->empty()) {
+        STAT_PEAK(ss, peak_open, open->size());
+        int node = open->pop();
+        STAT_ADD(ss, pops, 1);
+        if (ss->visited[node] == CLOSED) {                      // stale duplicate entry
+            STAT_ADD(ss, stale, 1);
+            continue;
+        }
+        ss->visited[node] = CLOSED;
+        ++ss->expanded;
+        if (node == target) {
+            return 1;
+        }
+
+        int x = bu->x_of(node), y = node - x * y_max;
+        int dirs[4][2], n = 0;                                  // pruned directions (dx, dy)
+        int par = ss->parent[node];
+        if (par < 0) {
+            dirs[n][0] = -1; dirs[n++][1] = 0;
+            dirs[n][0] = 1;  dirs[n++][1] = 0;
+            dirs[n][0] = 0;  dirs[n++][1] = -1;
+            dirs[n][0] = 0;  dirs[n++][1] = 1;
+        } else if (bu->x_of(par) == x) {                        // arrived along the row
+            int dy = (y > par - x * y_max) ? 1 : -1;
+            dirs[n][0] = -1; dirs[n++][1] = 0;
+            dirs[n][0] = 1;  dirs[n++][1] = 0;
+            dirs[n][0] = 0;  dirs[n++][1] = dy;
+        } else {                                                // arrived across the rows
+            int dx = (x > bu->x_of(par)) ? 1 : -1;
+            dirs[n][0] = 0;  dirs[n++][1] = -1;
+            dirs[n][0] = 0;  dirs[n++][1] = 1;
+            dirs[n][0] = dx; dirs[n++][1] = 0;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int nx = x + dirs[i][0], ny = y + dirs[i][1];
+            if ((nx < 0) || (nx >= x_max) || (ny < 0) || (ny >= y_max)) {
+                continue;
+            }
+            int jp = dirs[i][0] ? jump_col(bu, nx, ny, dirs[i][0], target)
+                                : jump_row(bu, nx, ny, dirs[i][1], target);
+            if (jp < 0) {
+                continue;
+            }
+            STAT_ADD(ss, generated, 1);
+            ss->touch(jp);
+            if (ss->visited[jp] == CLOSED) {
+                continue;
+            }
+            int jx = bu->x_of(jp), jy = jp - jx * y_max;
+            int g = ss->g_cost[node] + abs(jx - x) + abs(jy - y);
+            if (g < ss->g_cost[jp]) {
+                ss->g_cost[jp] = g;
+                ss->parent[jp] = node;
+                open->push(g + abs(jx - tx) + abs(jy - ty), jp);
+                STAT_ADD(ss, pushes, 1);
+            }
+        }
+    }
+    return 0;
+}
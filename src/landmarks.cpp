@@ -0,0 +1,180 @@
+/**
+ * @brief   Landmark file
+ * @details This file contains the preprocessing of the ALT heuristic: farthest-point
+ *          landmark selection and the 16-bit BFS distance tables of the landmarks.
+ *
+ */
+#include <climits>
+#include <unordered_map>
+#include "landmarks.hpp"
+#include "bitbfs.hpp"
+
+/**
+ * @brief Function to pick a cell of the largest component as the selection seed
+ * @param bu pointer to the battleship holding the map
+ * @returns cell index, -1 if no cell is passable
+ *
+ */
+static int largest_component_cell(battleship *bu) {
+    const component_index *ci = bu->get_components();
+    int seed = -1;
+    if (!ci->built()) {                                         // no labels, any passable cell
+        for (int i = 0; (i < bu->get_cells()) && (seed < 0); ++i) {
+            seed = bu->is_passable(i) ? i : -1;
+        }
+        return seed;
+    }
+    unordered_map<int, int> size;
+    int best = 0;
+    for (int i = 0; i < bu->get_cells(); ++i) {
+        int c = ci->component(i);
+        if ((c >= 0) && (++size[c] > best)) {
+            best = size[c];
+            seed = i;
+        }
+    }
+    return seed;
+}
+
+/**
+ * @brief Function to compute the lowest cost from one cell to every cell of its
+ *        component with Dijkstra on the traversal costs. The open list is the
+ *        bucket queue, so with small integer costs this is Dial's algorithm.
+ * @param bu pointer to the battleship holding the map and its costs
+ * @param src source cell index
+ * @param dist pointer to vector receiving one cost per cell, -1 where unreached
+ */
+static void cost_field(battleship *bu, int src, vector<int> *dist) {
+    bucket_queue open;
+    int nb[4];
+    dist->assign(bu->get_cells(), -1);
+    vector<uint8_t> closed(bu->get_cells(), 0);
+    (*dist)[src] = 0;
+    open.push(0, src);
+    while (!open.empty()) {
+        int g;
+        int node = open.pop(&g);
+        if (closed[node]) {
+            continue;
+        }
+        closed[node] = 1;
+        int n = bu->get_passable_neighbours(node, nb);
+        for (int i = 0; i < n; ++i) {
+            int next = nb[i];
+            int d = g + bu->step_cost(next);
+            if (!closed[next] && (((*dist)[next] < 0) || (d < (*dist)[next]))) {
+                (*dist)[next] = d;
+                open.push(d, next);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Constructor for class. Picks the landmarks and runs one BFS from each, or
+ *        one Dijkstra on a map with traversal costs.
+ *
+ * @param b pointer to the battleship holding the map, components built
+ * @param k number of landmarks to pick, at most ALT_MAX_LANDMARKS
+ *
+ */
+landmark_set::landmark_set(battleship *b, int k) : bu(b), count(0) {
+    version = bu->get_version();
+    k = (k > ALT_MAX_LANDMARKS) ? ALT_MAX_LANDMARKS : k;
+    size_t n = bu->get_cells();
+    int seed = largest_component_cell(bu);
+    if ((seed < 0) || (k <= 0)) {
+        return;
+    }
+
+    bit_grid grid(bu);
+    bfs_state st;
+    vector<int> d;                                              // distances from the current source, -1 unreached
+    auto field = [&](int src) {
+        if (bu->has_costs()) {
+            cost_field(bu, src, &d);
+            return;
+        }
+        grid.distance_field(&st, src);
+        d.resize(n);
+        for (size_t c = 0; c < n; ++c) {
+            d[c] = grid.get_distance(&st, (int)c);
+        }
+    };
+
+    vector<int> near(n, -1);                                    // distance to the nearest landmark, -1 off the component
+    dist.assign(n * k, LANDMARK_NONE);                          // stride k while building
+    field(seed);
+    int next = seed, far = 0;
+    for (size_t c = 0; c < n; ++c) {
+        near[c] = (d[c] >= 0) ? INT_MAX : -1;
+        if (d[c] > far) {
+            far = d[c];
+            next = (int)c;
+        }
+    }
+
+    for (int l = 0; l < k; ++l) {
+        field(next);
+        bool fits = true;
+        for (size_t c = 0; c < n; ++c) {
+            if (d[c] < 0) {
+                continue;
+            }
+            near[c] = (d[c] < near[c]) ? d[c] : near[c];
+            if (d[c] >= LANDMARK_NONE) {
+                fits = false;
+            }
+        }
+        if (fits) {                                             // a table that overflows 16 bits is left out
+            for (size_t c = 0; c < n; ++c) {
+                if (d[c] >= 0) {
+                    dist[c * k + count] = (uint16_t)d[c];
+                }
+            }
+            cells.push_back(next);
+            ++count;
+        }
+
+        // the next landmark is the cell farthest from all landmarks so far
+        far = 0;
+        for (size_t c = 0; c < n; ++c) {
+            if (near[c] > far) {
+                far = near[c];
+                next = (int)c;
+            }
+        }
+        if (far == 0) {                                         // every cell of the component is a landmark
+            break;
+        }
+    }
+
+    if (count < k) {                                            // close the gaps of unused slots, stride count
+        for (size_t c = 0; c < n; ++c) {
+            for (int l = 0; l < count; ++l) {
+                dist[c * count + l] = dist[c * k + l];
+            }
+        }
+        dist.resize(n * count);
+        dist.shrink_to_fit();
+    }
+}
+
+/**
+ * @brief Function to find a path from start to target of the battleship with ALT.
+ *        Builds a one-off landmark_set, which costs a BFS over the map per landmark;
+ *        keep a landmark_set around to answer many queries.
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int find_path_alt(battleship *bu, vector<_points*> *sol) {
+    landmark_set lm(bu);
+    search_state *ss = bu->get_scratch();
+    int found = alt_search(bu, ss, &lm, bu->get_start(), bu->get_target());
+    if (found) {
+        trace_path(bu, ss, bu->get_target(), sol);
+    }
+    return found;
+}
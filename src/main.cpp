@@ -3,7 +3,16 @@
  * @details This file contains the main function and top level functions for the pathfinding problem given by Globus Medical.
  *          The code uses a modified implementation of A* algorithm for path finding where only vertical and horizontal steps 
  *          are taken into account. The program takes in the json file path and the diemsions of the world as inputs. 
- *          Usage: ./pathfinding <path_to_json> <h_max> <v_max>
+ *          Binary maps (see map_format.hpp) carry their own dimensions.
+ *          Usage: ./pathfinding <path_to_json> <h_max> <v_max> [--mode astar|bidir|jps|hpa|bfs|alt|hda|greedy]
+ *                               [--output text|json|binary|silent] [--render] [--stats] [--costs <cost_file>] [--threads N]
+ *                 ./pathfinding <path_to_bsm> [<h_max> <v_max>] [--mode ...] [--output ...] [--render] [--stats]
+ *                 ./pathfinding <map_file> [<h_max> <v_max>] --nearest <port_file>
+ *                 ./pathfinding convert <path_to_json> <h_max> <v_max> <path_to_bsm> [--packed|--chunked]
+ *                 ./pathfinding <path_to_chunked_bsm> [--batch <query_file>] [--chunk-cache MB] [--scratch MB]
+ *                 ./pathfinding <map_file> [<h_max> <v_max>] --serve <socket|-> [--mode ...] [--threads N]
+ *                 ./pathfinding client <socket>
+ *                 ./pathfinding loadgen <socket> <query_file> [--map NAME] [--connections C] [--requests N]
  * 
  * @author  Deepak E Kapure
  * @date    07-13-2025 
@@ -12,74 +21,715 @@
 #include "definitions.hpp"
 #include "read_map.hpp"
 #include "pathfinding.hpp"
+#include "batch.hpp"
+#include "fleet.hpp"
+#include "map_format.hpp"
+#include "bitbfs.hpp"
+#include "landmarks.hpp"
+#include "hda.hpp"
+#include "chunked_map.hpp"
+#include "output.hpp"
+#include "server.hpp"
+#include <chrono>
+#include <memory>
+#include <sstream>
 
+/**
+ * @brief Function to solve a file or stdin stream of start/target pairs against the
+ *        loaded map and print the results in input order
+ *
+ * @param bu pointer to the battleship holding the map
+ * @param query_file path to the query file, "-" for stdin
+ * @param threads number of worker threads, 0 for all cores
+ * @param mode search mode
+ * @param cluster HPA* cluster side
+ * @param cache_mb path cache budget in MB, 0 for no cache
+ * @param landmarks number of ALT landmarks
+ * @param ob writer for the results
+ * @param output output mode of the results
+ * @param times phase times of the load, the search and output phases are added; NULL for no stats
+ * @param mode_name search mode name for the stats
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_batch(battleship *bu, const string &query_file, int threads, _search_mode mode, int cluster,
+                     long cache_mb, int landmarks, out_buffer *ob, _output_mode output, _phase_times *times, const char *mode_name) {
+    vector<_query> queries;
+    int ok;
+    if (query_file == "-") {
+        ok = read_queries(cin, &queries);
+    } else {
+        ifstream in(query_file);
+        if (!in.is_open()) {
+            cerr << "Error: Could not open file " << query_file << endl;
+            return -1;
+        }
+        ok = read_queries(in, &queries);
+    }
+    if (!ok) {
+        return -1;
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    batch_engine engine(bu, threads, mode, cluster, (size_t)cache_mb << 20, landmarks);
+    if (times) {                                                // the HPA* graph and landmarks count as grid build
+        times->grid += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    }
+    if (engine.get_hierarchy()) {
+        cerr << "Built HPA* graph (" << cluster << "x" << cluster << " clusters, " << engine.get_hierarchy()->get_nodes()
+             << " nodes, " << engine.get_hierarchy()->get_edges() << " edges) in "
+             << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+    }
+    if (shared_ptr<const landmark_set> lm = engine.get_landmarks()) {
+        cerr << "Built " << lm->get_count() << " ALT landmarks (" << lm->get_bytes() / 1048576.0 << " MB, "
+             << bu->get_cells() * sizeof(uint16_t) / 1048576.0 << " MB per landmark) in "
+             << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+    }
+    vector<_query_result> results;
+    t0 = chrono::steady_clock::now();
+    engine.run(queries, &results);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    phase_clock clock;
+    long found = 0, points = 0, cost = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        write_path(ob, output, (long)i, results[i].found, results[i].path);
+        found += results[i].found;
+        points += (long)results[i].path.size();
+        cost += bu->has_costs() ? path_cost(bu, results[i].path) : 0;
+    }
+    ob->flush();
+    cerr << "Solved " << queries.size() << " queries in " << secs << " s on " << engine.get_threads()
+         << " threads (" << (secs > 0 ? queries.size() / secs : 0) << " queries/sec), "
+         << engine.get_expanded() << " nodes expanded" << endl;
+    if (bu->has_costs()) {
+        cerr << "Path cost: " << cost << " total over " << found << " paths" << endl;
+    }
+    _cache_stats cache = {};
+    if (engine.get_cache()) {
+        cache = engine.get_cache()->get_stats();
+        cerr << "Path cache: " << cache.hits << " hits, " << cache.sub_hits << " subpath hits, " << cache.misses
+             << " misses, " << cache.entries << " paths in " << (cache.bytes >> 10) << " KB" << endl;
+    }
+    if (times) {
+        times->search = secs * 1000.0;
+        times->output = clock.lap();
+        print_stats_json(cerr, mode_name, *times, (long)queries.size(), found, points, engine.get_expanded(),
+                         engine.get_counters(), engine.get_cache() ? &cache : NULL);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function to find the port nearest to the map start, ports read from a file
+ *        one "x y" per line, and print its index and the path to it
+ *
+ * @param bu pointer to the battleship holding the map
+ * @param port_file path to the port file, "-" for stdin
+ * @param ob writer for the result, NULL for silent output
+ * @param times phase times of the load, the search and output phases are added; NULL for no stats
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_nearest(battleship *bu, const string &port_file, out_buffer *ob, _phase_times *times) {
+    ifstream file;
+    if (port_file != "-") {
+        file.open(port_file);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open file " << port_file << endl;
+            return -1;
+        }
+    }
+    istream &in = (port_file == "-") ? cin : file;
+    vector<int> ports;
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        ++line_no;
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == string::npos) || (line[first] == '#')) {
+            continue;
+        }
+        istringstream fields(line);
+        int x, y;
+        if (!(fields >> x >> y) || (x < 0) || (x >= bu->get_x_max()) || (y < 0) || (y >= bu->get_y_max())) {
+            cerr << "Error: Bad port on line " << line_no << ": " << line << endl;
+            return -1;
+        }
+        ports.push_back(bu->index(x, y));
+    }
+
+    phase_clock clock;
+    bit_grid grid(bu);
+    bfs_state st;
+    if (times) {
+        times->grid += clock.lap();
+    }
+    int port = grid.nearest(&st, bu->get_start(), ports);
+    double search = clock.lap();
+    if (ob && (port < 0)) {
+        *ob << "No reachable port\n";
+    } else if (ob) {
+        *ob << port << ' ' << st.cells.size() << ':';
+        for (int cell : st.cells) {
+            *ob << " (" << bu->x_of(cell) << ',' << bu->y_of(cell) << ')';
+        }
+        *ob << '\n';
+    }
+    if (ob) {
+        ob->flush();
+    }
+    cerr << "Swept " << st.layers << " layers, " << st.reached << " cells over " << ports.size() << " ports in "
+         << search / 1000.0 << " s" << endl;
+    if (times) {
+        times->search = search;
+        times->output = clock.lap();
+        print_stats_json(cerr, "bfs", *times, 1, port >= 0, (long)st.cells.size(), st.reached, st.counters);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function to plan a fleet of ships read from a file, one "sx sy tx ty" per
+ *        ship, and print one timed path per ship
+ *
+ * @param bu pointer to the battleship holding the map
+ * @param fleet_file path to the fleet file, "-" for stdin
+ * @param window planning window in time steps
+ * @param max_steps time step limit
+ * @param ob writer for the paths, NULL for silent output
+ * @param times phase times of the load, the search and output phases are added; NULL for no stats
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_fleet(battleship *bu, const string &fleet_file, int window, int max_steps, out_buffer *ob,
+                     _phase_times *times) {
+    vector<_query> ships;
+    int ok;
+    if (fleet_file == "-") {
+        ok = read_queries(cin, &ships);
+    } else {
+        ifstream in(fleet_file);
+        if (!in.is_open()) {
+            cerr << "Error: Could not open file " << fleet_file << endl;
+            return -1;
+        }
+        ok = read_queries(in, &ships);
+    }
+    if (!ok) {
+        return -1;
+    }
+
+    fleet_planner planner(bu, window);
+    for (size_t i = 0; i < ships.size(); ++i) {
+        if (planner.add_ship(ships[i].start, ships[i].target) < 0) {
+            cerr << "Error: Ship " << i << " has an invalid or occupied position" << endl;
+            return -1;
+        }
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    int parked = planner.plan(max_steps);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    phase_clock clock;
+    long points = 0;
+    for (int i = 0; i < planner.get_ships(); ++i) {
+        const vector<_timed_point> &path = planner.get_path(i);
+        if (ob) {
+            *ob << i << ' ' << path.size() << ':';
+            for (auto &point : path) {
+                *ob << " (" << point.x << ',' << point.y << ',' << point.t << ')';
+            }
+            *ob << '\n';
+        }
+        points += (long)path.size();
+    }
+    if (ob) {
+        ob->flush();
+    }
+    cerr << "Planned " << planner.get_ships() << " ships in " << secs << " s, " << parked
+         << " reached their target, " << planner.get_replans() << " window plans, "
+         << planner.get_yields() << " made way" << endl;
+    if (times) {                                                // the planner keeps no search counters
+        times->search = secs * 1000.0;
+        times->output = clock.lap();
+        print_stats_json(cerr, "fleet", *times, planner.get_ships(), parked, points, 0, _search_counters());
+    }
+    return 0;
+}
+
+/**
+ * @brief Function to convert a Tiled JSON map into a binary map file
+ *
+ * @param argc number of arguments after "convert"
+ * @param argv arguments after "convert": <json_file> <x_max> <y_max> <out_file> [--packed|--chunked]
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_convert(int argc, char *argv[]) {
+    string flag = (argc == 5) ? argv[4] : "";
+    if ((argc < 4) || (argc > 5) || ((argc == 5) && (flag != "--packed") && (flag != "--chunked"))) {
+        cerr << "Usage: convert <json_file> <x_max> <y_max> <out_file> [--packed|--chunked]\n";
+        return -1;
+    }
+    _map_encoding encoding = (flag == "--packed") ? MAP_ENC_2BIT : (flag == "--chunked") ? MAP_ENC_CHUNKED : MAP_ENC_BYTE;
+    _field start = {}, target = {};
+    start.x_pos = target.x_pos = -1;
+    battleship bu(1, stoi(argv[1]), stoi(argv[2]), &start, &target);
+
+    auto t0 = chrono::steady_clock::now();
+    if (!read_map_stream(argv[0], &bu, &start, &target)) {
+        return -1;
+    }
+    int ok = (encoding == MAP_ENC_CHUNKED) ? write_map_chunked(argv[3], &bu, &start, &target)
+                                           : write_map_binary(argv[3], &bu, &start, &target, encoding);
+    if (!ok) {
+        return -1;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    cerr << "Converted " << argv[0] << " to " << argv[3] << " ("
+         << ((encoding == MAP_ENC_BYTE) ? "byte" : (encoding == MAP_ENC_2BIT) ? "2-bit" : "chunked 2-bit")
+         << " terrain) in " << secs << " s" << endl;
+    return 0;
+}
+
+/**
+ * @brief Function to route on a chunked map out of core: the start/target of the map
+ *        file, or every query of a query file one after the other, sharing one chunk
+ *        cache and one scratch. Results are printed like batch results.
+ *
+ * @param map_file path to the chunked map
+ * @param query_file path to the query file, "-" for stdin, empty for the map's start/target
+ * @param cache_mb chunk cache budget in MB
+ * @param scratch_mb search scratch budget in MB
+ * @param verify check the checksum of the map
+ * @param ob writer for the results
+ * @param output output mode of the results
+ * @param stats print phase times and chunk counters as JSON to stderr
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_chunked(const string &map_file, const string &query_file, long cache_mb, long scratch_mb, bool verify,
+                       out_buffer *ob, _output_mode output, bool stats) {
+    _phase_times times = {};
+    phase_clock clock;
+    chunked_map map;
+    if (!map.open(map_file, (size_t)cache_mb << 20, verify)) {
+        return -1;
+    }
+    times.read = clock.lap();
+
+    vector<_query> queries;
+    if (query_file.empty()) {
+        const _map_header *head = map.get_header();
+        if ((head->start_x < 0) || (head->target_x < 0)) {
+            cerr << "Error: Map has no start or no target" << endl;
+            return -1;
+        }
+        queries.push_back({{head->start_x, head->start_y}, {head->target_x, head->target_y}});
+    } else {
+        int ok;
+        if (query_file == "-") {
+            ok = read_queries(cin, &queries);
+        } else {
+            ifstream in(query_file);
+            if (!in.is_open()) {
+                cerr << "Error: Could not open file " << query_file << endl;
+                return -1;
+            }
+            ok = read_queries(in, &queries);
+        }
+        if (!ok) {
+            return -1;
+        }
+    }
+    times.parse = clock.lap();
+
+    chunk_scratch sc((size_t)scratch_mb << 20);
+    vector<_points> path;
+    long found = 0, points = 0, expanded = 0, aborted = 0;
+    double search_ms = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        int ret = chunked_search(&map, &sc, queries[i].start, queries[i].target, &path);
+        search_ms += clock.lap();
+        if (ret < 0) {
+            cerr << "Error: Query " << i << " ran out of search scratch (--scratch " << scratch_mb << ")" << endl;
+            ++aborted;
+        }
+        found += (ret > 0);
+        points += (long)path.size();
+        expanded += sc.expanded;
+        write_path(ob, output, (long)i, ret > 0, path);
+        times.output += clock.lap();
+    }
+    ob->flush();
+    times.output += clock.lap();
+    times.search = search_ms;
+
+    _chunk_stats cs = map.get_stats();
+    cs.scratch_chunks = sc.get_peak();
+    cs.scratch_bytes = (long)sc.get_bytes();
+    cerr << "Solved " << queries.size() << " queries in " << search_ms / 1000.0 << " s out of core, " << expanded
+         << " nodes expanded" << endl;
+    cerr << "Chunks: " << cs.hits << " hits, " << cs.misses << " misses, " << cs.evictions << " evictions, "
+         << cs.bytes_read / 1048576.0 << " MB read, " << cs.resident << " of " << (cs.budget >> 12) << " resident; scratch "
+         << cs.scratch_chunks << " chunks (" << (cs.scratch_bytes >> 20) << " MB)" << endl;
+    if (stats) {
+        print_stats_json(cerr, "astar", times, (long)queries.size(), found, points, expanded, _search_counters(), NULL,
+                         &cs);
+    }
+    return aborted ? -1 : 0;
+}
+
+/**
+ * @brief Function to run the load generator against a routing server
+ *
+ * @param argc number of arguments after "loadgen"
+ * @param argv arguments after "loadgen": <socket> <query_file> [--map NAME] [--connections C] [--requests N]
+ * @returns 0 if succeeded, -1 if failed
+ */
+static int run_loadgen(int argc, char *argv[]) {
+    string map_name = SERVER_MAP;
+    int connections = 1;
+    long requests = 0;
+    bool ok = (argc >= 2) && (argc % 2 == 0);
+    for (int i = 2; ok && (i + 1 < argc); i += 2) {
+        string opt = argv[i];
+        if (opt == "--map") {
+            map_name = argv[i + 1];
+        } else if (opt == "--connections") {
+            connections = stoi(argv[i + 1]);
+        } else if (opt == "--requests") {
+            requests = stol(argv[i + 1]);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        cerr << "Usage: loadgen <socket> <query_file|-> [--map NAME] [--connections C] [--requests N]\n";
+        return -1;
+    }
+    return run_load(argv[0], argv[1], map_name, connections, requests ? requests : 10000);
+}
 
 int main(int argc, char *argv[]) {
     
+    if ((argc > 1) && (string(argv[1]) == "convert")) {
+        return run_convert(argc - 2, argv + 2);
+    }
+    if ((argc > 1) && (string(argv[1]) == "client")) {
+        if (argc != 3) {
+            cerr << "Usage: client <socket>\n";
+            return -1;
+        }
+        return run_client(argv[2]);
+    }
+    if ((argc > 1) && (string(argv[1]) == "loadgen")) {
+        return run_loadgen(argc - 2, argv + 2);
+    }
+
     // Input parsing
-    if (argc != 4) {
-        cerr << "Usage: " << argv[0] << " <map_file> <x_max> <y_max>\n";
+    vector<string> args;                    // positional arguments
+    int x_max = 0, y_max = 0;
+    _search_mode mode = SEARCH_ASTAR;
+    string mode_name = "astar";
+    string batch_file;                      // query file for batch mode, empty for a single query
+    int threads = 0;                        // batch, server or HDA* worker threads, 0 for all cores
+    int cluster = HPA_CLUSTER;              // HPA* cluster side for batch mode
+    long cache_mb = 0;                      // path cache budget in MB for batch mode, 0 for no cache
+    int landmarks = ALT_LANDMARKS;          // ALT landmarks for batch mode
+    long chunk_cache_mb = CHUNK_CACHE_MB;   // chunk cache budget in MB for a chunked map
+    long scratch_mb = CHUNK_SCRATCH_MB;     // search scratch budget in MB for a chunked map
+    string fleet_file;                      // ship file for fleet planning
+    string port_file;                       // port file for a nearest port query
+    string serve_path;                      // server socket, "-" for stdin, empty for no server
+    string costs_file;                      // traversal cost table, empty for unit costs
+    int window = 16;                        // fleet planning window in time steps
+    int max_steps = 0;                      // fleet planning time step limit, 0 for 8 * (x_max + y_max)
+
+    bool verify = false;                    // check the checksum of a binary map
+    bool stats = false;                     // print phase times and search counters as JSON to stderr
+    _output_mode output = OUTPUT_TEXT;      // what the results look like on stdout
+    bool render = false;                    // draw the map and the path in text output
+
+    for (int i = 1; i < argc; ++i) {
+        string opt = argv[i];
+        if (opt.compare(0, 2, "--") != 0) {
+            args.push_back(opt);
+            continue;
+        }
+        if (opt == "--verify") {
+            verify = true;
+        } else if (opt == "--stats") {
+            stats = true;
+        } else if (opt == "--render") {
+            render = true;
+        } else if ((opt == "--output") && (i + 1 < argc)) {
+            if (!output_mode_of(argv[++i], &output)) {
+                cerr << "Unknown output mode: " << argv[i] << "\n";
+                return -1;
+            }
+        } else if ((opt == "--mode") && (i + 1 < argc)) {
+            string name = argv[++i];
+            mode_name = name;
+            if (name == "astar") {
+                mode = SEARCH_ASTAR;
+            } else if (name == "jps") {
+                mode = SEARCH_JPS;
+            } else if (name == "bidir") {
+                mode = SEARCH_BIDIR;
+            } else if (name == "hpa") {
+                mode = SEARCH_HPA;
+            } else if (name == "bfs") {
+                mode = SEARCH_BFS;
+            } else if (name == "alt") {
+                mode = SEARCH_ALT;
+            } else if (name == "hda") {
+                mode = SEARCH_HDA;
+            } else if (name == "greedy") {
+                mode = SEARCH_GREEDY;
+            } else {
+                cerr << "Unknown search mode: " << name << "\n";
+                return -1;
+            }
+        } else if ((opt == "--batch") && (i + 1 < argc)) {
+            batch_file = argv[++i];
+        } else if ((opt == "--cluster") && (i + 1 < argc)) {
+            cluster = stoi(argv[++i]);
+        } else if ((opt == "--cache") && (i + 1 < argc)) {
+            cache_mb = stol(argv[++i]);
+        } else if ((opt == "--landmarks") && (i + 1 < argc)) {
+            landmarks = stoi(argv[++i]);
+        } else if ((opt == "--chunk-cache") && (i + 1 < argc)) {
+            chunk_cache_mb = stol(argv[++i]);
+        } else if ((opt == "--scratch") && (i + 1 < argc)) {
+            scratch_mb = stol(argv[++i]);
+        } else if ((opt == "--threads") && (i + 1 < argc)) {
+            threads = stoi(argv[++i]);
+        } else if ((opt == "--fleet") && (i + 1 < argc)) {
+            fleet_file = argv[++i];
+        } else if ((opt == "--nearest") && (i + 1 < argc)) {
+            port_file = argv[++i];
+        } else if ((opt == "--serve") && (i + 1 < argc)) {
+            serve_path = argv[++i];
+        } else if ((opt == "--costs") && (i + 1 < argc)) {
+            costs_file = argv[++i];
+        } else if ((opt == "--window") && (i + 1 < argc)) {
+            window = stoi(argv[++i]);
+        } else if ((opt == "--max-steps") && (i + 1 < argc)) {
+            max_steps = stoi(argv[++i]);
+        } else {
+            cerr << "Unknown option: " << opt << "\n";
+            return -1;
+        }
+    }
+
+    bool binary = !args.empty() && is_binary_map(args[0]);
+    if (((args.size() != 3) && !(binary && (args.size() == 1))) || (args.size() > 3)) {
+        cerr << "Usage: " << argv[0] << " <map_file> <x_max> <y_max> [--mode astar|bidir|jps|hpa|bfs|alt|hda|greedy]"
+             << " [--output text|json|binary|silent] [--render] [--batch <query_file|->] [--threads N] [--cluster N] [--cache MB] [--landmarks K] [--costs <cost_file>]"
+             << " [--fleet <ship_file|->] [--window W] [--max-steps N] [--nearest <port_file|->] [--verify] [--stats]\n"
+             << "       " << argv[0] << " <map_file> <x_max> <y_max> --serve <socket|-> [--mode ...] [--threads N] [--cache MB]\n"
+             << "       " << argv[0] << " client <socket>\n"
+             << "       " << argv[0] << " loadgen <socket> <query_file|-> [--map NAME] [--connections C] [--requests N]\n"
+             << "       " << argv[0] << " <chunked_map> [--batch <query_file|->] [--chunk-cache MB] [--scratch MB] [--output ...] [--verify] [--stats]\n"
+             << "       " << argv[0] << " convert <json_file> <x_max> <y_max> <out_file> [--packed|--chunked]\n";
         return -1;
     }
+    string map_file = args[0];
+    if (args.size() == 3) {
+        x_max = stoi(args[1]);
+        y_max = stoi(args[2]);
+    }
+
+    _map_header head = {};
+    if (binary && read_map_header(map_file, &head) && (head.encoding == MAP_ENC_CHUNKED)) {
+        if ((mode != SEARCH_ASTAR) || render || !costs_file.empty() || !fleet_file.empty() || !port_file.empty() ||
+            !serve_path.empty()) {
+            cerr << "Chunked maps support astar single and batch routing only\n";
+            return -1;
+        }
+        if (x_max && ((x_max != head.x_max) || (y_max != head.y_max))) {
+            cerr << "Input size does not match map file data dimensions!" << endl;
+            return -1;
+        }
+        out_buffer ob(cout);
+        return run_chunked(map_file, batch_file, chunk_cache_mb, scratch_mb, verify, &ob, output, stats);
+    }
 
-    string map_file = argv[1];
-    int x_max = stoi(argv[2]);
-    int y_max = stoi(argv[3]);
+    vector<_cost_rule> cost_table;
+    if (!costs_file.empty()) {
+        if (((mode != SEARCH_ASTAR) && (mode != SEARCH_ALT) && (mode != SEARCH_HDA)) || !fleet_file.empty() ||
+            !port_file.empty()) {
+            cerr << "Traversal costs are supported by the astar, alt and hda search modes only\n";
+            return -1;
+        }
+        if (binary) {
+            cerr << "Traversal costs are read from the layers of a JSON map\n";
+            return -1;
+        }
+        if (!read_cost_table(costs_file, &cost_table)) {
+            return -1;
+        }
+    }
 
-    // Print input
-    cout << "Map file: " << map_file << "\n";
-    cout << "x_max: " << x_max << "\n";
-    cout << "y_max: " << y_max << "\n";
+    if (!serve_path.empty()) {              // the server loads and owns its maps
+        if ((mode == SEARCH_GREEDY) || (mode == SEARCH_HDA)) {
+            cerr << "The server supports the astar, bidir, jps, hpa, bfs and alt search modes only\n";
+            return -1;
+        }
+        _server_options opts = {threads, mode, cluster, (size_t)cache_mb << 20, landmarks, cost_table};
+        route_server server(opts);
+        string err;
+        auto t0 = chrono::steady_clock::now();
+        if (!server.load(SERVER_MAP, map_file, x_max, y_max, &err)) {
+            cerr << "Error: " << err << endl;
+            return -1;
+        }
+        cerr << "Loaded " << map_file << " as map " << SERVER_MAP << " in "
+             << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+        return (serve_path == "-") ? server.run_stdin() : server.run_socket(serve_path);
+    }
 
     // Shared data structures
-    Document doc;                           // JSON file object
-    const Value* buff = NULL;               // pointer to store world map points
-    _field bu_start, bu_target;             // pointers to store start and end, TO DO: declare to a vector for multiple ships
-
-    if(read_file(&doc, map_file)) {
-        cout << "File object created" << endl;
-        if(doc.HasMember("layers")) {                                  // check if file has "layers" field
-            const auto& layers = doc["layers"];
-            for (auto& layer : layers.GetArray()) {
-                if (string(layer["name"].GetString()) == "world") {    // go to "world" section
-                    buff = &layer["data"];                             // assign to buffer ptr
-                    break;
-                }
-            }
+    _field bu_start = {}, bu_target = {};   // pointers to store start and end, TO DO: declare to a vector for multiple ships
+    bu_start.x_pos = bu_target.x_pos = -1;
+
+    // Binary maps are mapped and searched in place, JSON maps are streamed into owned terrain
+    _phase_times times = {};
+    phase_clock clock;
+    mapped_map mapped;                      // declared first, it must outlive the battleship
+    unique_ptr<battleship> bu1;
+    if (binary) {
+        if (!mapped.open(map_file, verify)) {
+            return -1;
         }
+        times.read = clock.lap();
+        const _map_header *head = mapped.get_header();
+        if (x_max && ((x_max != head->x_max) || (y_max != head->y_max))) {
+            cerr << "Input size does not match map file data dimensions!" << endl;
+            return -1;
+        }
+        x_max = head->x_max;
+        y_max = head->y_max;
+        bu_start.x_pos = head->start_x;
+        bu_start.y_pos = head->start_y;
+        bu_target.x_pos = head->target_x;
+        bu_target.y_pos = head->target_y;
+        bu1 = make_unique<battleship>(1, x_max, y_max, &bu_start, &bu_target, mapped.get_terrain());
+    } else {
+        bu1 = make_unique<battleship>(1, x_max, y_max, &bu_start, &bu_target);
     }
+    times.grid = clock.lap();
 
-    print_map_and_mark(buff, &bu_start, &bu_target, y_max);
+    if (!batch_file.empty() && ((mode == SEARCH_GREEDY) || (mode == SEARCH_HDA))) {
+        cerr << "Batch mode supports the astar, bidir, jps, hpa, bfs and alt search modes only\n";
+        return -1;
+    }
+    if ((output > OUTPUT_SILENT) && (!fleet_file.empty() || !port_file.empty())) {
+        cerr << "Fleet and nearest port runs support the text and silent output modes only\n";
+        return -1;
+    }
+    if (render && (output != OUTPUT_TEXT)) {
+        cerr << "--render needs the text output mode\n";
+        return -1;
+    }
+    bool quiet = !batch_file.empty() || !fleet_file.empty() || !port_file.empty();  // these results own stdout
+    out_buffer ob(cout);                    // everything for stdout goes through here
+    out_buffer *results = (output == OUTPUT_SILENT) ? NULL : &ob;
 
-    // Battelship objects
-    battleship bu1(1, x_max, y_max, &bu_start, &bu_target);
+    // Print input
+    if (!quiet && (output == OUTPUT_TEXT)) {
+        ob << "Map file: " << map_file << '\n';
+        ob << "x_max: " << x_max << '\n';
+        ob << "y_max: " << y_max << '\n';
+    }
+    times.output = clock.lap();
 
-    if(buff) {
-        if(buff->Size() != (SizeType)(x_max * y_max)) {
-            cerr << "Input size does not match map file data dimensions!" << endl;
+    if (!binary && !read_map_stream(map_file, bu1.get(), &bu_start, &bu_target, &times)) {
+        return -1;
+    }
+    clock.lap();                            // read and parse are split by read_map_stream()
+    if (!cost_table.empty() && !read_cost_layers(map_file, bu1.get(), cost_table)) {
+        return -1;
+    }
+    times.parse += clock.lap();
+    bu1->build_components();                // queries across components fail without a search
+    bu1->build_border();                    // sentinel frame for the search kernels
+    times.grid += clock.lap();
+    if (!batch_file.empty()) {
+        return run_batch(bu1.get(), batch_file, threads, mode, cluster, cache_mb, landmarks, &ob, output,
+                         stats ? &times : NULL, mode_name.c_str());
+    }
+    if (!fleet_file.empty()) {
+        return run_fleet(bu1.get(), fleet_file, window, max_steps ? max_steps : 8 * (x_max + y_max), results,
+                         stats ? &times : NULL);
+    }
+
+    if (!port_file.empty()) {
+        if (bu_start.x_pos < 0) {
+            cerr << "Error: Map has no start" << endl;
             return -1;
         }
-        // Insert to array
-        vector<_points *> solution_list;
-        bu1.insert_nodes(buff);
-        cout << "Running path finding.." << endl;
-        if(find_path(&bu1, &solution_list)) {
-            cout << "Found a path! Points are: " << endl;
-            for(auto point: solution_list) {
-                cout << "(" << point->x << "," << point->y << "), " ;
+        return run_nearest(bu1.get(), port_file, results, stats ? &times : NULL);
+    }
+
+    if (output == OUTPUT_TEXT) {
+        ob << "Map loaded\n";
+    }
+    if ((bu_start.x_pos < 0) || (bu_target.x_pos < 0)) {
+        ob.flush();
+        cerr << "Error: Map has no start or no target" << endl;
+        return -1;
+    }
+
+    // Search first; the map is rendered and the results printed once it is done
+    vector<_points *> solution_list;
+    int found = (mode == SEARCH_HDA) ? find_path_hda(bu1.get(), &solution_list, threads)
+                                     : find_path(bu1.get(), &solution_list, mode);
+    times.search = clock.lap();
+    if (output == OUTPUT_TEXT) {
+        if (render) {
+            render_map(&ob, bu1.get());
+        }
+        ob << "Start at (" << bu_start.x_pos << ',' << bu_start.y_pos << ")\n";
+        ob << "Target at (" << bu_target.x_pos << ',' << bu_target.y_pos << ")\n";
+        ob << "Running path finding..\n";
+        if (found) {
+            ob << "Found a path! Points are: \n";
+            for (auto point : solution_list) {
+                ob << '(' << point->x << ',' << point->y << "), ";
+            }
+            ob << '\n';
+            if (bu1->has_costs()) {
+                vector<_points> path;
+                for (auto point : solution_list) {
+                    path.push_back(*point);
+                }
+                ob << "Path cost: " << path_cost(bu1.get(), path) << '\n';
+            }
+            if (render) {
+                render_path(&ob, bu1.get());
             }
-            cout << endl;
-            bu1.print_path();
         } else {
-            cout << "No valid path found!" << endl;
+            ob << "No valid path found!\n";
         }
-        
-        // clear solution list
-        for(auto point: solution_list) {
-            delete point;
+    } else {
+        vector<_points> path(solution_list.size());
+        for (size_t i = 0; i < solution_list.size(); ++i) {
+            path[i] = *solution_list[i];
         }
-        solution_list.clear();
+        write_path(&ob, output, 0, found, path);
+    }
+    ob.flush();
+    times.output += clock.lap();
+    if (stats) {
+        search_state *ss = bu1->get_scratch();
+        print_stats_json(cerr, mode_name.c_str(), times, 1, found, (long)solution_list.size(), ss->expanded,
+                         ss->counters);
+    }
+    
+    // clear solution list
+    for(auto point: solution_list) {
+        delete point;
     }
+    solution_list.clear();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+/**
+ * @brief   Binary map file
+ * @details This file contains the versioned binary map format: a 64 byte header followed by
+ *          the terrain, one byte or 2 bits per cell. Byte encoded maps are memory mapped and
+ *          searched in place, with no parse and no copy.
+ *
+ */
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "map_format.hpp"
+
+/**
+ * @brief 2-bit codes of the terrain classes
+ *
+ */
+static const int8_t code_to_terrain[4] = {GROUND_TERRAIN, ELEVATED_TERRAIN, BU_START, BU_TARGET};
+
+/**
+ * @brief Function to compute the FNV-1a 64 bit checksum of a buffer
+ * @param data pointer to the buffer
+ * @param len length of the buffer
+ * @param h checksum of the data before the buffer, to checksum a file piece by piece
+ * @returns checksum
+ */
+uint64_t map_checksum(const uint8_t *data, size_t len, uint64_t h) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Function to check if a file starts with the binary map magic
+ * @param f_name string containing map file path
+ * @returns 1 if the file is a binary map, 0 otherwise
+ */
+int is_binary_map(string f_name) {
+    char magic[4] = {0};
+    FILE *fp = fopen(f_name.c_str(), "rb");
+    if (!fp) {
+        return 0;
+    }
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return (n == sizeof(magic)) && (memcmp(magic, MAP_FORMAT_MAGIC, sizeof(magic)) == 0);
+}
+
+/**
+ * @brief Function to check the start and target of a binary map header
+ * @param head pointer to the header
+ * @returns 1 if each position is -1/-1 or inside the map, 0 otherwise
+ */
+int map_endpoints_valid(const _map_header *head) {
+    auto valid = [head](int32_t x, int32_t y) {
+        return ((x == -1) && (y == -1)) || ((x >= 0) && (x < head->x_max) && (y >= 0) && (y < head->y_max));
+    };
+    return valid(head->start_x, head->start_y) && valid(head->target_x, head->target_y);
+}
+
+/**
+ * @brief Function to read the header of a binary map file without mapping the terrain
+ * @param f_name string containing map file path
+ * @param head pointer to the header to fill
+ * @returns 1 if succeeded, 0 if the file has no binary map header
+ */
+int read_map_header(string f_name, _map_header *head) {
+    FILE *fp = fopen(f_name.c_str(), "rb");
+    if (!fp) {
+        return 0;
+    }
+    size_t n = fread(head, sizeof(*head), 1, fp);
+    fclose(fp);
+    return (n == 1) && (memcmp(head->magic, MAP_FORMAT_MAGIC, sizeof(head->magic)) == 0);
+}
+
+/**
+ * @brief Function to write the map of a battleship as a binary map file
+ * @param f_name string containing output file path
+ * @param bu pointer to the battleship holding the map
+ * @param start pointer to start position, x_pos -1 if none
+ * @param target pointer to target position, x_pos -1 if none
+ * @param encoding terrain encoding to write
+ * @returns 1 if succeeded, 0 if failed
+ */
+int write_map_binary(string f_name, battleship *bu, _field *start, _field *target, _map_encoding encoding) {
+    const int8_t *terrain = bu->get_terrain_data();
+    size_t cells = (size_t)bu->get_cells();
+    vector<uint8_t> packed;
+    const uint8_t *data = (const uint8_t *)terrain;
+    size_t data_size = cells;
+
+    if (encoding == MAP_ENC_2BIT) {                             // 4 cells per byte, lowest bits first
+        packed.assign((cells + 3) / 4, 0);
+        for (size_t i = 0; i < cells; ++i) {
+            int8_t dot = terrain[i];
+            uint8_t code = (dot == ELEVATED_TERRAIN) ? 1 : (dot == BU_START) ? 2 : (dot == BU_TARGET) ? 3 : 0;
+            packed[i / 4] |= (uint8_t)(code << ((i % 4) * 2));
+        }
+        data = packed.data();
+        data_size = packed.size();
+    }
+
+    _map_header head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, MAP_FORMAT_MAGIC, sizeof(head.magic));
+    head.version = MAP_FORMAT_VERSION;
+    head.x_max = bu->get_x_max();
+    head.y_max = bu->get_y_max();
+    head.start_x = start->x_pos;
+    head.start_y = (start->x_pos < 0) ? -1 : start->y_pos;
+    head.target_x = target->x_pos;
+    head.target_y = (target->x_pos < 0) ? -1 : target->y_pos;
+    head.encoding = encoding;
+    head.header_size = sizeof(head);
+    head.data_size = data_size;
+    head.checksum = map_checksum(data, data_size);
+
+    FILE *fp = fopen(f_name.c_str(), "wb");
+    if (!fp) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    int ret = (fwrite(&head, sizeof(head), 1, fp) == 1) && (fwrite(data, 1, data_size, fp) == data_size);
+    ret = (fclose(fp) == 0) && ret;
+    if (!ret) {
+        cerr << "Error: Could not write file " << f_name << endl;
+    }
+    return ret;
+}
+
+/**
+ * @brief Destructor for class, unmaps the file
+ *
+ */
+mapped_map::~mapped_map() {
+    if (base) {
+        munmap(base, length);
+    }
+}
+
+/**
+ * @brief Method to map a binary map file
+ * @param f_name string containing map file path
+ * @param verify 1 to check the terrain checksum
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int mapped_map::open(string f_name, int verify) {
+    int fd = ::open(f_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(_map_header))) {
+        cerr << "Error: " << f_name << " is too short for a binary map" << endl;
+        ::close(fd);
+        return 0;
+    }
+    length = (size_t)st.st_size;
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = NULL;
+        cerr << "Error: Could not map file " << f_name << endl;
+        return 0;
+    }
+
+    memcpy(&head, base, sizeof(head));
+    if (head.encoding == MAP_ENC_CHUNKED) {
+        cerr << "Error: " << f_name << " is a chunked map, it is only searched out of core" << endl;
+        return 0;
+    }
+    size_t cells = (size_t)head.x_max * (size_t)head.y_max;
+    size_t want = (head.encoding == MAP_ENC_2BIT) ? (cells + 3) / 4 : cells;
+    if ((memcmp(head.magic, MAP_FORMAT_MAGIC, sizeof(head.magic)) != 0) || (head.version != MAP_FORMAT_VERSION) ||
+        (head.x_max <= 0) || (head.y_max <= 0) || (head.header_size < sizeof(head)) ||
+        ((head.encoding != MAP_ENC_BYTE) && (head.encoding != MAP_ENC_2BIT)) ||
+        (head.data_size != want) || (head.header_size + head.data_size > length) || !map_endpoints_valid(&head)) {
+        cerr << "Error: " << f_name << " is not a valid version " << MAP_FORMAT_VERSION << " binary map" << endl;
+        return 0;
+    }
+
+    uint8_t *data = (uint8_t *)base + head.header_size;
+    if (verify && (map_checksum(data, head.data_size) != head.checksum)) {
+        cerr << "Error: Checksum mismatch in " << f_name << endl;
+        return 0;
+    }
+
+    if (head.encoding == MAP_ENC_2BIT) {
+        unpacked.resize(cells);
+        for (size_t i = 0; i < cells; ++i) {
+            unpacked[i] = code_to_terrain[(data[i / 4] >> ((i % 4) * 2)) & 3];
+        }
+        terrain = unpacked.data();
+    } else {
+        madvise(base, length, MADV_WILLNEED);
+        terrain = (int8_t *)data;
+    }
+    return 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * @brief   Output file
+ * @details This file contains the output modes of a run: compact path records as JSON or
+ *          binary with the path run-length encoded as direction runs, and the buffered
+ *          rendering of the map and the path.
+ *
+ */
+#include "output.hpp"
+
+/**
+ * @brief Function to look up an output mode by name
+ * @param name "text", "silent", "json" or "binary"
+ * @param mode pointer receiving the mode
+ * @returns 1 if the name is known, 0 otherwise
+ */
+int output_mode_of(const string &name, _output_mode *mode) {
+    if (name == "text") {
+        *mode = OUTPUT_TEXT;
+    } else if (name == "silent") {
+        *mode = OUTPUT_SILENT;
+    } else if (name == "json") {
+        *mode = OUTPUT_JSON;
+    } else if (name == "binary") {
+        *mode = OUTPUT_BINARY;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Function to encode a path as runs of steps in one direction
+ * @param path path points, start first, each a step from the one before
+ * @param runs pointer to vector receiving the runs
+ * @returns number of runs
+ */
+int encode_runs(const vector<_points> &path, vector<_dir_run> *runs) {
+    runs->clear();
+    for (size_t i = 1; i < path.size(); ++i) {
+        _path_dir dir;
+        if (path[i].x < path[i - 1].x) {
+            dir = DIR_UP;
+        } else if (path[i].x > path[i - 1].x) {
+            dir = DIR_DOWN;
+        } else if (path[i].y < path[i - 1].y) {
+            dir = DIR_LEFT;
+        } else {
+            dir = DIR_RIGHT;
+        }
+        if (!runs->empty() && (runs->back().dir == dir)) {
+            ++runs->back().steps;
+        } else {
+            runs->push_back({dir, 1});
+        }
+    }
+    return (int)runs->size();
+}
+
+/**
+ * @brief Function to write one path in a compact output mode.
+ *        OUTPUT_TEXT:   <query> <points>: (x,y) (x,y) ...
+ *        OUTPUT_JSON:   {"query": 0, "found": 1, "points": 5, "start": [2,2], "runs": "D2R2"}
+ *        OUTPUT_BINARY: a _path_record and its run bytes
+ *        OUTPUT_SILENT writes nothing.
+ * @param ob writer
+ * @param mode output mode
+ * @param query query number, 0 for a single run
+ * @param found 1 if a valid path is found, 0 if no path
+ * @param path path points, start first
+ */
+void write_path(out_buffer *ob, _output_mode mode, long query, int found, const vector<_points> &path) {
+    static const char dir_names[] = "UDLR";
+    if (mode == OUTPUT_SILENT) {
+        return;
+    }
+    if (mode == OUTPUT_TEXT) {
+        *ob << query << ' ' << path.size() << ':';
+        for (auto &point : path) {
+            *ob << " (" << point.x << ',' << point.y << ')';
+        }
+        *ob << '\n';
+        return;
+    }
+
+    vector<_dir_run> runs;
+    encode_runs(path, &runs);
+    if (mode == OUTPUT_JSON) {
+        *ob << "{\"query\": " << query << ", \"found\": " << found << ", \"points\": " << path.size();
+        if (!path.empty()) {
+            *ob << ", \"start\": [" << path[0].x << ',' << path[0].y << "], \"runs\": \"";
+            for (auto &run : runs) {
+                *ob << dir_names[run.dir] << run.steps;
+            }
+            *ob << '"';
+        }
+        *ob << "}\n";
+        return;
+    }
+
+    // binary: count the run bytes first, the header carries their number
+    uint32_t bytes = 0;
+    for (auto &run : runs) {
+        bytes += (run.steps + PATH_RUN_MAX - 1) / PATH_RUN_MAX;
+    }
+    _path_record rec = {};
+    memcpy(rec.magic, PATH_FORMAT_MAGIC, 4);
+    rec.query = (int32_t)query;
+    rec.found = found;
+    rec.start_x = path.empty() ? -1 : path[0].x;
+    rec.start_y = path.empty() ? -1 : path[0].y;
+    rec.points = (uint32_t)path.size();
+    rec.runs = bytes;
+    ob->write((const char *)&rec, sizeof(rec));
+    for (auto &run : runs) {
+        for (int left = run.steps; left > 0; left -= PATH_RUN_MAX) {
+            int steps = (left < PATH_RUN_MAX) ? left : PATH_RUN_MAX;
+            ob->put((char)((run.dir << 6) | (steps - 1)));
+        }
+    }
+}
+
+/**
+ * @brief Function to render the rows of the map, a row at a time
+ *
+ * @param ob writer
+ * @param bu pointer to the battleship holding the map
+ * @param marked search state whose marked cells are drawn '@', NULL for none
+ */
+static void render_rows(out_buffer *ob, battleship *bu, const search_state *marked) {
+    int y_max = bu->get_y_max();
+    string line(2 * y_max + 1, ' ');
+    line[2 * y_max] = '\n';
+    for (int x = 0; x < bu->get_x_max(); ++x) {
+        for (int y = 0; y < y_max; ++y) {
+            int idx = bu->index(x, y);
+            _f_type dot = bu->get_terrain(idx);
+            char c;
+            if (dot == GROUND_TERRAIN) {
+                c = (marked && marked->is_marked(idx)) ? '@' : '-';
+            } else if (dot == ELEVATED_TERRAIN) {
+                c = '8';
+            } else if (dot >= BU_START) {
+                c = '@';
+            } else {
+                c = '*';
+            }
+            line[2 * y] = c;
+        }
+        ob->write(line.data(), line.size());
+    }
+}
+
+/**
+ * @brief Function to render the loaded map, one character per cell: '-' ground,
+ *        '8' elevated, '@' start and '*' target
+ *
+ * @param ob writer
+ * @param bu pointer to the battleship holding the map
+ */
+void render_map(out_buffer *ob, battleship *bu) {
+    *ob << "Reading map..\n";
+    render_rows(ob, bu, NULL);
+}
+
+/**
+ * @brief Function to render the map with the path of the last search marked '@'
+ *
+ * @param ob writer
+ * @param bu pointer to the battleship holding the map and the marked path
+ */
+void render_path(out_buffer *ob, battleship *bu) {
+    *ob << "Printing path..\n";
+    render_rows(ob, bu, bu->get_scratch());
+}
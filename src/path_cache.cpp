@@ -0,0 +1,157 @@
+/**
+ * @brief   Path cache file
+ * @details This file contains the LRU cache of solved paths: exact lookups by map hash and
+ *          endpoints, subpath lookups through the per-cell index of optimal paths, and the
+ *          eviction that keeps the cache in its memory budget.
+ *
+ */
+#include "path_cache.hpp"
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param budget memory budget in bytes
+ * @param optimal the cached paths are shortest paths, enables subpath reuse
+ *
+ */
+path_cache::path_cache(size_t budget, bool optimal) : subpaths(optimal), stats() {
+    stats.budget = (long)budget;
+}
+
+/**
+ * @brief Method to look up a path and mark it most recently used
+ * @param map map hash of the query
+ * @param start start cell index
+ * @param target target cell index
+ * @param cells pointer to vector receiving the path, start first
+ * @returns 1 for a cached path, 2 for a piece of a cached path, 0 on a miss
+ *
+ */
+int path_cache::lookup(uint64_t map, int start, int target, vector<int> *cells) {
+    lock_guard<mutex> guard(lock);
+    ++stats.lookups;
+    auto it = keys.find(key_of(map, start, target));
+    if (it != keys.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        *cells = it->second->cells;
+        ++stats.hits;
+        return 1;
+    }
+    if (subpaths) {
+        auto from = on_path.equal_range(start);
+        auto to = (from.first != from.second) ? on_path.equal_range(target) : from;
+        for (auto a = from.first; a != from.second; ++a) {
+            if (a->second.entry->map != map) {
+                continue;
+            }
+            for (auto b = to.first; b != to.second; ++b) {
+                if (b->second.entry != a->second.entry) {
+                    continue;
+                }
+                const vector<int> &path = a->second.entry->cells;
+                int i = a->second.pos, j = b->second.pos;
+                if (i <= j) {
+                    cells->assign(path.begin() + i, path.begin() + j + 1);
+                } else {
+                    cells->assign(path.rbegin() + (path.size() - 1 - i), path.rbegin() + (path.size() - j));
+                }
+                lru.splice(lru.begin(), lru, a->second.entry);
+                ++stats.sub_hits;
+                return 2;
+            }
+        }
+    }
+    ++stats.misses;
+    return 0;
+}
+
+/**
+ * @brief Method to drop the least recently used path and its cell index entries
+ *
+ */
+void path_cache::evict(void) {
+    _entry_ref victim = prev(lru.end());
+    if (subpaths) {
+        for (int cell : victim->cells) {
+            auto range = on_path.equal_range(cell);
+            for (auto r = range.first; r != range.second; ++r) {
+                if (r->second.entry == victim) {
+                    on_path.erase(r);
+                    break;
+                }
+            }
+        }
+    }
+    keys.erase(key_of(victim->map, victim->start, victim->target));
+    stats.bytes -= (long)victim->bytes;
+    --stats.entries;
+    ++stats.evictions;
+    lru.erase(victim);
+}
+
+/**
+ * @brief Method to add a found path, dropping the least recently used paths
+ *        while the budget is exceeded. Paths larger than the budget are not kept.
+ * @param map map hash the path was found on
+ * @param start start cell index
+ * @param target target cell index
+ * @param cells path, start first
+ *
+ */
+void path_cache::insert(uint64_t map, int start, int target, const vector<int> &cells) {
+    size_t bytes = CACHE_ENTRY_BYTES + cells.size() * (subpaths ? CACHE_CELL_BYTES : sizeof(int));
+    lock_guard<mutex> guard(lock);
+    if ((bytes > (size_t)stats.budget) || keys.count(key_of(map, start, target))) {
+        return;                                                 // too big, or another thread got there first
+    }
+    lru.push_front({map, start, target, cells, bytes});
+    keys[key_of(map, start, target)] = lru.begin();
+    if (subpaths) {
+        for (int i = 0; i < (int)cells.size(); ++i) {
+            on_path.insert({cells[i], {lru.begin(), i}});
+        }
+    }
+    stats.bytes += (long)bytes;
+    ++stats.entries;
+    ++stats.inserts;
+    while (stats.bytes > stats.budget) {
+        evict();
+    }
+}
+
+/**
+ * @brief Method to add the time of one query to the hit or miss latency
+ * @param hit the query was answered from the cache
+ * @param us query time in microseconds
+ *
+ */
+void path_cache::record(bool hit, double us) {
+    lock_guard<mutex> guard(lock);
+    if (hit) {
+        stats.hit_us += us;
+    } else {
+        stats.miss_us += us;
+    }
+}
+
+/**
+ * @brief Method to drop every path
+ *
+ */
+void path_cache::clear(void) {
+    lock_guard<mutex> guard(lock);
+    on_path.clear();
+    keys.clear();
+    lru.clear();
+    stats.bytes = 0;
+    stats.entries = 0;
+}
+
+/**
+ * @brief Method to read the counters
+ *
+ */
+_cache_stats path_cache::get_stats(void) {
+    lock_guard<mutex> guard(lock);
+    return stats;
+}
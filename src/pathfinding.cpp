@@ -10,6 +10,11 @@
  */
 #include "pathfinding.hpp"
 #include "definitions.hpp"
+#include "hpa.hpp"
+#include "bitbfs.hpp"
+#include "landmarks.hpp"
+#include "hda.hpp"
+#include "kernels.hpp"
 #include <stack>
 
 /**
@@ -26,18 +31,20 @@ enum STATES {
  * @brief Function to check the nature of the new neighbour node
  *        The State machine cycles through 3 states to determine
  *        if the new node should be replaced by the current node
- * @param c Address of current node pointer
- * @param n Address of next node pointer 
+ * @param bu pointer the the battleship class
+ * @param c Address of current cell index
+ * @param n Address of next cell index
  * 
  */
-void update_state_machine(_field **c, _field **n) {
+void update_state_machine(battleship *bu, int *c, int *n) {
     if(c && n) {
-        _field *curr = *c;
-        _field *node = *n;
+        search_state *ss = bu->get_scratch();
+        int curr = *c;
+        int node = *n;
         int state = NEW_NODE;
         
         if(state == NEW_NODE) {
-            if((node->visited==NOT_VISITED) && (curr->visited > NOT_VISITED)) {      // new node is not visited
+            if((ss->get_visited(node)==NOT_VISITED) && (ss->get_visited(curr) > NOT_VISITED)) {      // new node is not visited
                 *c = node;
                 return;
             } else {
@@ -45,8 +52,8 @@ void update_state_machine(_field **c, _field **n) {
             }
         }
         if(state == CHECK_T_COST) {                                                 
-            int curr_cost = curr->cost_from_src + curr->cost_to_dest;
-            int node_cost = node->cost_from_src + node->cost_to_dest;
+            int curr_cost = bu->cost_from_src(curr) + bu->cost_to_dest(curr);
+            int node_cost = bu->cost_from_src(node) + bu->cost_to_dest(node);
             if(node_cost < curr_cost) {                                              // new node has lower total cost 
                 *c = node;
                 return;
@@ -55,7 +62,7 @@ void update_state_machine(_field **c, _field **n) {
             }
         }
         if(state == CHECK_D_COST) {                                                 // new node had lower destination cost
-            if(node->cost_to_dest < curr->cost_to_dest) {
+            if(bu->cost_to_dest(node) < bu->cost_to_dest(curr)) {
                 *c = node;
             } 
             // else no change to curr
@@ -64,60 +71,74 @@ void update_state_machine(_field **c, _field **n) {
 }
 
 /**
- * @brief Function to find the vaild path from start to target
- *        It uses A* method on the precalculated costs for each nodes
- *        and uses the state machine to iterate through the probable 
- *        path
+ * @brief Function to find a path with the original greedy depth first walk.
+ *        It uses the precalculated costs for each nodes and the state machine
+ *        to iterate through the probable path. The path is not optimal.
  * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points
  * @return return 1 if a valid path is found. 0 if no path
  * 
  */
-int find_path(battleship *bu, vector<_points*> *sol) {
+int find_path_greedy(battleship *bu, vector<_points*> *sol) {
     int ret = 0;
-    vector<_field*> neighbours;
-    stack<_field*> backtrack;
-    _field *start = bu->get_start();
-    _field *target = bu->get_target();
-
-    _field *curr_node = start;                                  // start with current node 
-    curr_node->visited = bu->get_bu_num();
-    curr_node->marked_path = true;
+    vector<int> neighbours;
+    stack<int> backtrack;
+    search_state *ss = bu->get_scratch();
+    int start = bu->get_start();
+    int target = bu->get_target();
+
+    bu->reset_search();                                         // fresh search state for this run
+    if (!bu->connected(start, target)) {                        // the walk would exhaust the start's component
+        return ret;
+    }
+    int curr_node = start;                                      // start with current node 
+    ss->touch(curr_node);
+    ss->visited[curr_node] = bu->get_bu_num();
+    ss->marked_path[curr_node] = 1;
     backtrack.push(curr_node);                                  // push it to back tracking stack
 
+    STAT_ADD(ss, pushes, 1);
     while (!backtrack.empty()) {                                // iterate over the stack 
+        STAT_PEAK(ss, peak_open, backtrack.size());
         curr_node = backtrack.top();                            
         if (curr_node == target) {                              // target is reached, exit
             ret = 1;
             break;
         }
+        ++ss->expanded;
         neighbours.clear();
         bu->get_valid_neighbours(&neighbours, curr_node);       // get neighbourhood nodes
+        STAT_ADD(ss, generated, neighbours.size());
 
-        _field *next_node = NULL;
-        for (_field *ptr : neighbours) {
-            if (ptr->visited == NOT_VISITED) {                  // look for new nodes
-                if(!next_node) {                                // read one entry from valid neighbours to start comparisons
+        int next_node = -1;
+        for (int ptr : neighbours) {
+            if (ss->get_visited(ptr) == NOT_VISITED) {          // look for new nodes
+                if(next_node < 0) {                             // read one entry from valid neighbours to start comparisons
                     next_node = ptr;
                 } else { 
-                    update_state_machine(&next_node, &ptr);     // look for valid neighbouring nodes
+                    update_state_machine(bu, &next_node, &ptr); // look for valid neighbouring nodes
                 }
             }
         }
 
-        if(next_node) {                                         // found a new node, mark it
-            next_node->visited = bu->get_bu_num();
-            next_node->marked_path = true;
+        if(next_node >= 0) {                                    // found a new node, mark it
+            ss->touch(next_node);
+            ss->visited[next_node] = bu->get_bu_num();
+            ss->marked_path[next_node] = 1;
             backtrack.push(next_node);
+            STAT_ADD(ss, pushes, 1);
 
             // Save path point
             _points *p = new _points;
-            p->x = next_node->x_pos; 
-            p->y = next_node->y_pos;
+            p->x = bu->x_of(next_node); 
+            p->y = bu->y_of(next_node);
             sol->push_back(p);
         } else {                                                // no new valid node, backtrack
-            curr_node->marked_path = false;
-            curr_node->visited = DEAD_END;
+            ss->marked_path[curr_node] = 0;
+            ss->visited[curr_node] = DEAD_END;
             backtrack.pop();
+            STAT_ADD(ss, pops, 1);
+            STAT_ADD(ss, backtracks, 1);
 
             // Remove last added point from solution
             if (!sol->empty()) {
@@ -128,11 +149,12 @@ int find_path(battleship *bu, vector<_points*> *sol) {
     }
 
     if (ret) {
-        target->marked_path = true;                             // mark target for solution entry
+        ss->touch(target);
+        ss->marked_path[target] = 1;                            // mark target for solution entry
 
         _points *start_p = new _points;                         // put start in solution list
-        start_p->x = start->x_pos;
-        start_p->y = start->y_pos;
+        start_p->x = bu->x_of(start);
+        start_p->y = bu->y_of(start);
         sol->insert(sol->begin(), start_p);
     }
 
@@ -140,3 +162,325 @@ int find_path(battleship *bu, vector<_points*> *sol) {
 
 }
 
+/**
+ * @brief Function to run the A* loop between two cells with a given heuristic and
+ *        step cost. The open list is a bucket queue on f = g + h, expanded cells are
+ *        closed and parent links are left in the search state for trace_path(). The
+ *        heuristic must be consistent, the bucket queue only moves forward. With
+ *        small integer step costs the bucket queue is Dial's algorithm: f grows by
+ *        at most the largest step, so the ring stays a few buckets wide and push
+ *        and pop stay O(1).
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @param h callable returning the lower bound from a cell to the target
+ * @param step callable returning the cost of entering a cell
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+template <typename HEURISTIC, typename STEP>
+static int best_first(battleship *bu, search_state *ss, int start, int target, HEURISTIC h, STEP step) {
+    bucket_queue *open = &ss->open_list;
+    int nb[4];
+
+    ss->reset();
+    if (!bu->connected(start, target)) {                        // different components, nothing to search
+        return 0;
+    }
+
+    ss->touch(start);
+    ss->g_cost[start] = 0;
+    open->push(h(start), start);
+
+    STAT_ADD(ss, pushes, 1);
+    while (!open->empty()) {
+        STAT_PEAK(ss, peak_open, open->size());
+        int node = open->pop();
+        STAT_ADD(ss, pops, 1);
+        if (ss->visited[node] == CLOSED) {                      // stale duplicate entry
+            STAT_ADD(ss, stale, 1);
+            continue;
+        }
+        ss->visited[node] = CLOSED;
+        ++ss->expanded;
+        if (node == target) {
+            return 1;
+        }
+
+        int g_node = ss->g_cost[node];
+        int n = bu->get_passable_neighbours(node, nb);
+        STAT_ADD(ss, generated, n);
+        for (int i = 0; i < n; ++i) {
+            int next = nb[i];
+            int g = g_node + step(next);
+            ss->touch(next);
+            if ((ss->visited[next] != CLOSED) && (g < ss->g_cost[next])) {
+                ss->g_cost[next] = g;
+                ss->parent[next] = node;
+                open->push(g + h(next), next);
+                STAT_ADD(ss, pushes, 1);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function to pick the unit cost kernel for the map: the stack kernel of the
+ *        smallest size class that holds it, grid_astar() on the sentinel border
+ *        otherwise. Search counters are only kept by grid_astar().
+ * @param bu pointer the the battleship class, build_border() called
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @param h heuristic taking (cell index, row, column)
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+template <typename HEURISTIC>
+static int run_kernel(battleship *bu, search_state *ss, int start, int target, HEURISTIC h) {
+    int side = max(bu->get_x_max(), bu->get_y_max());
+    if (!STATS_ENABLED && (side <= 16)) {
+        return small_astar<16>(bu, ss, start, target, h);
+    }
+    if (!STATS_ENABLED && (side <= 32)) {
+        return small_astar<32>(bu, ss, start, target, h);
+    }
+    if (!STATS_ENABLED && (side <= KERNEL_SMALL_MAX)) {
+        return small_astar<KERNEL_SMALL_MAX>(bu, ss, start, target, h);
+    }
+    return grid_astar(bu, ss, start, target, h);
+}
+
+/**
+ * @brief Function to run A* between two cells of the battleship map. The open list
+ *        is a bucket queue on f = g + Manhattan distance, expanded cells are closed
+ *        and parent links are left in the search state for trace_path(). Unit cost
+ *        searches on a map with a sentinel border run in a kernel (kernels.hpp). On
+ *        a map with traversal costs g adds up the costs of the entered cells and the
+ *        Manhattan distance is scaled by the lowest cost.
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ * 
+ */
+int astar_search(battleship *bu, search_state *ss, int start, int target) {
+    int y_max = bu->get_y_max();
+    int tx = bu->x_of(target), ty = bu->y_of(target);
+    if (bu->has_costs()) {
+        int scale = bu->get_min_cost();
+        return best_first(bu, ss, start, target, [=](int cell) {
+            int x = cell / y_max, y = cell - x * y_max;
+            return scale * (abs(x - tx) + abs(y - ty));
+        }, [bu](int cell) { return bu->step_cost(cell); });
+    }
+    if (SEARCH_KERNELS && bu->has_border()) {
+        return run_kernel(bu, ss, start, target, _manhattan_bound{tx, ty});
+    }
+    return best_first(bu, ss, start, target, [=](int cell) {
+        int x = cell / y_max, y = cell - x * y_max;
+        return abs(x - tx) + abs(y - ty);
+    }, [](int) { return 1; });
+}
+
+/**
+ * @brief Function to add up the costs of the cells a path enters
+ * @param bu pointer the the battleship class
+ * @param path path points, start first
+ * @return path cost, the number of steps on a map without costs
+ *
+ */
+long path_cost(battleship *bu, const vector<_points> &path) {
+    long cost = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        cost += bu->has_costs() ? bu->step_cost(bu->index(path[i].x, path[i].y)) : 1;
+    }
+    return cost;
+}
+
+/**
+ * @brief Function to run A* with the ALT heuristic between two cells. The bound of
+ *        a cell is the larger of its Manhattan distance and the landmark bound, both
+ *        consistent, so the path is as short as the one of astar_search(), on maps
+ *        with traversal costs as cheap.
+ * @param bu pointer the the battleship class
+ * @param ss search state to use, reset by the call
+ * @param lm landmark tables built for the current terrain
+ * @param start start cell index
+ * @param target target cell index
+ * @return return 1 if a valid path is found. 0 if no path
+ *
+ */
+int alt_search(battleship *bu, search_state *ss, const landmark_set *lm, int start, int target) {
+    int y_max = bu->get_y_max();
+    int tx = bu->x_of(target), ty = bu->y_of(target);
+    uint16_t row[ALT_MAX_LANDMARKS];
+    lm->target_row(target, row);
+    if (bu->has_costs()) {
+        int scale = bu->get_min_cost(), ct = bu->step_cost(target);
+        return best_first(bu, ss, start, target, [=, &row](int cell) {
+            int x = cell / y_max, y = cell - x * y_max;
+            int m = scale * (abs(x - tx) + abs(y - ty));
+            int l = lm->bound(cell, row, ct - bu->step_cost(cell));
+            return (l > m) ? l : m;
+        }, [bu](int cell) { return bu->step_cost(cell); });
+    }
+    if (SEARCH_KERNELS && bu->has_border()) {
+        return run_kernel(bu, ss, start, target, _alt_bound{tx, ty, lm, row});
+    }
+    return best_first(bu, ss, start, target, [=, &row](int cell) {
+        int x = cell / y_max, y = cell - x * y_max;
+        int m = abs(x - tx) + abs(y - ty);
+        int l = lm->bound(cell, row);
+        return (l > m) ? l : m;
+    }, [](int) { return 1; });
+}
+
+/**
+ * @brief Function to count the cells on the path ending at the target
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @return number of points in the path
+ *
+ */
+static int path_length(battleship *bu, search_state *ss, int target) {
+    int len = 1;
+    for (int node = target, prev; (prev = ss->get_parent(node)) >= 0; node = prev) {
+        len += abs(bu->x_of(node) - bu->x_of(prev)) + abs(bu->y_of(node) - bu->y_of(prev));
+    }
+    return len;
+}
+
+/**
+ * @brief Function to walk the parent links of a finished search back from the
+ *        target, one cell at a time, and mark the path cells
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param len number of points in the path, from path_length()
+ * @param emit callable taking (position from the start, cell index)
+ * @return number of points in the path
+ *
+ */
+template <typename EMIT>
+static int walk_path(battleship *bu, search_state *ss, int target, int len, EMIT emit) {
+    int y_max = bu->get_y_max();
+    int i = len;
+    for (int node = target; node >= 0; ) {                      // fill back to front
+        int prev = ss->get_parent(node);
+        int step = 0;
+        if (prev >= 0) {                                        // parent links may skip along a straight line
+            step = (bu->x_of(prev) == bu->x_of(node)) ? ((prev > node) ? 1 : -1)
+                                                       : ((prev > node) ? y_max : -y_max);
+        }
+        for (int cell = node; ; cell += step) {
+            emit(--i, cell);
+            ss->touch(cell);
+            ss->marked_path[cell] = 1;
+            if (prev < 0 || cell + step == prev) {
+                break;
+            }
+        }
+        node = prev;
+    }
+    return len;
+}
+
+/**
+ * @brief Function to rebuild a path from the parent links of a finished search,
+ *        marks the path cells in the search state. Parent links that skip along
+ *        a straight line are filled in cell by cell
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param sol pointer to vector receiving the path points, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<_points*> *sol) {
+    size_t base = sol->size();
+    int len = path_length(bu, ss, target);
+    sol->resize(base + len);
+    return walk_path(bu, ss, target, len, [&](int i, int cell) {
+        _points *p = new _points;
+        p->x = bu->x_of(cell);
+        p->y = bu->y_of(cell);
+        (*sol)[base + i] = p;
+    });
+}
+
+/**
+ * @brief Function to rebuild a path into a vector of point values, see trace_path()
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param sol pointer to vector receiving the path points, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<_points> *sol) {
+    size_t base = sol->size();
+    int len = path_length(bu, ss, target);
+    sol->resize(base + len);
+    return walk_path(bu, ss, target, len, [&](int i, int cell) {
+        (*sol)[base + i].x = bu->x_of(cell);
+        (*sol)[base + i].y = bu->y_of(cell);
+    });
+}
+
+/**
+ * @brief Function to rebuild a path into a vector of cell indices, see trace_path().
+ *        The vector is overwritten, so a reused one keeps its capacity.
+ * @param bu pointer the the battleship class
+ * @param ss search state holding the parent links
+ * @param target target cell index
+ * @param cells pointer to vector receiving the path cells, start first
+ * @return number of points in the path
+ * 
+ */
+int trace_path(battleship *bu, search_state *ss, int target, vector<int> *cells) {
+    int len = path_length(bu, ss, target);
+    cells->resize(len);
+    int *out = cells->data();
+    return walk_path(bu, ss, target, len, [out](int i, int cell) { out[i] = cell; });
+}
+
+/**
+ * @brief Function to find the vaild path from start to target of the battleship
+ * @param bu pointer the the battleship class
+ * @param sol pointer to vector receiving the path points, start first
+ * @param mode search mode to use
+ * @return return 1 if a valid path is found. 0 if no path
+ * 
+ */
+int find_path(battleship *bu, vector<_points*> *sol, _search_mode mode) {
+    int ret = 0;
+    if (mode == SEARCH_GREEDY) {
+        ret = find_path_greedy(bu, sol);
+    } else if (mode == SEARCH_HPA) {
+        ret = find_path_hpa(bu, sol);
+    } else if (mode == SEARCH_BFS) {
+        ret = find_path_bfs(bu, sol);
+    } else if (mode == SEARCH_ALT) {
+        ret = find_path_alt(bu, sol);
+    } else if (mode == SEARCH_HDA) {
+        ret = find_path_hda(bu, sol);
+    } else {
+        search_state *ss = bu->get_scratch();
+        if (mode == SEARCH_JPS) {
+            ret = jps_search(bu, ss, bu->get_start(), bu->get_target());
+        } else if (mode == SEARCH_BIDIR) {
+            ret = bidir_search(bu, ss, bu->get_back_scratch(), bu->get_start(), bu->get_target());
+        } else {
+            ret = astar_search(bu, ss, bu->get_start(), bu->get_target());
+        }
+        if (ret) {
+            trace_path(bu, ss, bu->get_target(), sol);
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,99 @@
+/**
+ * @brief   Query file
+ * @details This file contains the allocation free query API: route() runs a search in a
+ *          caller owned query_arena and hands the path back as a span of cell indices.
+ *
+ */
+#include "query.hpp"
+#include "output.hpp"
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param bu pointer to the battleship holding the map
+ * @param landmarks landmark tables of the map for SEARCH_ALT, NULL if not used
+ *
+ */
+query_arena::query_arena(battleship *bu, const landmark_set *landmarks)
+    : cells(0), spread(0), lm(landmarks) {
+    bind(bu);
+}
+
+/**
+ * @brief Method to fit the states to a map, a no-op if the size is unchanged
+ * @param bu pointer to the battleship holding the map
+ *
+ */
+void query_arena::bind(battleship *bu) {
+    if (fwd.size() == (size_t)bu->get_cells()) {
+        return;
+    }
+    cells = bu->get_cells();
+    // with a consistent heuristic f grows by at most twice the step cost along an
+    // edge, and by twice the length of a JPS jump, which spans a row or column at most
+    spread = max(2 * (bu->get_x_max() + bu->get_y_max()), 2 * UINT8_MAX);
+    fwd = search_state();
+    fwd.resize(cells);
+    fwd.open_list.reserve(spread, 4 * cells + 1);
+    back = search_state();
+    path.clear();
+    path.shrink_to_fit();
+    path.reserve(cells);
+}
+
+/**
+ * @brief Function to find a path between two cells with no heap allocation once the
+ *        arena is sized. Modes SEARCH_ASTAR, SEARCH_JPS, SEARCH_BIDIR and, with
+ *        landmarks in the arena, SEARCH_ALT are served; the others build tables per
+ *        call and go through find_path() or the batch engine instead.
+ * @param bu pointer the the battleship class
+ * @param qa arena of the calling thread, fitted to the map by the call
+ * @param start start cell index
+ * @param target target cell index
+ * @param mode search mode
+ * @param path pointer to the span receiving the path, valid until the next query
+ * @return return 1 if a valid path is found. 0 if no path. -1 if the mode is not served
+ *
+ */
+int route(battleship *bu, query_arena *qa, int start, int target, _search_mode mode, _path_span *path) {
+    path->cells = NULL;
+    path->points = 0;
+    qa->bind(bu);
+    search_state *ss = qa->get_state();
+    int found = 0;
+    if (mode == SEARCH_ASTAR) {
+        found = astar_search(bu, ss, start, target);
+    } else if (mode == SEARCH_JPS) {
+        found = jps_search(bu, ss, start, target);
+    } else if (mode == SEARCH_BIDIR) {
+        found = bidir_search(bu, ss, qa->get_back_state(), start, target);
+    } else if ((mode == SEARCH_ALT) && qa->get_landmarks()) {
+        found = alt_search(bu, ss, qa->get_landmarks(), start, target);
+    } else {
+        return -1;
+    }
+    if (found) {
+        vector<int> *cells = qa->get_path();
+        path->points = trace_path(bu, ss, target, cells);
+        path->cells = cells->data();
+    }
+    return found;
+}
+
+/**
+ * @brief Function to write the steps of a path as _path_dir codes (output.hpp), one
+ *        byte per step
+ * @param bu pointer the the battleship class
+ * @param path path from route()
+ * @param dirs pointer to at least path.points - 1 bytes receiving the codes
+ * @return number of steps
+ *
+ */
+int path_steps(battleship *bu, const _path_span &path, uint8_t *dirs) {
+    int y_max = bu->get_y_max();
+    for (int i = 1; i < path.points; ++i) {
+        int d = path.cells[i] - path.cells[i - 1];
+        dirs[i - 1] = (uint8_t)((d == -y_max) ? DIR_UP : (d == y_max) ? DIR_DOWN : (d == -1) ? DIR_LEFT : DIR_RIGHT);
+    }
+    return (path.points > 0) ? path.points - 1 : 0;
+}
@@ -8,9 +8,13 @@
  * @date    07-13-2025 
  * 
  */
+#include <cstdio>
 #include <fstream>
+#include <sstream>
 #include "definitions.hpp"
 #include "read_map.hpp"
+#include "rapidjson/reader.h"
+#include "rapidjson/error/en.h"
 
 /**
  * @brief Function to read JSON file passed in as agrument. It reads and 
@@ -89,3 +93,397 @@ void print_map_and_mark(const Value *buff, _field *start, _field *target, int y_
         cout << "Target at (" << target->x_pos << "," << target->y_pos << ")" << endl;
     }
 }
+
+/**
+ * @brief Byte stream over a FILE for the rapidjson Reader, FileReadStream with the
+ *        time spent in fread() added up, so the file read and the parse can be
+ *        reported as separate phases. Implements the rapidjson Stream concept.
+ *
+ */
+class timed_read_stream {
+    public:
+        typedef char Ch;
+
+        timed_read_stream(FILE *f, char *buf, size_t size)
+            : fp(f), buffer(buf), buffer_size(size), buffer_last(0), current(buf), read_count(0), count(0),
+              eof(false), read_ms(0) {
+            refill();
+        }
+
+        Ch Peek() const { return *current; }
+        Ch Take() {
+            Ch c = *current;
+            if (current < buffer_last) {
+                ++current;
+            } else {
+                refill();
+            }
+            return c;
+        }
+        size_t Tell() const { return count + (size_t)(current - buffer); }
+        double get_read_ms(void) const { return read_ms; }
+
+        // not used by the Reader on a read stream
+        void Put(Ch) {}
+        void Flush() {}
+        Ch *PutBegin() { return 0; }
+        size_t PutEnd(Ch *) { return 0; }
+
+    private:
+        FILE *fp;
+        Ch *buffer;
+        size_t buffer_size;
+        Ch *buffer_last;                    // last valid byte of the buffer
+        Ch *current;                        // next byte to hand out
+        size_t read_count;                  // bytes of the last fread()
+        size_t count;                       // bytes handed out before the buffer
+        bool eof;
+        double read_ms;                     // time spent in fread()
+
+        void refill(void) {
+            if (eof) {
+                return;
+            }
+            phase_clock clock;
+            count += read_count;
+            read_count = fread(buffer, 1, buffer_size, fp);
+            read_ms += clock.lap();
+            buffer_last = buffer + read_count - 1;
+            current = buffer;
+            if (read_count < buffer_size) {                     // '\0' ends the stream for the Reader
+                buffer[read_count] = '\0';
+                ++buffer_last;
+                eof = true;
+            }
+        }
+};
+
+/**
+ * @brief SAX handler base walking the layers of a Tiled map. Only the layer objects
+ *        directly inside the top level "layers" array are looked at; everything else
+ *        is consumed without being stored. The handler deriving from it is asked per
+ *        layer, once its name is known, whether it wants the tiles, and is handed
+ *        them one by one through tile(); data seen before the name is kept until then.
+ *
+ */
+template <class Derived>
+struct layer_walker : public BaseReaderHandler<UTF8<>, Derived> {
+    int depth;                          // current object/array nesting depth
+    int layers_depth;                   // depth of the "layers" array, 0 if not inside
+    bool key_layers;                    // last top level key was "layers"
+    string layer_key;                   // last key inside the current layer object
+    string layer_name;                  // "name" of the current layer
+    bool in_data;                       // inside the "data" array of a layer
+    vector<double> pending;             // data seen before the layer name
+
+    layer_walker() : depth(0), layers_depth(0), key_layers(false), in_data(false) {}
+
+    Derived &self(void) { return static_cast<Derived &>(*this); }
+    bool in_layer(void) const { return layers_depth && (depth == layers_depth + 1); }
+
+    // hooks of the derived handler, wants_layer(), tile() and end_layer() are required
+    void begin_layer(void) {}
+    void name_layer(void) {}
+
+    bool number(double dot) {
+        if (!in_data) {
+            return true;
+        }
+        if (layer_name.empty()) {                               // name not seen yet, keep for later
+            pending.push_back(dot);
+            return true;
+        }
+        return self().wants_layer() ? self().tile(dot) : true;
+    }
+    bool Int(int i) { return number(i); }
+    bool Uint(unsigned u) { return number(u); }
+    bool Int64(int64_t i) { return number((double)i); }
+    bool Uint64(uint64_t u) { return number((double)u); }
+    bool Double(double d) { return number(d); }
+
+    bool String(const char *str, SizeType len, bool) {
+        if (in_layer() && (layer_key == "name")) {
+            layer_name.assign(str, len);
+            self().name_layer();
+        }
+        return true;
+    }
+    bool Key(const char *str, SizeType len, bool) {
+        if (depth == 1) {
+            key_layers = (len == 6) && (string(str, len) == "layers");
+        } else if (in_layer()) {
+            layer_key.assign(str, len);
+        }
+        return true;
+    }
+    bool StartObject() {
+        ++depth;
+        if (in_layer()) {                                       // new layer
+            layer_name.clear();
+            layer_key.clear();
+            pending.clear();
+            self().begin_layer();
+        }
+        return true;
+    }
+    bool EndObject(SizeType) {
+        if (in_layer() && self().wants_layer()) {
+            for (double dot : pending) {
+                if (!self().tile(dot)) {
+                    return false;
+                }
+            }
+            if (!self().end_layer()) {
+                return false;
+            }
+        }
+        --depth;
+        return true;
+    }
+    bool StartArray() {
+        ++depth;
+        if ((depth == 2) && key_layers) {
+            layers_depth = depth;
+        } else if (layers_depth && (depth == layers_depth + 2) && (layer_key == "data")) {
+            in_data = true;
+        }
+        return true;
+    }
+    bool EndArray(SizeType) {
+        if (depth == layers_depth) {
+            layers_depth = 0;
+        }
+        in_data = false;
+        --depth;
+        return true;
+    }
+};
+
+/**
+ * @brief SAX handler picking the "world" layer out of a Tiled map.
+ *
+ */
+struct world_handler : public layer_walker<world_handler> {
+    int8_t *terrain;                    // destination terrain, x_max * y_max cells
+    size_t cells;                       // number of cells in the terrain
+    int y_max;                          // size of a row
+    _field *start;                      // start position found
+    _field *target;                     // target position found
+    size_t count;                       // tiles written
+    bool done;                          // world layer complete
+    bool overflow;                      // more tiles than the map holds
+
+    world_handler(int8_t *t, size_t n, int y, _field *s, _field *g)
+        : terrain(t), cells(n), y_max(y), start(s), target(g), count(0), done(false), overflow(false) {}
+
+    bool wants_layer(void) const { return layer_name == "world"; }
+
+    /**
+     * @brief Method to store one tile value, same conversion as insert_nodes()
+     *        and same start/target rules as print_map_and_mark()
+     *
+     */
+    bool tile(double dot) {
+        if (count >= cells) {
+            overflow = true;
+            return false;
+        }
+        int i = (int)count++;
+        bool is_start = (dot >= 8);
+        terrain[i] = is_start ? (int8_t)BU_START : (int8_t)(int)dot;
+        if ((dot != -1) && (dot != 3)) {
+            _field *f = is_start ? start : target;
+            f->x_pos = i / y_max;
+            f->y_pos = i % y_max;
+            f->field_stat = is_start ? BU_START : BU_TARGET;
+            f->visited = 0;
+            f->marked_path = 0;
+        }
+        return true;
+    }
+
+    bool end_layer(void) {
+        done = true;
+        return false;                                           // stop, the rest is not needed
+    }
+};
+
+/**
+ * @brief Function to stream the "world" layer of a Tiled JSON map straight into the
+ *        terrain of a battleship. It uses the rapidjson SAX Reader over a timed fread() stream,
+ *        so no Document is built: other layers are skipped without being stored, the
+ *        tile values are written to the packed terrain in one pass and start/target
+ *        are picked up on the way. Parsing stops once the world layer is complete.
+ *        start and target are left untouched if the map does not mark them.
+ *
+ * @param f_name string containing map file path
+ * @param bu pointer to the battleship sized for the map
+ * @param start pointer to start position
+ * @param target pointer to target position
+ * @param times pointer receiving the read and parse phase times, NULL if not needed
+ * @returns 1 if succeeded, 0 if failed
+ */
+int read_map_stream(string f_name, battleship *bu, _field *start, _field *target, _phase_times *times) {
+    phase_clock clock;
+    FILE *fp = fopen(f_name.c_str(), "rb");
+    if (!fp) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+
+    char buffer[1 << 16];
+    timed_read_stream stream(fp, buffer, sizeof(buffer));
+    world_handler handler(bu->get_terrain_buffer(), (size_t)bu->get_cells(), bu->get_y_max(), start, target);
+    Reader reader;
+    ParseResult ok = reader.Parse(stream, handler);
+    fclose(fp);
+    if (times) {
+        double total = clock.lap();
+        times->read = stream.get_read_ms();
+        times->parse = total - times->read;
+    }
+
+    if (handler.overflow || (handler.done && (handler.count != handler.cells))) {
+        cerr << "Input size does not match map file data dimensions!" << endl;
+        return 0;
+    }
+    if (!handler.done) {
+        if (ok.IsError()) {
+            cerr << "Error parsing JSON: " << GetParseError_En(ok.Code()) << " at offset " << ok.Offset() << endl;
+        } else {
+            cerr << "Error: No world layer in " << f_name << endl;
+        }
+        return 0;
+    }
+    bu->set_endpoints(start, target);
+    bu->reset_search();
+    return 1;
+}
+
+/**
+ * @brief Function to read a traversal cost table, one "<layer> <tile> <cost>" per line.
+ *        Empty lines and lines starting with '#' are skipped.
+ * @param f_name string containing the table file path
+ * @param table pointer to vector receiving the entries
+ * @returns 1 if succeeded, 0 if a line could not be parsed
+ */
+int read_cost_table(string f_name, vector<_cost_rule> *table) {
+    ifstream in(f_name);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        ++line_no;
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == string::npos) || (line[first] == '#')) {
+            continue;
+        }
+        istringstream fields(line);
+        _cost_rule rule;
+        if (!(fields >> rule.layer >> rule.tile >> rule.cost) || (rule.cost < 1) || (rule.cost > COST_MAX)) {
+            cerr << "Error: Bad cost rule on line " << line_no << " (cost 1.." << COST_MAX << "): " << line << endl;
+            return 0;
+        }
+        table->push_back(rule);
+    }
+    return 1;
+}
+
+/**
+ * @brief SAX handler applying a cost table to the layers of a Tiled map. The
+ *        tiles of a layer the table names raise the costs of their cells.
+ *
+ */
+struct cost_handler : public layer_walker<cost_handler> {
+    const vector<_cost_rule> *table;    // cost table
+    uint8_t *costs;                     // destination costs, one per cell, preset to 1
+    size_t cells;                       // number of cells in the map
+    vector<const _cost_rule *> rules;   // table entries of the current layer
+    size_t count;                       // tiles of the current layer
+    size_t layers_used;                 // layers that matched the table
+    bool bad_size;                      // a used layer does not hold one tile per cell
+
+    cost_handler(const vector<_cost_rule> *t, uint8_t *c, size_t n)
+        : table(t), costs(c), cells(n), count(0), layers_used(0), bad_size(false) {}
+
+    void begin_layer(void) {
+        rules.clear();
+        count = 0;
+    }
+    void name_layer(void) {
+        for (const _cost_rule &r : *table) {
+            if (r.layer == layer_name) {
+                rules.push_back(&r);
+            }
+        }
+    }
+    bool wants_layer(void) const { return !rules.empty(); }
+
+    bool tile(double dot) {
+        if (count >= cells) {
+            bad_size = true;
+            return false;
+        }
+        for (const _cost_rule *r : rules) {
+            if ((r->tile == dot) && (r->cost > costs[count])) {
+                costs[count] = (uint8_t)r->cost;
+            }
+        }
+        ++count;
+        return true;
+    }
+
+    bool end_layer(void) {
+        if (count != cells) {
+            bad_size = true;
+            return false;
+        }
+        ++layers_used;
+        return true;
+    }
+};
+
+/**
+ * @brief Function to stream the layers a cost table names out of a Tiled JSON map and
+ *        give the battleship its traversal costs. A cell costs the highest cost of the
+ *        table entries its tiles match, 1 if none matches. Layers the table does not
+ *        name are skipped without being stored.
+ *
+ * @param f_name string containing map file path
+ * @param bu pointer to the battleship holding the map
+ * @param table cost table
+ * @returns 1 if succeeded, 0 if failed
+ */
+int read_cost_layers(string f_name, battleship *bu, const vector<_cost_rule> &table) {
+    FILE *fp = fopen(f_name.c_str(), "rb");
+    if (!fp) {
+        cerr << "Error: Could not open file " << f_name << endl;
+        return 0;
+    }
+
+    char buffer[1 << 16];
+    timed_read_stream stream(fp, buffer, sizeof(buffer));
+    vector<uint8_t> costs(bu->get_cells(), 1);
+    cost_handler handler(&table, costs.data(), costs.size());
+    Reader reader;
+    ParseResult ok = reader.Parse(stream, handler);
+    fclose(fp);
+
+    if (handler.bad_size) {
+        cerr << "Error: Cost layer size does not match map file data dimensions!" << endl;
+        return 0;
+    }
+    if (ok.IsError()) {
+        cerr << "Error parsing JSON: " << GetParseError_En(ok.Code()) << " at offset " << ok.Offset() << endl;
+        return 0;
+    }
+    if (!handler.layers_used) {
+        cerr << "Error: No layer of the cost table in " << f_name << endl;
+        return 0;
+    }
+    bu->set_costs(move(costs));
+    return 1;
+}
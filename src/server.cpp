@@ -0,0 +1,550 @@
+/**
+ * @brief   Server file
+ * @details This file contains the resident routing server: maps are loaded once and
+ *          route and terrain update requests are answered over a Unix domain socket
+ *          or stdin, so a query no longer pays for a process start and a map load.
+ *
+ */
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.hpp"
+#include "output.hpp"
+
+/**
+ * @brief Function to append a number to a reply
+ * @param s pointer to the reply
+ * @param v number
+ */
+static void append(string *s, long v) {
+    char tmp[24];
+    char *end = to_chars(tmp, tmp + sizeof(tmp), v).ptr;
+    s->append(tmp, end - tmp);
+}
+
+/**
+ * @brief Function to append a time in microseconds to a reply, one decimal
+ * @param s pointer to the reply
+ * @param us time in microseconds
+ */
+static void append_us(string *s, double us) {
+    char tmp[32];
+    char *end = to_chars(tmp, tmp + sizeof(tmp), us, chars_format::fixed, 1).ptr;
+    s->append(tmp, end - tmp);
+}
+
+/**
+ * @brief Function to append a path to a reply: points, start and direction runs
+ * @param s pointer to the reply
+ * @param path path points, start first, not empty
+ */
+static void append_path(string *s, const vector<_points> &path) {
+    static const char dir_names[] = "UDLR";
+    vector<_dir_run> runs;
+    encode_runs(path, &runs);
+    *s += " path ";
+    append(s, (long)path.size());
+    *s += ' ';
+    append(s, path[0].x);
+    *s += ' ';
+    append(s, path[0].y);
+    *s += ' ';
+    for (auto &run : runs) {
+        *s += dir_names[run.dir];
+        append(s, run.steps);
+    }
+    if (runs.empty()) {                                         // start is the target
+        *s += '-';
+    }
+}
+
+/**
+ * @brief Function to split a request line into its space separated fields
+ * @param line request line
+ * @param fields pointer to vector receiving the fields
+ * @returns number of fields
+ */
+static int split_fields(const string &line, vector<string_view> *fields) {
+    fields->clear();
+    size_t i = 0, n = line.size();
+    while (i < n) {
+        while ((i < n) && ((line[i] == ' ') || (line[i] == '\t') || (line[i] == '\r'))) {
+            ++i;
+        }
+        size_t first = i;
+        while ((i < n) && (line[i] != ' ') && (line[i] != '\t') && (line[i] != '\r')) {
+            ++i;
+        }
+        if (i > first) {
+            fields->push_back(string_view(line.data() + first, i - first));
+        }
+    }
+    return (int)fields->size();
+}
+
+/**
+ * @brief Function to read an integer field
+ * @param f field
+ * @param v pointer receiving the value
+ * @returns 1 if the whole field is a number, 0 otherwise
+ */
+template <typename T>
+static int parse_field(string_view f, T *v) {
+    auto r = from_chars(f.data(), f.data() + f.size(), *v);
+    return (r.ec == errc()) && (r.ptr == f.data() + f.size());
+}
+
+/**
+ * @brief Constructor for class.
+ *
+ * @param o search options used for every map
+ *
+ */
+route_server::route_server(const _server_options &o)
+    : opts(o), requests(0), errors(0), stopping(false), listen_fd(-1) {}
+
+/**
+ * @brief Method to load a map and make it resident. JSON maps need their size,
+ *        binary maps carry it.
+ * @param name name the requests use
+ * @param file map file, JSON or binary
+ * @param x_max map rows, 0 for a binary map
+ * @param y_max map columns, 0 for a binary map
+ * @param err pointer to string receiving the reason of a failure
+ * @returns 1 if succeeded, 0 if failed
+ *
+ */
+int route_server::load(const string &name, const string &file, int x_max, int y_max, string *err) {
+    if (find_map(name)) {                                       // routes may be running on it
+        *err = "map " + name + " is already loaded";
+        return 0;
+    }
+    auto rm = make_unique<_resident_map>();
+    rm->start = {};
+    rm->target = {};
+    rm->start.x_pos = rm->target.x_pos = -1;
+    if (is_binary_map(file)) {
+        if (!rm->mapped.open(file, 0)) {
+            *err = "could not open map " + file;
+            return 0;
+        }
+        const _map_header *head = rm->mapped.get_header();
+        if (x_max && ((x_max != head->x_max) || (y_max != head->y_max))) {
+            *err = "map size does not match " + file;
+            return 0;
+        }
+        rm->start.x_pos = head->start_x;
+        rm->start.y_pos = head->start_y;
+        rm->target.x_pos = head->target_x;
+        rm->target.y_pos = head->target_y;
+        rm->bu = make_unique<battleship>(1, head->x_max, head->y_max, &rm->start, &rm->target, rm->mapped.get_terrain());
+    } else {
+        if ((x_max <= 0) || (y_max <= 0)) {
+            *err = "JSON map " + file + " needs x_max and y_max";
+            return 0;
+        }
+        rm->bu = make_unique<battleship>(1, x_max, y_max, &rm->start, &rm->target);
+        if (!read_map_stream(file, rm->bu.get(), &rm->start, &rm->target)) {
+            *err = "could not read map " + file;
+            return 0;
+        }
+        if (!opts.costs.empty() && !read_cost_layers(file, rm->bu.get(), opts.costs)) {
+            *err = "could not read the cost layers of " + file;
+            return 0;
+        }
+    }
+    rm->bu->build_components();
+    rm->engine = make_unique<batch_engine>(rm->bu.get(), opts.threads, opts.mode, opts.cluster, opts.cache_bytes,
+                                           opts.landmarks);
+    lock_guard<mutex> guard(maps_lock);
+    if (maps.count(name)) {                                     // loaded by another connection meanwhile
+        *err = "map " + name + " is already loaded";
+        return 0;
+    }
+    maps[name] = move(rm);
+    return 1;
+}
+
+/**
+ * @brief Method to look up a resident map. Maps stay until the server goes away,
+ *        so the pointer can be used without the lock.
+ * @param name map name
+ * @returns the map, NULL if there is no such map
+ *
+ */
+route_server::_resident_map *route_server::find_map(const string &name) {
+    lock_guard<mutex> guard(maps_lock);
+    auto it = maps.find(name);
+    return (it == maps.end()) ? NULL : it->second.get();
+}
+
+/**
+ * @brief Method to write one reply line
+ * @param c connection
+ * @param line reply, newline included
+ *
+ */
+void route_server::reply(_connection *c, const string &line) {
+    lock_guard<mutex> guard(c->write_lock);
+    size_t done = 0;
+    while (done < line.size()) {
+        ssize_t n = c->is_socket ? send(c->out_fd, line.data() + done, line.size() - done, MSG_NOSIGNAL)
+                                 : write(c->out_fd, line.data() + done, line.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;                                             // client went away, nothing to tell
+        }
+        done += n;
+    }
+    ++requests;
+}
+
+/**
+ * @brief Method to queue a route on the map's workers. The reply is written by the
+ *        worker, so routes of one connection run side by side.
+ * @param c connection
+ * @param rm map
+ * @param id request id
+ * @param q query
+ * @param t0 time the request line was read
+ *
+ */
+void route_server::route(_connection *c, _resident_map *rm, long id, const _query &q,
+                         chrono::steady_clock::time_point t0) {
+    {
+        lock_guard<mutex> guard(c->pending_lock);
+        ++c->pending;
+    }
+    rm->engine->submit([this, c, rm, id, q, t0](int worker) {
+        _query_result res;
+        {
+            shared_lock<shared_mutex> guard(rm->lock);
+            rm->engine->solve(worker, q, &res);
+        }
+        string out;
+        append(&out, id);
+        if (res.found) {
+            append_path(&out, res.path);
+        } else {
+            out += " none";
+        }
+        double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+        out += ' ';
+        append_us(&out, us);
+        out += '\n';
+        reply(c, out);
+        {
+            lock_guard<mutex> guard(latency_lock);
+            latency.push_back(us);
+        }
+        lock_guard<mutex> guard(c->pending_lock);
+        if (--c->pending == 0) {
+            c->drained.notify_all();
+        }
+    });
+}
+
+/**
+ * @brief Method to answer one request line
+ * @param c connection
+ * @param line request line, no newline
+ * @returns 1 to go on reading, 0 to close the connection
+ *
+ */
+int route_server::handle(_connection *c, const string &line) {
+    auto t0 = chrono::steady_clock::now();
+    vector<string_view> f;
+    int n = split_fields(line, &f);
+    if ((n == 0) || (f[0][0] == '#')) {
+        return 1;
+    }
+    if ((f[0] == "quit") || (f[0] == "shutdown")) {
+        if (f[0] == "shutdown") {
+            stopping = true;
+            if (listen_fd >= 0) {
+                ::shutdown(listen_fd, SHUT_RDWR);               // wakes the accept loop
+            }
+        }
+        return 0;
+    }
+
+    long id = 0;
+    string err;
+    if ((n < 2) || !parse_field(f[1], &id)) {
+        err = "missing request id";
+    } else if ((f[0] == "route") && (n == 7)) {
+        _resident_map *rm = find_map(string(f[2]));
+        _query q;
+        if (!rm) {
+            err = "no map " + string(f[2]);
+        } else if (!parse_field(f[3], &q.start.x) || !parse_field(f[4], &q.start.y) ||
+                   !parse_field(f[5], &q.target.x) || !parse_field(f[6], &q.target.y)) {
+            err = "bad route position";
+        } else {
+            route(c, rm, id, q, t0);
+            return 1;
+        }
+    } else if ((f[0] == "set") && (n == 6)) {
+        _resident_map *rm = find_map(string(f[2]));
+        int x = -1, y = -1;
+        if (!rm) {
+            err = "no map " + string(f[2]);
+        } else if (!parse_field(f[3], &x) || !parse_field(f[4], &y) || (x < 0) || (x >= rm->bu->get_x_max()) ||
+                   (y < 0) || (y >= rm->bu->get_y_max())) {
+            err = "bad cell position";
+        } else if ((f[5] != "ground") && (f[5] != "elevated")) {
+            err = "terrain must be ground or elevated";
+        } else {
+            {                                                   // routes sent before it see the old terrain
+                unique_lock<mutex> pending(c->pending_lock);
+                c->drained.wait(pending, [c]() { return c->pending == 0; });
+            }
+            int cell = rm->bu->index(x, y);
+            unique_lock<shared_mutex> guard(rm->lock);          // waits for running routes
+            rm->bu->set_terrain(cell, (f[5] == "ground") ? GROUND_TERRAIN : ELEVATED_TERRAIN);
+            rm->engine->update_cell(cell);
+            for (auto &t : rm->tracks) {                        // repaired on the ship's next move
+                t.second->update_cell(cell);
+            }
+        }
+    } else if (((f[0] == "track") && (n == 7)) || ((f[0] == "move") && (n == 6)) || ((f[0] == "untrack") && (n == 4))) {
+        _resident_map *rm = find_map(string(f[2]));
+        bool tracking = (f[0] == "track");
+        long track = id;                                        // a new track is named by its request id
+        int pos = tracking ? 3 : 4;                             // field of the ship position
+        int x = 0, y = 0, tx = 0, ty = 0;
+        if (!rm) {
+            err = "no map " + string(f[2]);
+        } else if (!tracking && !parse_field(f[3], &track)) {
+            err = "bad track id";
+        } else if ((f[0] != "untrack") && (!parse_field(f[pos], &x) || !parse_field(f[pos + 1], &y) || (x < 0) ||
+                   (x >= rm->bu->get_x_max()) || (y < 0) || (y >= rm->bu->get_y_max()))) {
+            err = "bad ship position";
+        } else if (tracking && (!parse_field(f[5], &tx) || !parse_field(f[6], &ty) || (tx < 0) ||
+                   (tx >= rm->bu->get_x_max()) || (ty < 0) || (ty >= rm->bu->get_y_max()))) {
+            err = "bad target position";
+        } else {
+            {                                                   // like set, after the routes sent before it
+                unique_lock<mutex> pending(c->pending_lock);
+                c->drained.wait(pending, [c]() { return c->pending == 0; });
+            }
+            unique_lock<shared_mutex> guard(rm->lock);
+            auto it = rm->tracks.find(track);
+            if (tracking && (it != rm->tracks.end())) {
+                err = "track " + to_string(track) + " exists";
+            } else if (!tracking && (it == rm->tracks.end())) {
+                err = "no track " + to_string(track);
+            } else if (f[0] == "untrack") {
+                rm->tracks.erase(it);
+            } else {
+                int found;
+                if (tracking) {
+                    auto plan = make_unique<dstar_lite>(rm->bu.get());
+                    found = plan->plan(rm->bu->index(x, y), rm->bu->index(tx, ty));
+                    it = rm->tracks.emplace(track, move(plan)).first;
+                } else {
+                    it->second->move_to(rm->bu->index(x, y));
+                    found = it->second->replan();
+                }
+                vector<_points> path;
+                string out;
+                append(&out, id);
+                if (found && it->second->get_path(&path)) {
+                    append_path(&out, path);
+                } else {
+                    out += " none";
+                }
+                out += ' ';
+                append_us(&out, chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+                out += '\n';
+                reply(c, out);
+                return 1;
+            }
+        }
+    } else if ((f[0] == "load") && ((n == 4) || (n == 6))) {
+        int x_max = 0, y_max = 0;
+        if ((n == 6) && (!parse_field(f[4], &x_max) || !parse_field(f[5], &y_max))) {
+            err = "bad map size";
+        } else {
+            load(string(f[2]), string(f[3]), x_max, y_max, &err);
+        }
+    } else if ((f[0] == "stats") && (n == 2)) {
+        vector<double> lat;
+        {
+            lock_guard<mutex> guard(latency_lock);
+            lat = latency;
+        }
+        sort(lat.begin(), lat.end());
+        size_t resident;
+        {
+            lock_guard<mutex> guard(maps_lock);
+            resident = maps.size();
+        }
+        string out;
+        append(&out, id);
+        out += " stats {\"requests\": ";
+        append(&out, requests.load());
+        out += ", \"errors\": ";
+        append(&out, errors.load());
+        out += ", \"maps\": ";
+        append(&out, (long)resident);
+        out += ", \"routes\": ";
+        append(&out, (long)lat.size());
+        const char *names[] = {"p50_us", "p90_us", "p99_us", "max_us"};
+        const double at[] = {50, 90, 99, 100};
+        for (int i = 0; i < 4; ++i) {
+            out += ", \"";
+            out += names[i];
+            out += "\": ";
+            append_us(&out, percentile(lat, at[i]));
+        }
+        out += "}\n";
+        reply(c, out);
+        return 1;
+    } else {
+        err = "unknown or malformed request";
+    }
+
+    string out;
+    append(&out, id);
+    if (err.empty()) {
+        out += " ok ";
+        append_us(&out, chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+    } else {
+        out += " error ";
+        out += err;
+        ++errors;
+    }
+    out += '\n';
+    reply(c, out);
+    return 1;
+}
+
+/**
+ * @brief Method to read and answer the requests of one connection until it ends,
+ *        then wait for its queued routes
+ * @param c connection
+ *
+ */
+void route_server::serve(_connection *c) {
+    vector<char> buf(SERVER_LINE_MAX);
+    string line;
+    bool open = true;
+    while (open && !stopping) {
+        ssize_t n = read(c->in_fd, buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        for (ssize_t i = 0; (i < n) && open; ++i) {
+            if (buf[i] != '\n') {
+                line += buf[i];
+                continue;
+            }
+            open = handle(c, line);
+            line.clear();
+        }
+        if (line.size() > SERVER_LINE_MAX) {
+            reply(c, "0 error request line too long\n");
+            ++errors;
+            break;
+        }
+    }
+    unique_lock<mutex> guard(c->pending_lock);
+    c->drained.wait(guard, [c]() { return c->pending == 0; });
+}
+
+/**
+ * @brief Method to serve a Unix domain socket, one thread per connection, until
+ *        a shutdown request. The socket file is replaced and removed again.
+ * @param path socket path
+ * @returns 0 if succeeded, -1 if failed
+ *
+ */
+int route_server::run_socket(const string &path) {
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: Socket path too long: " << path << endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if ((listen_fd < 0) || (::bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0) || (::listen(listen_fd, 64) < 0)) {
+        cerr << "Error: Could not listen on " << path << ": " << strerror(errno) << endl;
+        return -1;
+    }
+    cerr << "Serving on " << path << endl;
+
+    int active = 0;                                             // connection threads running
+    condition_variable done;                                    // signalled when one ends
+    while (!stopping) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;                                              // shut down
+        }
+        _connection *c = new _connection;
+        c->in_fd = c->out_fd = fd;
+        c->is_socket = true;
+        c->pending = 0;
+        {
+            lock_guard<mutex> guard(conn_lock);
+            conns.push_back(c);
+            ++active;
+        }
+        thread([this, c, &active, &done]() {
+            serve(c);
+            lock_guard<mutex> guard(conn_lock);
+            conns.erase(find(conns.begin(), conns.end(), c));
+            close(c->in_fd);                                    // the client sees the end after the last reply
+            delete c;
+            --active;
+            done.notify_all();
+        }).detach();
+    }
+
+    // wake the connections blocked in read(), they finish their queued routes
+    unique_lock<mutex> guard(conn_lock);
+    for (_connection *o : conns) {
+        ::shutdown(o->in_fd, SHUT_RD);
+    }
+    done.wait(guard, [&active]() { return active == 0; });
+    guard.unlock();
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(path.c_str());
+    return 0;
+}
+
+/**
+ * @brief Method to serve requests from stdin with replies on stdout until the
+ *        input ends or a quit or shutdown request
+ * @returns 0 if succeeded, -1 if failed
+ *
+ */
+int route_server::run_stdin(void) {
+    _connection c;
+    c.in_fd = 0;
+    c.out_fd = 1;
+    c.is_socket = false;
+    c.pending = 0;
+    serve(&c);
+    return 0;
+}
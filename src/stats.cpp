@@ -0,0 +1,79 @@
+/**
+ * @brief   Run statistics file
+ * @details This file contains the stats report of a run: the time of each phase and the
+ *          search event counters, printed as one JSON object for tools to pick up, and the
+ *          latency percentiles shared by the server and the benchmark.
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "stats.hpp"
+
+/**
+ * @brief Function to fetch a percentile of sorted latencies
+ * @param v sorted latencies
+ * @param p percentile, 0..100
+ * @returns latency
+ */
+double percentile(const vector<double> &v, double p) {
+    if (v.empty()) {
+        return 0;
+    }
+    size_t i = (size_t)ceil(p / 100.0 * v.size());
+    return v[min(v.size() - 1, (i > 0) ? i - 1 : 0)];
+}
+
+/**
+ * @brief Function to print the stats of a run as one JSON object
+ * @param out stream to write to
+ * @param mode search mode name
+ * @param t phase times
+ * @param queries searches run
+ * @param found searches that found a path
+ * @param points path points over all found paths
+ * @param expanded nodes expanded over all searches
+ * @param c event counters over all searches, only printed when STATS_ENABLED
+ * @param cache path cache counters, NULL if no cache was used
+ * @param chunks chunked map counters, NULL for a map held in memory
+ */
+void print_stats_json(ostream &out, const char *mode, const _phase_times &t, long queries, long found, long points,
+                      long expanded, const _search_counters &c, const _cache_stats *cache,
+                      const _chunk_stats *chunks) {
+    char buf[768];
+    int n = snprintf(buf, sizeof(buf),
+                     "{\"stats\": {\"mode\": \"%s\", \"counters_enabled\": %s, "
+                     "\"phases_ms\": {\"read\": %.3f, \"parse\": %.3f, \"grid\": %.3f, \"search\": %.3f, \"output\": %.3f}, "
+                     "\"search\": {\"queries\": %ld, \"found\": %ld, \"path_points\": %ld, \"expanded\": %ld",
+                     mode, STATS_ENABLED ? "true" : "false", t.read, t.parse, t.grid, t.search, t.output,
+                     queries, found, points, expanded);
+    if (STATS_ENABLED && (n > 0) && (n < (int)sizeof(buf))) {
+        snprintf(buf + n, sizeof(buf) - n,
+                 ", \"generated\": %ld, \"pushes\": %ld, \"pops\": %ld, \"stale\": %ld, \"backtracks\": %ld, "
+                 "\"peak_open\": %ld",
+                 c.generated, c.pushes, c.pops, c.stale, c.backtracks, c.peak_open);
+    }
+    out << buf << "}";
+    if (cache) {
+        long found_lookups = cache->hits + cache->sub_hits;
+        snprintf(buf, sizeof(buf),
+                 ", \"cache\": {\"lookups\": %ld, \"hits\": %ld, \"sub_hits\": %ld, \"misses\": %ld, "
+                 "\"hit_rate\": %.4f, \"hit_mean_us\": %.3f, \"miss_mean_us\": %.3f, \"inserts\": %ld, \"evictions\": %ld, "
+                 "\"entries\": %ld, \"bytes\": %ld, \"budget\": %ld}",
+                 cache->lookups, cache->hits, cache->sub_hits, cache->misses,
+                 cache->lookups ? (double)found_lookups / cache->lookups : 0.0,
+                 found_lookups ? cache->hit_us / found_lookups : 0.0, cache->misses ? cache->miss_us / cache->misses : 0.0,
+                 cache->inserts, cache->evictions, cache->entries, cache->bytes, cache->budget);
+        out << buf;
+    }
+    if (chunks) {
+        long lookups = chunks->hits + chunks->misses;
+        snprintf(buf, sizeof(buf),
+                 ", \"chunks\": {\"hits\": %ld, \"misses\": %ld, \"hit_rate\": %.4f, \"evictions\": %ld, "
+                 "\"bytes_read\": %ld, \"resident\": %ld, \"budget\": %ld, \"scratch_chunks\": %ld, \"scratch_bytes\": %ld}",
+                 chunks->hits, chunks->misses, lookups ? (double)chunks->hits / lookups : 0.0, chunks->evictions,
+                 chunks->bytes_read, chunks->resident, chunks->budget, chunks->scratch_chunks, chunks->scratch_bytes);
+        out << buf;
+    }
+    out << "}}" << endl;
+}
@@ -0,0 +1,130 @@
+/**
+ * @brief   Thread pool file
+ * @details This file contains the work stealing thread pool used to run many searches against
+ *          one loaded map.
+ *
+ */
+#include "thread_pool.hpp"
+
+/**
+ * @brief Constructor for class, starts the workers
+ * @param threads number of workers, 0 for one per hardware thread
+ *
+ */
+thread_pool::thread_pool(int threads) : queued(0), pending(0), next_queue(0), stopping(false) {
+    if (threads <= 0) {
+        threads = (int)thread::hardware_concurrency();
+        threads = (threads > 0) ? threads : 1;
+    }
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(make_unique<worker_queue>());
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&thread_pool::worker_main, this, i);
+    }
+}
+
+/**
+ * @brief Destructor for class, finishes queued work and joins the workers
+ *
+ */
+thread_pool::~thread_pool() {
+    stop();
+}
+
+/**
+ * @brief Method to finish queued work and join the workers, for owners that must
+ *        know no task runs before they tear down what tasks use. No task may be
+ *        submitted afterwards.
+ *
+ */
+void thread_pool::stop(void) {
+    {
+        lock_guard<mutex> lk(state_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &w : workers) {
+        if (w.joinable()) {
+            w.join();
+        }
+    }
+}
+
+/**
+ * @brief Method to queue a task
+ * @param task callable taking the worker id
+ *
+ */
+void thread_pool::submit(function<void(int)> task) {
+    {
+        lock_guard<mutex> lk(state_lock);                   // count the task before a worker can see it
+        worker_queue *q = queues[next_queue++ % queues.size()].get();
+        lock_guard<mutex> qlk(q->lock);
+        q->tasks.push_back(std::move(task));
+        ++queued;
+        ++pending;
+    }
+    wake.notify_one();
+}
+
+/**
+ * @brief Method to block until every submitted task has finished
+ *
+ */
+void thread_pool::wait(void) {
+    unique_lock<mutex> lk(state_lock);
+    idle.wait(lk, [this] { return pending == 0; });
+}
+
+/**
+ * @brief Method to take the oldest task, first from the own deque and then from
+ *        the other workers' deques
+ * @param id worker id
+ * @param task pointer receiving the task
+ * @returns true if a task was taken
+ *
+ */
+bool thread_pool::try_pop(int id, function<void(int)> *task) {
+    size_t n = queues.size();
+    for (size_t i = 0; i < n; ++i) {
+        worker_queue *q = queues[(id + i) % n].get();
+        lock_guard<mutex> lk(q->lock);
+        if (!q->tasks.empty()) {
+            *task = std::move(q->tasks.front());
+            q->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Main loop of a worker thread
+ * @param id worker id
+ *
+ */
+void thread_pool::worker_main(int id) {
+    for (;;) {
+        function<void(int)> task;
+        if (!try_pop(id, &task)) {
+            unique_lock<mutex> lk(state_lock);
+            wake.wait(lk, [this] { return stopping || (queued > 0); });
+            if (stopping && (queued == 0)) {
+                return;
+            }
+            continue;
+        }
+        {
+            lock_guard<mutex> lk(state_lock);
+            --queued;
+        }
+        task(id);
+        {
+            lock_guard<mutex> lk(state_lock);
+            if (--pending == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}